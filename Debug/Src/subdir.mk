@@ -6,42 +6,99 @@
 # Add inputs and outputs from these tool invocations to the build variables 
 C_SRCS += \
 ../Src/adc.c \
+../Src/at_engine.c \
+../Src/boot_control.c \
 ../Src/bsp.c \
+../Src/chunk_index.c \
 ../Src/circular_buffer.c \
+../Src/crc32.c \
+../Src/delta_patch.c \
+../Src/ecdsa_p256.c \
 ../Src/esp82xx_driver.c \
 ../Src/esp82xx_lib.c \
+../Src/flash_async.c \
 ../Src/flash_driver.c \
+../Src/flash_stream.c \
 ../Src/fota_processor.c \
 ../Src/fpu.c \
+../Src/http_client.c \
+../Src/http_parser.c \
+../Src/image_header.c \
+../Src/ipd_deframer.c \
+../Src/lzss.c \
 ../Src/main.c \
+../Src/nvm_store.c \
+../Src/ram_exec.c \
+../Src/response_matcher.c \
+../Src/ring_buffer.c \
+../Src/semver.c \
+../Src/sha256.c \
 ../Src/syscalls.c \
 ../Src/sysmem.c \
 ../Src/timebase.c 
 
 OBJS += \
 ./Src/adc.o \
+./Src/at_engine.o \
+./Src/boot_control.o \
 ./Src/bsp.o \
+./Src/chunk_index.o \
 ./Src/circular_buffer.o \
+./Src/crc32.o \
+./Src/delta_patch.o \
+./Src/ecdsa_p256.o \
 ./Src/esp82xx_driver.o \
 ./Src/esp82xx_lib.o \
+./Src/flash_async.o \
 ./Src/flash_driver.o \
+./Src/flash_stream.o \
 ./Src/fota_processor.o \
 ./Src/fpu.o \
+./Src/http_client.o \
+./Src/http_parser.o \
+./Src/image_header.o \
+./Src/ipd_deframer.o \
+./Src/lzss.o \
 ./Src/main.o \
+./Src/nvm_store.o \
+./Src/ram_exec.o \
+./Src/response_matcher.o \
+./Src/ring_buffer.o \
+./Src/semver.o \
+./Src/sha256.o \
 ./Src/syscalls.o \
 ./Src/sysmem.o \
 ./Src/timebase.o 
 
 C_DEPS += \
 ./Src/adc.d \
+./Src/at_engine.d \
+./Src/boot_control.d \
 ./Src/bsp.d \
+./Src/chunk_index.d \
 ./Src/circular_buffer.d \
+./Src/crc32.d \
+./Src/delta_patch.d \
+./Src/ecdsa_p256.d \
 ./Src/esp82xx_driver.d \
 ./Src/esp82xx_lib.d \
+./Src/flash_async.d \
 ./Src/flash_driver.d \
+./Src/flash_stream.d \
 ./Src/fota_processor.d \
 ./Src/fpu.d \
+./Src/http_client.d \
+./Src/http_parser.d \
+./Src/image_header.d \
+./Src/ipd_deframer.d \
+./Src/lzss.d \
 ./Src/main.d \
+./Src/nvm_store.d \
+./Src/ram_exec.d \
+./Src/response_matcher.d \
+./Src/ring_buffer.d \
+./Src/semver.d \
+./Src/sha256.d \
 ./Src/syscalls.d \
 ./Src/sysmem.d \
 ./Src/timebase.d 
@@ -49,12 +106,12 @@ C_DEPS += \
 
 # Each subdirectory must supply rules for building sources it contributes
 Src/%.o Src/%.su Src/%.cyclo: ../Src/%.c Src/subdir.mk
-	arm-none-eabi-gcc "$<" -mcpu=cortex-m4 -std=gnu11 -g3 -DDEBUG -DSTM32 -DSTM32F4 -DSTM32F411RETx -DSTM32F411xE -c -I../Inc -I"C:/Users/Prudhvi Belide/OneDrive/Documents/F24_Belide_Jayaraman_Wadhwa/Code/Bootloader-ESP-Main Code/esp82xx_fota_esd/chip_headers/CMSIS/Include" -I"C:/Users/Prudhvi Belide/OneDrive/Documents/F24_Belide_Jayaraman_Wadhwa/Code/Bootloader-ESP-Main Code/esp82xx_fota_esd/chip_headers/CMSIS/Device/ST/STM32F4xx/Include" -O0 -ffunction-sections -fdata-sections -Wall -fstack-usage -fcyclomatic-complexity -MMD -MP -MF"$(@:%.o=%.d)" -MT"$@" --specs=nano.specs -mfpu=fpv4-sp-d16 -mfloat-abi=hard -mthumb -o "$@"
+	arm-none-eabi-gcc "$<" -mcpu=cortex-m4 -std=gnu11 -g3 -DDEBUG -DSTM32 -DSTM32F4 -DSTM32F411RETx -DSTM32F411xE -c -I../Inc -I"C:/Users/Prudhvi Belide/OneDrive/Documents/F24_Belide_Jayaraman_Wadhwa/Code/Bootloader-ESP-Main Code/esp82xx_fota_esd/chip_headers/CMSIS/Include" -I"C:/Users/Prudhvi Belide/OneDrive/Documents/F24_Belide_Jayaraman_Wadhwa/Code/Bootloader-ESP-Main Code/esp82xx_fota_esd/chip_headers/CMSIS/Device/ST/STM32F4xx/Include" -Os -ffunction-sections -fdata-sections -Wall -fstack-usage -fcyclomatic-complexity -MMD -MP -MF"$(@:%.o=%.d)" -MT"$@" --specs=nano.specs -mfpu=fpv4-sp-d16 -mfloat-abi=hard -mthumb -o "$@"
 
 clean: clean-Src
 
 clean-Src:
-	-$(RM) ./Src/adc.cyclo ./Src/adc.d ./Src/adc.o ./Src/adc.su ./Src/bsp.cyclo ./Src/bsp.d ./Src/bsp.o ./Src/bsp.su ./Src/circular_buffer.cyclo ./Src/circular_buffer.d ./Src/circular_buffer.o ./Src/circular_buffer.su ./Src/esp82xx_driver.cyclo ./Src/esp82xx_driver.d ./Src/esp82xx_driver.o ./Src/esp82xx_driver.su ./Src/esp82xx_lib.cyclo ./Src/esp82xx_lib.d ./Src/esp82xx_lib.o ./Src/esp82xx_lib.su ./Src/flash_driver.cyclo ./Src/flash_driver.d ./Src/flash_driver.o ./Src/flash_driver.su ./Src/fota_processor.cyclo ./Src/fota_processor.d ./Src/fota_processor.o ./Src/fota_processor.su ./Src/fpu.cyclo ./Src/fpu.d ./Src/fpu.o ./Src/fpu.su ./Src/main.cyclo ./Src/main.d ./Src/main.o ./Src/main.su ./Src/syscalls.cyclo ./Src/syscalls.d ./Src/syscalls.o ./Src/syscalls.su ./Src/sysmem.cyclo ./Src/sysmem.d ./Src/sysmem.o ./Src/sysmem.su ./Src/timebase.cyclo ./Src/timebase.d ./Src/timebase.o ./Src/timebase.su
+	-$(RM) ./Src/adc.cyclo ./Src/adc.d ./Src/adc.o ./Src/adc.su ./Src/at_engine.cyclo ./Src/at_engine.d ./Src/at_engine.o ./Src/at_engine.su ./Src/boot_control.cyclo ./Src/boot_control.d ./Src/boot_control.o ./Src/boot_control.su ./Src/bsp.cyclo ./Src/bsp.d ./Src/bsp.o ./Src/bsp.su ./Src/chunk_index.cyclo ./Src/chunk_index.d ./Src/chunk_index.o ./Src/chunk_index.su ./Src/circular_buffer.cyclo ./Src/circular_buffer.d ./Src/circular_buffer.o ./Src/circular_buffer.su ./Src/crc32.cyclo ./Src/crc32.d ./Src/crc32.o ./Src/crc32.su ./Src/delta_patch.cyclo ./Src/delta_patch.d ./Src/delta_patch.o ./Src/delta_patch.su ./Src/ecdsa_p256.cyclo ./Src/ecdsa_p256.d ./Src/ecdsa_p256.o ./Src/ecdsa_p256.su ./Src/esp82xx_driver.cyclo ./Src/esp82xx_driver.d ./Src/esp82xx_driver.o ./Src/esp82xx_driver.su ./Src/esp82xx_lib.cyclo ./Src/esp82xx_lib.d ./Src/esp82xx_lib.o ./Src/esp82xx_lib.su ./Src/flash_async.cyclo ./Src/flash_async.d ./Src/flash_async.o ./Src/flash_async.su ./Src/flash_driver.cyclo ./Src/flash_driver.d ./Src/flash_driver.o ./Src/flash_driver.su ./Src/flash_stream.cyclo ./Src/flash_stream.d ./Src/flash_stream.o ./Src/flash_stream.su ./Src/fota_processor.cyclo ./Src/fota_processor.d ./Src/fota_processor.o ./Src/fota_processor.su ./Src/fpu.cyclo ./Src/fpu.d ./Src/fpu.o ./Src/fpu.su ./Src/http_client.cyclo ./Src/http_client.d ./Src/http_client.o ./Src/http_client.su ./Src/http_parser.cyclo ./Src/http_parser.d ./Src/http_parser.o ./Src/http_parser.su ./Src/image_header.cyclo ./Src/image_header.d ./Src/image_header.o ./Src/image_header.su ./Src/ipd_deframer.cyclo ./Src/ipd_deframer.d ./Src/ipd_deframer.o ./Src/ipd_deframer.su ./Src/lzss.cyclo ./Src/lzss.d ./Src/lzss.o ./Src/lzss.su ./Src/main.cyclo ./Src/main.d ./Src/main.o ./Src/main.su ./Src/nvm_store.cyclo ./Src/nvm_store.d ./Src/nvm_store.o ./Src/nvm_store.su ./Src/ram_exec.cyclo ./Src/ram_exec.d ./Src/ram_exec.o ./Src/ram_exec.su ./Src/response_matcher.cyclo ./Src/response_matcher.d ./Src/response_matcher.o ./Src/response_matcher.su ./Src/ring_buffer.cyclo ./Src/ring_buffer.d ./Src/ring_buffer.o ./Src/ring_buffer.su ./Src/semver.cyclo ./Src/semver.d ./Src/semver.o ./Src/semver.su ./Src/sha256.cyclo ./Src/sha256.d ./Src/sha256.o ./Src/sha256.su ./Src/syscalls.cyclo ./Src/syscalls.d ./Src/syscalls.o ./Src/syscalls.su ./Src/sysmem.cyclo ./Src/sysmem.d ./Src/sysmem.o ./Src/sysmem.su ./Src/timebase.cyclo ./Src/timebase.d ./Src/timebase.o ./Src/timebase.su
 
 .PHONY: clean-Src
 
@@ -0,0 +1,54 @@
+/*
+ * File : at_engine.h
+ * Author : Sriramkumar Jayaraman
+ * Description : Header file for the non-blocking AT command engine that queues commands for the ESP82xx and tracks
+ * their replies, deadlines and retries.
+ */
+
+#ifndef __AT_ENGINE_H
+#define __AT_ENGINE_H
+
+#include <stdint.h>
+#include "response_matcher.h"
+#include "ipd_deframer.h"
+
+#define AT_QUEUE_SZ			8
+#define AT_NO_REPLY			0xFFFFFFFFU		/*Reply number passed when no reply ended the command*/
+
+/*Command flags*/
+#define AT_NEW_EXCHANGE		0x01U			/*Drop what is left in the RX buffer before the command is sent*/
+
+typedef enum
+{
+	AT_DONE = 0,		/*An expected reply came back*/
+	AT_FAILED,			/*A failure reply came back on the last attempt*/
+	AT_TIMEOUT,			/*The deadline of the last attempt passed*/
+	AT_ABORTED			/*Dropped because an earlier command failed*/
+
+}atResult;
+
+typedef void (*at_callback)(void *ctx, atResult result, uint32_t reply);
+
+typedef struct
+{
+	const char *text;			/*Sent in place, must stay valid until the command completes. NULL only waits*/
+	uint32_t expect;			/*Replies that complete the command, one bit per reply*/
+	uint32_t fail;				/*Replies that fail the attempt*/
+	uint32_t timeout_ms;		/*Deadline of each attempt*/
+	uint32_t retries;			/*Attempts after the first one*/
+	uint32_t retry_delay_ms;	/*Pause before an attempt is repeated*/
+	at_callback callback;		/*Called once with the outcome, may be NULL*/
+	void *ctx;
+	uint32_t flags;				/*AT_NEW_EXCHANGE or 0*/
+
+}at_command;
+
+void at_engine_init(const response_automaton *replies);
+int at_engine_submit(const at_command *command);
+void at_engine_poll(void);
+int at_engine_idle(void);
+atResult at_engine_last_result(void);
+void at_engine_route(ipd_deframer *deframer);
+void at_engine_text(const uint8_t *data, uint32_t length);
+
+#endif
@@ -0,0 +1,71 @@
+/*
+ * File : boot_control.h
+ * Author : Prudhvi Raj Belide
+ * Description : Header file for the A/B application slots and the boot-control record that selects which slot
+ * boots, puts a freshly installed image on trial and rolls back to the previous slot if it never confirms.
+ */
+
+#ifndef __BOOT_CONTROL_H
+#define __BOOT_CONTROL_H
+
+#include <stdint.h>
+#include "flash_driver.h"
+#include "image_header.h"
+
+/*Flash layout: bootloader in sectors 0-1, NVM store in sectors 2-3*/
+#define BOOT_SLOT_A_ADDRESS		0x08010000		//SECTOR 4 - SECTOR 5 (192KB)
+#define BOOT_SLOT_A_SIZE		0x00030000
+#define BOOT_SLOT_B_ADDRESS		0x08040000		//SECTOR 6 - SECTOR 7 (256KB)
+#define BOOT_SLOT_B_SIZE		0x00040000
+
+/*An update alternates between the slots, so every image has to fit the smaller one: 192KB less the header*/
+#define BOOT_IMAGE_MAX_SIZE		(BOOT_SLOT_A_SIZE - IMAGE_HEADER_SZ)
+
+/*Images carry an image_header, the application is linked for the slot address plus IMAGE_HEADER_SZ. They are linked
+ *for their slot, the server keeps one build per slot*/
+#define BOOT_SLOT_A_FILE		"firmware_update_a.bin"
+#define BOOT_SLOT_B_FILE		"firmware_update_b.bin"
+#define BOOT_SLOT_A_MANIFEST	"firmware_update_a.cdc"
+#define BOOT_SLOT_B_MANIFEST	"firmware_update_b.cdc"
+
+/*Boots a new image gets to confirm itself before the bootloader rolls back*/
+#define BOOT_TRIAL_ATTEMPTS		3
+
+/*Written to RTC->BKP0R by the application once it is up and healthy*/
+#define BOOT_CONFIRM_MAGIC		0xB007600DU
+
+typedef enum
+{
+	BOOT_SLOT_A = 0,
+	BOOT_SLOT_B,
+	NUM_OF_BOOT_SLOTS,
+	BOOT_SLOT_NONE = 0xFF
+
+}bootSlot;
+
+/*Kept in the NVM store under NVM_KEY_BOOT_CONTROL, every change is a single record write*/
+typedef struct
+{
+	uint8_t active;			/*Slot that boots when nothing is on trial*/
+	uint8_t trial;			/*Slot on trial or BOOT_SLOT_NONE*/
+	uint8_t attempts;		/*Trial boots left*/
+	uint8_t valid;			/*One bit per slot holding a confirmed image*/
+	uint32_t verified[NUM_OF_BOOT_SLOTS];	/*Header CRC of the image whose payload passed the CRC check, 0 if none*/
+
+}boot_control;
+
+void boot_control_init(void);
+const boot_control *boot_control_get(void);
+uint8_t boot_inactive_slot(void);
+uint32_t boot_slot_address(uint8_t slot);
+uint32_t boot_slot_size(uint8_t slot);
+const char *boot_slot_file(uint8_t slot);
+const char *boot_slot_manifest(uint8_t slot);
+uint8_t boot_image_valid(uint8_t slot);
+uint8_t boot_image_verify(uint8_t slot);
+StatusTypeDef boot_control_invalidate(uint8_t slot);
+StatusTypeDef boot_control_set_trial(uint8_t slot);
+uint8_t boot_select_slot(void);
+void boot_start_application(void);
+
+#endif
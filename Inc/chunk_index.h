@@ -0,0 +1,79 @@
+/*
+ * File : chunk_index.h
+ * Author : Prudhvi Raj Belide
+ * Description : Header file for the content-defined chunking of images. The image in the active slot is cut into
+ * chunks at rolling hash boundaries and indexed by hash, a chunk manifest of the new image then tells which chunks
+ * are already on the device and which of them the slot being written holds in place. The chunking is shared with
+ * Tools/fw_manifest.py.
+ */
+
+#ifndef __CHUNK_INDEX_H
+#define __CHUNK_INDEX_H
+
+#include <stdint.h>
+#include "flash_driver.h"
+
+/*A chunk ends where the low bits of the rolling hash are zero, about every CHUNK_MIN_SZ + CHUNK_MASK + 1 bytes*/
+#define CHUNK_MIN_SZ			1024
+#define CHUNK_MAX_SZ			8192
+#define CHUNK_MASK				0x7FFU
+#define CHUNK_GEAR_SEED			0x2545F491U		/*xorshift32 seed of the rolling hash table*/
+
+/*Chunks of one image, enough for a 256KB slot cut into minimum sized chunks*/
+#define CHUNK_MAX_NUM			256
+#define CHUNK_HASH_SZ			8				/*Leading bytes of the SHA-256 of a chunk*/
+#define CHUNK_MISSING			0xFFFFU
+
+/*Manifest: magic, image size and chunk count, then {length, hash} per chunk, all words little endian*/
+#define CHUNK_MANIFEST_MAGIC	0x31434443U		/*"CDC1"*/
+#define CHUNK_RECORD_SZ			(4 + CHUNK_HASH_SZ)
+
+typedef struct
+{
+	uint32_t offset;
+	uint8_t hash[CHUNK_HASH_SZ];
+
+}chunk_entry;
+
+/*Chunks of the image in the active slot, chunk[count].offset is the image size*/
+typedef struct
+{
+	const uint8_t *base;
+	uint32_t count;
+	chunk_entry chunk[CHUNK_MAX_NUM + 1];
+
+}chunk_index;
+
+/*Where each chunk of the new image comes from*/
+typedef struct
+{
+	uint16_t length;
+	uint16_t local;			/*Chunk of the index holding the same bytes or CHUNK_MISSING*/
+	uint8_t in_place;		/*The target already holds the chunk at its offset*/
+
+}chunk_plan;
+
+typedef struct
+{
+	const chunk_index *index;
+	const uint8_t *target;				/*Flash the new image goes to, 0 if there is nothing to keep*/
+	uint32_t target_size;
+	uint32_t image_size;
+	uint32_t count;						/*Chunks announced*/
+	uint32_t parsed;					/*Chunks read so far*/
+	uint32_t total;						/*Sum of the chunk lengths*/
+	uint32_t present;					/*Bytes of the new image found in the index*/
+	uint32_t in_place;					/*Bytes of the new image the target holds in place*/
+	uint8_t fill;
+	uint8_t record[CHUNK_RECORD_SZ];
+	StatusTypeDef status;
+	chunk_plan plan[CHUNK_MAX_NUM];
+
+}chunk_manifest;
+
+StatusTypeDef chunk_index_build(chunk_index *index, const uint8_t *base, uint32_t size);
+void chunk_manifest_init(chunk_manifest *manifest, const chunk_index *index, const uint8_t *target, uint32_t target_size);
+void chunk_manifest_feed(chunk_manifest *manifest, const uint8_t *data, uint32_t length);
+StatusTypeDef chunk_manifest_finish(const chunk_manifest *manifest);
+
+#endif
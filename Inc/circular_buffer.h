@@ -8,36 +8,42 @@
 #define __CIRCULAR_BUFFER_H
 
 #include <esp82xx_driver.h>
+#include "ring_buffer.h"
 
 
-#define UART_BUFFER_SIZE 	6000
-#define INIT_VAL			0
+/*Buffer sizes, each one must be a power of two*/
+#define ESP_RX_BUFFER_SIZE		8192
+#define ESP_TX_BUFFER_SIZE		1024
+#define DEBUG_RX_BUFFER_SIZE	256
+#define DEBUG_TX_BUFFER_SIZE	2048
+
+/*Receive the ESP uart through DMA2 Stream2 in circular mode.
+ *Comment out to fall back to one RXNE interrupt per byte*/
+#define ESP_UART_RX_DMA
+
+/*Transmit both uarts through DMA, one transfer per contiguous segment.
+ *Comment out to fall back to one TXE interrupt per byte*/
+#define UART_TX_DMA
 
 typedef enum
 {
 	DEBUG_PORT = 0,
-	SLAVE_DEV_PORT
+	SLAVE_DEV_PORT,
+	NUM_OF_PORTS
 
 }portType;
 
-typedef struct
-{
-		unsigned char buffer[UART_BUFFER_SIZE];
-		__IO uint32_t head;
-		__IO uint32_t tail;
-
-}circular_buffer;
-
 void buffer_send_string(const char *s,portType uart);
+void buffer_send_block(const void *data, uint32_t length, portType uart);
 void circular_buffer_init(void);
 void buffer_clear(portType uart);
+uint8_t buffer_rx_overrun(portType uart);
 int buffer_peek(portType uart);
 int buffer_read(portType uart);
+uint32_t buffer_peek_contiguous(portType uart, ring_span *span);
+void buffer_consume(portType uart, uint32_t count);
 void buffer_write(unsigned char c, portType uart);
 int is_data(portType uart);
-int is_response(char *str);
-void get_strs(uint8_t num_of_chars,char *dest_buffer);
-int8_t copy_up_to_string(char * str, char * dest_buffer);
 
 #endif
 
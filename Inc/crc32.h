@@ -0,0 +1,38 @@
+/*
+ * File : crc32.h
+ * Author : Prudhvi Raj Belide
+ * Description : Header file for the CRC-32 used on flash records and images. Polynomial 0x04C11DB7, initial value
+ * 0xFFFFFFFF, fed one 32 bit word at a time MSB first without reflection or final XOR, which is what the STM32 CRC
+ * unit computes. Short records use the software routine, image payloads go through the CRC unit.
+ */
+
+#ifndef __CRC32_H
+#define __CRC32_H
+
+#include <stdint.h>
+#include "stm32f4xx.h"
+
+#define CRC32_INIT			0xFFFFFFFFU
+#define CRC32_POLY			0x04C11DB7U
+
+/*Feed flash to the CRC unit with DMA2 Stream0, comment out to feed it from the CPU*/
+#define CRC32_HW_DMA
+
+/*Bytes fed to the CRC unit while they arrive, the unit holds the state so only one stream can run at a time*/
+typedef struct
+{
+	uint32_t word;			/*Bytes waiting for a complete word*/
+	uint32_t fill;			/*Number of bytes in word*/
+	uint32_t bytes;			/*Bytes fed since crc32_stream_start()*/
+
+}crc32_stream;
+
+uint32_t crc32_words(uint32_t crc, const uint32_t *data, uint32_t count);
+
+void crc32_hw_init(void);
+uint32_t crc32_hw_memory(uint32_t address, uint32_t count);
+void crc32_stream_start(crc32_stream *stream);
+void crc32_stream_update(crc32_stream *stream, const uint8_t *data, uint32_t length);
+uint32_t crc32_stream_value(const crc32_stream *stream);
+
+#endif
@@ -0,0 +1,62 @@
+/*
+ * File : delta_patch.h
+ * Author : Prudhvi Raj Belide
+ * Description : Header file for the streaming patcher that rebuilds a new image from the image in the active slot
+ * and a delta patch. The format is shared with Tools/fw_delta.py.
+ */
+
+#ifndef __DELTA_PATCH_H
+#define __DELTA_PATCH_H
+
+#include <stdint.h>
+#include "flash_driver.h"
+
+/*A patch starts with this word, a plain image starts with IMAGE_MAGIC*/
+#define DELTA_MAGIC				0x31544C44U		/*"DLT1"*/
+
+/*Patch header after the magic: SHA-256 of the base payload, then the size of the image it builds*/
+#define DELTA_BASE_HASH_SZ		32
+#define DELTA_HEADER_SZ			(DELTA_BASE_HASH_SZ + 4)
+
+/*Bytes rebuilt by an ADD before they go to the sink*/
+#define DELTA_BUFFER_SZ			64
+
+/*Operations, arguments are little endian 32 bit words*/
+typedef enum
+{
+	DELTA_OP_COPY = 0,		/*offset, length: bytes of the base image*/
+	DELTA_OP_ADD,			/*offset, length, then length bytes added to the base image bytes*/
+	DELTA_OP_INSERT			/*length, then length new bytes*/
+
+}deltaOp;
+
+typedef void (*delta_sink)(void *ctx, const uint8_t *data, uint32_t length);
+
+typedef struct
+{
+	const uint8_t *base;				/*Image in the active slot, header included*/
+	uint32_t base_size;
+	const uint8_t *base_hash;			/*Expected in the patch header*/
+	uint32_t target_size;				/*Bytes the patch builds*/
+	uint32_t produced;
+	uint32_t copied;					/*Bytes taken from the base unchanged*/
+	uint8_t state;
+	uint8_t op;
+	uint8_t fill;						/*Bytes collected of the patch header or the arguments*/
+	uint8_t args[DELTA_HEADER_SZ];
+	uint32_t offset;					/*Base offset of the running ADD*/
+	uint32_t remaining;					/*Bytes left in the running ADD or INSERT*/
+	uint32_t buffer_fill;
+	uint8_t buffer[DELTA_BUFFER_SZ];
+	StatusTypeDef status;
+	delta_sink sink;
+	void *ctx;
+
+}delta_patcher;
+
+void delta_init(delta_patcher *patcher, const uint8_t *base, uint32_t base_size, const uint8_t *base_hash,
+		delta_sink sink, void *ctx);
+StatusTypeDef delta_feed(delta_patcher *patcher, const uint8_t *data, uint32_t length);
+StatusTypeDef delta_finish(const delta_patcher *patcher);
+
+#endif
@@ -0,0 +1,20 @@
+/*
+ * File : ecdsa_p256.h
+ * Author : Prudhvi Raj Belide
+ * Description : Header file for the ECDSA signature check on the NIST P-256 curve used to authenticate images.
+ */
+
+#ifndef __ECDSA_P256_H
+#define __ECDSA_P256_H
+
+#include <stdint.h>
+#include "flash_driver.h"
+
+#define P256_WORDS				8
+#define P256_BYTES				32
+
+/*Public key: X then Y, signature: r then s, all big endian*/
+StatusTypeDef ecdsa_p256_verify(const uint8_t public_key[2 * P256_BYTES], const uint8_t hash[P256_BYTES],
+		const uint8_t signature[2 * P256_BYTES]);
+
+#endif
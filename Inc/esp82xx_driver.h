@@ -13,5 +13,14 @@ void debug_uart_init(void);
 void esp_uart_init(void);
 void esp_rs_pin_init(void);
 void esp_rs_pin_enable(void);
+void esp_uart_rx_dma_init(uint8_t *buffer, uint32_t size);
+uint32_t esp_uart_rx_dma_position(uint32_t size);
+void esp_uart_rx_dma_clear_flags(void);
+void esp_uart_tx_dma_init(void);
+void esp_uart_tx_dma_start(const uint8_t *data, uint32_t length);
+void esp_uart_tx_dma_clear_flags(void);
+void debug_uart_tx_dma_init(void);
+void debug_uart_tx_dma_start(const uint8_t *data, uint32_t length);
+void debug_uart_tx_dma_clear_flags(void);
 
 #endif
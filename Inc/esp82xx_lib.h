@@ -12,12 +12,48 @@
 #include "esp82xx_driver.h"
 #include "circular_buffer.h"
 #include "timebase.h"
+#include "response_matcher.h"
+#include "at_engine.h"
 
 #define esp82xx_port		SLAVE_DEV_PORT
 #define debug_port			DEBUG_PORT
 
-void esp8266_init(char *ssid, char *password);
-void esp82xx_get_version_file(char *dest_buffer);
-void esp82xx_get_firmware(char *dest_buffer, const char *firmware_file);
+/*Replies recognised by the reply matcher*/
+typedef enum
+{
+	ESP_REPLY_OK = 0,
+	ESP_REPLY_ERROR,
+	ESP_REPLY_FAIL,
+	ESP_REPLY_SEND_OK,
+	ESP_REPLY_SEND_FAIL,
+	ESP_REPLY_CLOSED,
+	ESP_REPLY_IPD,
+	ESP_REPLY_GOT_IP,
+	ESP_REPLY_PROMPT,
+	ESP_REPLY_READY,
+	ESP_REPLY_BUSY,
+	ESP_REPLY_ALREADY_CONNECTED,
+	NUM_OF_ESP_REPLIES
+
+}espReply;
+
+#define ESP_REPLY_BIT(reply)	(1UL << (reply))
+
+typedef enum
+{
+	ESP_OFF = 0,
+	ESP_BUSY,			/*Bring-up commands are running*/
+	ESP_READY,			/*Joined the access point*/
+	ESP_FAILED
+
+}espStatus;
+
+void esp8266_start(char *ssid, char *password);
+int esp8266_init(char *ssid, char *password);
+espStatus esp82xx_status(void);
+int esp82xx_connect(const char *host, uint16_t port);
+int esp82xx_send(const char *data);
+void esp82xx_close(void);
+const response_automaton *esp82xx_replies(void);
 
 #endif
@@ -0,0 +1,45 @@
+/*
+ * File : flash_async.h
+ * Author : Prudhvi Raj Belide
+ * Description : Header file for the interrupt driven flash engine that runs queued erase and program requests in the
+ * background and reports each of them through a completion callback.
+ */
+
+#ifndef __FLASH_ASYNC_H
+#define __FLASH_ASYNC_H
+
+#include <stdint.h>
+#include "flash_driver.h"
+
+#define FLASH_ASYNC_QUEUE_SZ		8
+
+typedef enum
+{
+	FLASH_ASYNC_ERASE = 0,
+	FLASH_ASYNC_PROGRAM
+
+}flashAsyncType;
+
+/*Called from the FLASH interrupt once the request finished. error holds the decoded FLASH_ERROR_* bits*/
+typedef void (*flash_async_callback)(void *ctx, StatusTypeDef status, uint32_t error);
+
+typedef struct
+{
+	flashAsyncType type;
+	uint32_t address;				/*Sector number for an erase, flash address for a program*/
+	const uint8_t *data;			/*Must stay valid until the callback ran*/
+	uint32_t length;
+	uint32_t voltage_range;
+	flash_async_callback callback;	/*May be NULL*/
+	void *ctx;
+
+}flash_async_request;
+
+void flash_async_init(void);
+int flash_async_erase(uint32_t sector, uint32_t voltage_range, flash_async_callback callback, void *ctx);
+int flash_async_program(uint32_t address, const uint8_t *data, uint32_t length, uint32_t voltage_range,
+		flash_async_callback callback, void *ctx);
+uint32_t flash_async_pending(void);
+void flash_async_flush(void);
+
+#endif
@@ -8,6 +8,7 @@
 #define __FLASH_DRIVER_H
 
 #include "stm32f4xx.h"
+#include "ram_exec.h"
 
 
 #define FLASH_VOLTAGE_RANGE_1        0x00000000U  /*!< Device operating range: 1.8V to 2.1V                */
@@ -22,6 +23,22 @@
 
 #define FLASH_TIMEOUT_VALUE 	   50000 /*50 seconds*/
 
+/*Core clock the program statistics are converted with*/
+#define FLASH_STATS_CPU_HZ		   16000000U
+
+/*Status flags reporting a failed program or erase*/
+#define FLASH_SR_ERRORS			   (FLASH_SR_SOP | FLASH_SR_WRPERR | FLASH_SR_PGAERR | FLASH_SR_PGPERR | \
+									FLASH_SR_PGSERR | FLASH_SR_RDERR)
+
+/*Error bits kept in pFlash.ErrorCode*/
+#define FLASH_ERROR_NONE			0x00000000U
+#define FLASH_ERROR_RD				0x00000001U  /*!< Read protection error              */
+#define FLASH_ERROR_PGS				0x00000002U  /*!< Programming sequence error         */
+#define FLASH_ERROR_PGP				0x00000004U  /*!< Programming parallelism error      */
+#define FLASH_ERROR_PGA				0x00000008U  /*!< Programming alignment error        */
+#define FLASH_ERROR_WRP				0x00000010U  /*!< Write protection error             */
+#define FLASH_ERROR_OPERATION		0x00000020U  /*!< Operation error                    */
+
 
 #define FLASH_TYPEPROGRAM_BYTE        0x00000000U  /*!< Program byte (8-bit) at a specified address           */
 #define FLASH_TYPEPROGRAM_HALFWORD    0x00000001U  /*!< Program a half-word (16-bit) at a specified address   */
@@ -45,6 +62,17 @@
 #define FLASH_SECTOR_6     6U /*!< Sector Number 6   */
 #define FLASH_SECTOR_7     7U /*!< Sector Number 7   */
 
+#define FLASH_SECTOR_INVALID	0xFFFFFFFFU	/*Address outside the flash of the device*/
+#define FLASH_BANK2_FIRST_SECTOR	12U		/*Sector numbers of bank 2 start here on dual bank parts*/
+
+/*CR SNB value of a sector, bank 2 sectors are encoded from 16 on*/
+#define FLASH_SECTOR_SNB(sector)	(((sector) < FLASH_BANK2_FIRST_SECTOR) ? (sector) : ((sector) + 4U))
+
+/*Every STM32F4 bank starts with 4x16KB and 1x64KB sectors followed by 128KB sectors*/
+#define FLASH_SMALL_SECTOR_SZ		0x4000U
+#define FLASH_MEDIUM_SECTOR_SZ		0x10000U
+#define FLASH_LARGE_SECTOR_SZ		0x20000U
+
 
 typedef enum
 {
@@ -92,6 +120,73 @@ typedef struct
 
 
 }FLASH_EraseInitTypeDef;
+
+typedef struct
+{
+	uint16_t dev_id;			/*DBGMCU->IDCODE DEV_ID*/
+	uint8_t dual_bank;			/*Part can run its flash as two banks*/
+	const char *name;
+
+}flash_part;
+
+typedef struct
+{
+	const flash_part *part;
+	uint32_t size;				/*Bytes of flash from FLASH_BASE*/
+	uint32_t bank_size;			/*Bytes per bank, equals size on single bank parts*/
+	uint32_t sectors_per_bank;
+	uint8_t dual_bank;			/*Flash runs as two banks*/
+
+}flash_geometry;
+
+typedef struct
+{
+	uint32_t first;				/*First sector touched*/
+	uint32_t last;				/*Last sector touched*/
+	uint32_t count;				/*Sectors from first to last, bank 2 numbering gap excluded*/
+
+}flash_sector_span;
+
+typedef struct
+{
+	uint32_t operations;	/*Program operations issued to the flash interface*/
+	uint32_t bytes;			/*Bytes programmed by those operations*/
+	uint32_t cycles;		/*Core cycles spent programming*/
+
+}flash_program_stats;
+
+/*How flash_program_buffer() splits a buffer into program operations*/
+typedef struct
+{
+	uint32_t head;			/*Bytes programmed one at a time up to the first aligned address*/
+	uint32_t body;			/*Operations of the full program width*/
+	uint32_t tail;			/*Bytes programmed one at a time behind the body*/
+
+}flash_program_plan;
+
+/*Split length bytes at address for a program width of 1, 2, 4 or 8 bytes*/
+__STATIC_FORCEINLINE void flash_plan_program(uint32_t address, uint32_t length, uint32_t width,
+		flash_program_plan *plan)
+{
+	plan->head = (width - (address & (width - 1U))) & (width - 1U);
+
+	if(plan->head > length)
+	{
+		plan->head = length;
+	}
+
+	plan->body = (length - plan->head) / width;
+	plan->tail = length - plan->head - (plan->body * width);
+}
+
+/*Program operations of a plan, what flash_get_stats() counts for it*/
+__STATIC_FORCEINLINE uint32_t flash_plan_operations(const flash_program_plan *plan)
+{
+	return plan->head + plan->body + plan->tail;
+}
+
+extern FLASH_ProcessTypeDef pFlash;
+
 StatusTypeDef flash_program(uint32_t prg_type,  uint32_t address, uint64_t data);
 
 void flash_program_byte(uint32_t address, uint8_t data);
@@ -106,13 +201,28 @@ void flash_mass_erase(uint8_t voltage_range);
 StatusTypeDef flash_unlock(void);
 StatusTypeDef flash_lock(void);
 
-float flash_read_num(uint32_t start_sect_addr);
-void flash_write_num(uint32_t start_sect_addr, float num);
 void flash_read_data(uint32_t start_sect_addr, uint32_t *rx_buff, uint16_t numberofwords);
 uint32_t flash_write_data(uint32_t start_sect_addr,uint32_t *data, uint16_t numberofwords);
 void get_str(uint32_t *src_data, char *dest_buff);
 StatusTypeDef flash_ex_erase(FLASH_EraseInitTypeDef *pt_erase_init, uint32_t *sect_err);
 void flash_write_to_addr(uint32_t address, uint32_t *data, uint16_t length);
-uint32_t flash_write_data_byte(uint32_t start_sect_addr, uint8_t *data, uint16_t numberofbytes);
+uint32_t flash_write_data_byte(uint32_t start_sect_addr, uint8_t *data, uint32_t numberofbytes);
+void flash_geometry_init(void);
+const flash_geometry *flash_get_geometry(void);
+uint32_t get_sector(uint32_t address);
+uint32_t get_sector_address(uint32_t sector);
+uint32_t get_sector_size(uint32_t sector);
+uint32_t flash_next_sector(uint32_t sector);
+StatusTypeDef flash_get_sector_span(uint32_t address, uint32_t length, flash_sector_span *span);
+uint32_t flash_get_error(void);
+uint32_t flash_decode_error(uint32_t status_reg);
+void flash_flush_caches(void);
+
+StatusTypeDef flash_program_buffer(uint32_t address, const uint8_t *data, uint32_t length, uint32_t voltage_range);
+void flash_stats_reset(void);
+const flash_program_stats *flash_get_stats(void);
+void flash_stats_record(uint32_t operations, uint32_t bytes, uint32_t cycles);
+uint32_t flash_get_psize(uint32_t voltage_range);
+uint32_t flash_stats_bytes_per_sec(void);
 
 #endif
@@ -0,0 +1,55 @@
+/*
+ * File : flash_stream.h
+ * Author : Prudhvi Raj Belide
+ * Description : Header file for the streaming flash writer that programs firmware into a flash slot in page sized
+ * chunks as the bytes arrive, without holding the whole image in RAM.
+ */
+
+#ifndef __FLASH_STREAM_H
+#define __FLASH_STREAM_H
+
+#include <stdint.h>
+#include "flash_driver.h"
+#include "flash_async.h"
+
+#define FLASH_STREAM_PAGE_SZ		256
+
+/*Supply range of the board, selects the program parallelism*/
+#define FLASH_STREAM_VOLTAGE_RANGE	FLASH_VOLTAGE_RANGE_3
+
+/*Program pages with word (or double word) operations, comment out to fall back to the byte-wise path*/
+#define FLASH_STREAM_BULK
+
+#ifdef FLASH_STREAM_BULK
+#define FLASH_STREAM_PROGRAM_RANGE	FLASH_STREAM_VOLTAGE_RANGE
+#else
+#define FLASH_STREAM_PROGRAM_RANGE	FLASH_VOLTAGE_RANGE_1		/*x8 parallelism, one operation per byte*/
+#endif
+
+/*Pages filled while the previous ones are programmed in the background*/
+#define FLASH_STREAM_NUM_PAGES		2
+
+typedef struct
+{
+	uint32_t start_address;		/*First address of the slot*/
+	uint32_t end_address;		/*One past the last address of the slot*/
+	uint32_t write_address;		/*Address the page buffer will be programmed to*/
+	uint32_t fill;				/*Number of bytes held in the page buffer*/
+	uint32_t erased_sectors;	/*One bit per sector erased or queued for erase, the other sectors are kept*/
+	uint32_t submitted;			/*Pages handed to the flash engine*/
+	volatile uint32_t completed;	/*Pages the flash engine finished*/
+	volatile StatusTypeDef status;
+	uint32_t pages_skipped;		/*Pages of kept sectors, they already hold the new data*/
+	uint8_t page[FLASH_STREAM_NUM_PAGES][FLASH_STREAM_PAGE_SZ];
+
+}flash_stream;
+
+StatusTypeDef flash_stream_open(flash_stream *stream, uint32_t start_address, uint32_t size);
+StatusTypeDef flash_stream_erase(flash_stream *stream, uint32_t offset, uint32_t length);
+StatusTypeDef flash_stream_resume(flash_stream *stream, uint32_t offset, uint32_t length);
+uint8_t flash_stream_is_kept(const flash_stream *stream, uint32_t offset, uint32_t length);
+StatusTypeDef flash_stream_write(flash_stream *stream, const uint8_t *data, uint32_t length);
+StatusTypeDef flash_stream_close(flash_stream *stream);
+uint32_t flash_stream_bytes_written(const flash_stream *stream);
+
+#endif
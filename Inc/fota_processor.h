@@ -10,17 +10,61 @@
 #include <stddef.h>
 #include "esp82xx_lib.h"
 #include "flash_driver.h"
-#include "esp82xx_lib.h"
 
 
 #define DEBUG_OUTPUT
 
-#define NEW_FIRMWARE_START_ADDRESS		0x08008000		//SECTOR 2
-#define FIRMWARE "firmware_update.bin"
+/*Updates are written to the inactive slot of boot_control.h*/
+
+/*File on the update server holding the version of the release*/
+#define FIRMWARE_VERSION_FILE			"firmware_version.txt"
+
+/*Bytes at the start of the slot erased while the answer to the first request of the update is in flight, the first
+ *sector of either slot. The rest of the image is erased once its size is known, before any of it is requested*/
+#define FIRMWARE_ERASE_AHEAD_SIZE		0x00010000
+
+/*Fetch only the chunks of the new image the active slot lacks when the server has a chunk manifest, comment out to
+ *always download the whole image*/
+#define FIRMWARE_CHUNKED
+
+/*Keep the sectors of the slot that already hold their part of the new image instead of erasing them. Each sector is
+ *decided from the chunk manifest before anything is written: it is kept when every chunk touching it is in place,
+ *otherwise it is erased while the rest of the manifest comes in. Downloads without a manifest erase what they write.
+ *Comment out to always erase*/
+#define FIRMWARE_DIFFERENTIAL
+
+#if defined(FIRMWARE_DIFFERENTIAL) && !defined(FIRMWARE_CHUNKED)
+#error "FIRMWARE_DIFFERENTIAL decides from the chunk manifest, it needs FIRMWARE_CHUNKED"
+#endif
+
+/*Download plain images with Range requests and journal the progress in the NVM store, so an update cut short by a
+ *dropped link or a reset resumes where it stopped. Comment out to download each image with one request*/
+#define FIRMWARE_RESUMABLE
+
+/*Bytes per range request, the journal is updated after each one. Multiple of FLASH_STREAM_PAGE_SZ*/
+#define FIRMWARE_RANGE_SZ				0x4000
+
+/*A response is given up when no data arrived for this long*/
+#define FIRMWARE_RX_TIMEOUT_MS			10000
+
+/*Range requests in a row that may fail to make progress before the update is given up*/
+#define FIRMWARE_RANGE_RETRIES			5
+
+/*Outcome of the version check*/
+typedef enum
+{
+	FIRMWARE_RELEASE_FAILED = 0,	/*The version file did not arrive*/
+	FIRMWARE_RELEASE_CURRENT,		/*Nothing newer than the installed firmware*/
+	FIRMWARE_RELEASE_NEW
+
+}firmwareRelease;
 
-#define  MAX_FIRMWARE_SIZE		10500
-#define  TEMP_RX_BUFF_SZ		11000
-void firmware_update(void);
+void firmware_update_prepare(void);
+uint8_t firmware_update_pending(void);
+void firmware_update_discard(void);
+firmwareRelease firmware_check_release(char *text, uint32_t size);
+void firmware_release_installed(void);
+StatusTypeDef firmware_update(void);
 void jump_to_app(uint32_t address);
 
 
@@ -0,0 +1,51 @@
+/*
+ * File : http_client.h
+ * Author : Sriramkumar Jayaraman
+ * Description : Header file for the HTTP/1.1 client that keeps one connection to the update server alive, pipelines
+ * requests over it and hands each response to its own http_parser.
+ */
+
+#ifndef __HTTP_CLIENT_H
+#define __HTTP_CLIENT_H
+
+#include <stdint.h>
+#include "flash_driver.h"
+#include "ipd_deframer.h"
+#include "response_matcher.h"
+#include "http_parser.h"
+
+#define HTTP_SERVER_ADDRESS		"esd-fota.batcave.net"
+#define HTTP_SERVER_PORT		80
+#define HTTP_PATH				"/releases/"
+
+#define HTTP_REQUEST_BUFF_SZ	512		/*Requests of one send, several requests pipeline in one CIPSEND*/
+#define HTTP_MAX_PIPELINE		4		/*Responses that may be outstanding*/
+#define HTTP_SEND_ATTEMPTS		3
+
+typedef enum
+{
+	HTTP_PENDING = 0,
+	HTTP_COMPLETE,
+	HTTP_FAILED				/*Not sent, aborted, malformed or the connection ended before the body did*/
+
+}httpResult;
+
+typedef struct
+{
+	http_parser parser;		/*Status, headers and framing of the response*/
+	volatile httpResult result;
+
+}http_response;
+
+void http_client_init(void);
+StatusTypeDef http_client_queue(http_response *response, const char *file, http_body_handler on_body, void *ctx);
+StatusTypeDef http_client_queue_conditional(http_response *response, const char *file, const char *etag,
+		http_body_handler on_body, void *ctx);
+StatusTypeDef http_client_queue_range(http_response *response, const char *file, uint32_t first, uint32_t last,
+		http_body_handler on_body, void *ctx);
+StatusTypeDef http_client_send(void);
+StatusTypeDef http_client_wait(http_response *response, uint32_t timeout_ms);
+void http_client_abort(http_response *response);
+void http_client_close(void);
+
+#endif
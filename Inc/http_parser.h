@@ -0,0 +1,58 @@
+/*
+ * File : http_parser.h
+ * Author : Sriramkumar Jayaraman
+ * Description : Header file for the incremental HTTP/1.1 response parser. It is fed the response in pieces of any
+ * size, keeps no more than one header line and hands the body on as spans.
+ */
+
+#ifndef __HTTP_PARSER_H
+#define __HTTP_PARSER_H
+
+#include <stdint.h>
+#include "flash_driver.h"
+
+#define HTTP_LINE_SZ			64		/*Longer header lines are cut, the fields parsed fit*/
+#define HTTP_ETAG_SZ			48		/*Longest ETag kept, with its quotes*/
+#define HTTP_NO_LENGTH			0xFFFFFFFFU		/*No Content-Length, the body ends with the connection*/
+
+typedef void (*http_body_handler)(void *ctx, const uint8_t *data, uint32_t length);
+
+typedef enum
+{
+	HTTP_STATUS_LINE = 0,
+	HTTP_HEADER_LINE,
+	HTTP_BODY,
+	HTTP_CHUNK_SIZE,
+	HTTP_CHUNK_DATA,
+	HTTP_CHUNK_END,			/*CRLF behind the chunk data*/
+	HTTP_TRAILER,
+	HTTP_DONE,
+	HTTP_MALFORMED			/*Framing can not be trusted, nothing more is parsed*/
+
+}httpState;
+
+typedef struct
+{
+	httpState state;
+	uint32_t status;			/*Status code, 0 until the status line is in*/
+	uint32_t content_length;	/*HTTP_NO_LENGTH if the header is absent*/
+	uint32_t remaining;			/*Bytes left of the body or of the current chunk*/
+	uint32_t body_bytes;		/*Body bytes of the response, handed on or not*/
+	uint8_t chunked;
+	uint8_t close;				/*The server closes the connection after this response*/
+	char etag[HTTP_ETAG_SZ];	/*Empty if the response has none or it did not fit*/
+	char line[HTTP_LINE_SZ];
+	uint32_t line_len;
+	uint8_t line_cut;			/*The line did not fit, its end is missing*/
+	http_body_handler on_body;	/*Only receives the body of 2xx responses*/
+	void *ctx;
+
+}http_parser;
+
+void http_parser_init(http_parser *parser, http_body_handler on_body, void *ctx);
+uint32_t http_parser_feed(http_parser *parser, const uint8_t *data, uint32_t length);
+StatusTypeDef http_parser_close(http_parser *parser);
+uint8_t http_parser_done(const http_parser *parser);
+uint8_t http_parser_success(const http_parser *parser);
+
+#endif
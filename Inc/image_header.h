@@ -0,0 +1,50 @@
+/*
+ * File : image_header.h
+ * Author : Prudhvi Raj Belide
+ * Description : Header file for the header placed in front of every application image. It describes the payload
+ * that follows so the bootloader can reject a partly written or foreign image before jumping to it.
+ */
+
+#ifndef __IMAGE_HEADER_H
+#define __IMAGE_HEADER_H
+
+#include <stdint.h>
+#include "flash_driver.h"
+
+#define IMAGE_MAGIC				0x4D495746U		/*"FWIM"*/
+#define IMAGE_HEADER_VERSION	2
+
+/*The vector table follows the header, VTOR needs it on a 512 byte boundary*/
+#define IMAGE_HEADER_SZ			0x200
+
+/*Initial stack pointer of an image must lie in this range, the top of SRAM included*/
+#define IMAGE_SRAM_START		SRAM1_BASE
+#define IMAGE_SRAM_END			(SRAM1_BASE + 0x20000U)
+
+/*Reject downloads without a valid signature from the key in image_key.h*/
+#define IMAGE_SIGNED
+
+/*Layout shared with Tools/fw_pack.py, all fields little endian*/
+typedef struct
+{
+	uint32_t magic;
+	uint16_t header_version;
+	uint16_t header_size;		/*Offset of the payload from the header*/
+	uint32_t image_size;		/*Payload bytes, a multiple of 4*/
+	uint8_t version_major;
+	uint8_t version_minor;
+	uint16_t version_patch;
+	uint32_t load_address;		/*Address of the vector table, the payload is linked for it*/
+	uint32_t crc;				/*CRC-32 of the payload*/
+	uint8_t sha256[32];			/*SHA-256 of the payload*/
+	uint8_t signature[64];		/*ECDSA P-256 over the SHA-256 of the fields above, r then s*/
+	uint32_t header_crc;		/*CRC-32 of the fields above*/
+
+}image_header;
+
+const image_header *image_get_header(uint32_t slot_address);
+StatusTypeDef image_header_check(uint32_t slot_address, uint32_t slot_size);
+StatusTypeDef image_verify_payload(uint32_t slot_address);
+StatusTypeDef image_verify_signature(const image_header *header);
+
+#endif
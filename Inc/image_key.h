@@ -0,0 +1,20 @@
+/*
+ * File : image_key.h
+ * Author : Prudhvi Raj Belide
+ * Description : Public key the bootloader checks image signatures against. Generated by Tools/fw_keygen.py, keep the
+ * matching private key out of the firmware.
+ */
+
+#ifndef __IMAGE_KEY_H
+#define __IMAGE_KEY_H
+
+/*P-256 public key, X then Y, big endian*/
+#define IMAGE_PUBLIC_KEY \
+{ \
+	0x81, 0x61, 0x4F, 0x7F, 0x38, 0x57, 0x52, 0x40, 0x5F, 0xD7, 0x99, 0x1F, 0x57, 0x22, 0xE6, 0xF7, \
+	0x4D, 0xF1, 0x29, 0xF7, 0x44, 0x4B, 0x2E, 0xFA, 0x20, 0x6C, 0x04, 0x2D, 0xD8, 0x82, 0x6B, 0x8B, \
+	0xD7, 0x9A, 0x7C, 0x43, 0x98, 0xB0, 0x44, 0x2D, 0xEB, 0xDC, 0x26, 0x95, 0x5F, 0xD9, 0x19, 0x72, \
+	0x64, 0x07, 0x95, 0x90, 0x1B, 0x55, 0x55, 0x2E, 0x88, 0x47, 0xF5, 0xAE, 0x44, 0x0E, 0xFD, 0xCF \
+}
+
+#endif
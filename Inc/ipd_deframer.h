@@ -0,0 +1,49 @@
+/*
+ * File : ipd_deframer.h
+ * Author : Sriramkumar Jayaraman
+ * Description : Header file for the incremental deframer that separates "+IPD,<len>:" data frames of the ESP82xx
+ * from the AT text around them.
+ */
+
+#ifndef __IPD_DEFRAMER_H
+#define __IPD_DEFRAMER_H
+
+#include <stdint.h>
+
+#define IPD_MAX_FRAME_SZ		8192	/*Largest frame length accepted in a +IPD header*/
+#define IPD_MAX_HEADER_SZ		11		/*"<link id>,<len>" with five digit numbers*/
+
+typedef void (*ipd_span_handler)(void *ctx, const uint8_t *data, uint32_t length);
+
+typedef enum
+{
+	IPD_TEXT = 0,		/*Outside a frame, bytes are AT text*/
+	IPD_HEADER,			/*Reading the numbers of a +IPD header*/
+	IPD_PAYLOAD			/*Copying the payload of a frame*/
+
+}ipdState;
+
+typedef struct
+{
+	ipdState state;
+	uint32_t match;			/*Number of matched characters of "+IPD,"*/
+	uint32_t field;			/*Number being read from the header*/
+	uint32_t digits;		/*Digits in the number being read*/
+	uint32_t commas;		/*Separators seen in the header*/
+	uint32_t remaining;		/*Payload bytes left in the current frame*/
+	uint8_t header[IPD_MAX_HEADER_SZ];	/*Header bytes after the marker, handed back as text if the header is malformed*/
+	uint32_t header_len;
+
+	ipd_span_handler on_payload;	/*Receives frame payload*/
+	ipd_span_handler on_text;		/*Receives everything outside frames*/
+	void *ctx;
+
+	uint32_t frames;		/*Number of frames received*/
+	uint32_t bad_headers;	/*Number of malformed headers handed on as text*/
+
+}ipd_deframer;
+
+void ipd_deframer_init(ipd_deframer *deframer, ipd_span_handler on_payload, ipd_span_handler on_text, void *ctx);
+void ipd_deframer_feed(ipd_deframer *deframer, const uint8_t *data, uint32_t length);
+
+#endif
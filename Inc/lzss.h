@@ -0,0 +1,43 @@
+/*
+ * File : lzss.h
+ * Author : Prudhvi Raj Belide
+ * Description : Header file for the streaming LZSS decoder that unpacks compressed images between the +IPD deframer
+ * and the flash writer. The format is shared with Tools/lzss.py.
+ */
+
+#ifndef __LZSS_H
+#define __LZSS_H
+
+#include <stdint.h>
+
+/*A compressed stream starts with this word, a plain image starts with IMAGE_MAGIC*/
+#define LZSS_MAGIC				0x31535A4CU		/*"LZS1"*/
+
+/*Window of 4KB: a match is two bytes holding a 12 bit distance and a 4 bit length*/
+#define LZSS_WINDOW_BITS		12
+#define LZSS_WINDOW_SZ			(1U << LZSS_WINDOW_BITS)
+#define LZSS_MIN_MATCH			3
+#define LZSS_MAX_MATCH			(LZSS_MIN_MATCH + 15)
+
+/*Receives the decoded bytes, called with spans of the window*/
+typedef void (*lzss_sink)(void *ctx, const uint8_t *data, uint32_t length);
+
+typedef struct
+{
+	uint8_t window[LZSS_WINDOW_SZ];		/*Last decoded bytes, the source of the matches*/
+	uint32_t head;						/*Window position written next*/
+	uint32_t emitted;					/*Window position up to which bytes went to the sink*/
+	uint32_t produced;					/*Bytes decoded*/
+	uint8_t flags;						/*Control byte, one bit per item: 1 literal, 0 match*/
+	uint8_t items;						/*Items left under the control byte*/
+	uint8_t match_low;					/*First byte of a match split between two chunks*/
+	uint8_t match_split;
+	lzss_sink sink;
+	void *ctx;
+
+}lzss_decoder;
+
+void lzss_init(lzss_decoder *decoder, lzss_sink sink, void *ctx);
+void lzss_feed(lzss_decoder *decoder, const uint8_t *data, uint32_t length);
+
+#endif
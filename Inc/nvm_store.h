@@ -0,0 +1,61 @@
+/*
+ * File : nvm_store.h
+ * Author : Prudhvi Raj Belide
+ * Description : Header file for the key-value store kept in two 16KB flash sectors. Values are appended as CRC
+ * protected records, so an update costs a program operation instead of a sector erase.
+ */
+
+#ifndef __NVM_STORE_H
+#define __NVM_STORE_H
+
+#include <stdint.h>
+#include "flash_driver.h"
+
+#define NVM_SECTOR_A			FLASH_SECTOR_2
+#define NVM_SECTOR_B			FLASH_SECTOR_3
+#define NVM_SECTOR_A_ADDRESS	0x08008000
+#define NVM_SECTOR_B_ADDRESS	0x0800C000
+#define NVM_SECTOR_SZ			0x4000
+
+#define NVM_MAGIC				0x314D564EU		/*"NVM1"*/
+#define NVM_MAX_KEYS			32
+#define NVM_MAX_VALUE_SZ		256
+
+/*Keys of the values kept in the store*/
+typedef enum
+{
+	NVM_KEY_BOOT_COUNT = 0,			/*uint32_t, number of resets seen by the bootloader*/
+	NVM_KEY_INSTALLED_VERSION,		/*Version string of the last installed firmware*/
+	NVM_KEY_BOOT_CONTROL,			/*boot_control record of the A/B slots*/
+	NVM_KEY_DOWNLOAD_JOURNAL,		/*Progress of an interrupted ranged download, see fota_processor.c*/
+	NVM_KEY_RELEASE,				/*Version and ETag of the last release seen on the server, see fota_processor.c*/
+	NVM_NUM_OF_KEYS
+
+}nvmKey;
+
+/*Record layout in flash, the value follows padded to a word*/
+typedef struct
+{
+	uint16_t key;
+	uint16_t length;		/*Value bytes, 0 deletes the key*/
+	uint32_t crc;			/*CRC-32 over the first word and the padded value*/
+
+}nvm_record;
+
+/*First words of a sector in use*/
+typedef struct
+{
+	uint32_t magic;
+	uint32_t sequence;		/*Incremented by every compaction, the higher one is active*/
+
+}nvm_sector_header;
+
+StatusTypeDef nvm_init(void);
+int32_t nvm_read(uint16_t key, void *value, uint16_t max_length);
+StatusTypeDef nvm_write(uint16_t key, const void *value, uint16_t length);
+StatusTypeDef nvm_delete(uint16_t key);
+uint32_t nvm_read_u32(uint16_t key, uint32_t default_value);
+StatusTypeDef nvm_write_u32(uint16_t key, uint32_t value);
+uint32_t nvm_free_space(void);
+
+#endif
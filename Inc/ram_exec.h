@@ -0,0 +1,21 @@
+/*
+ * File : ram_exec.h
+ * Author : Prudhvi Raj Belide
+ * Description : Header file for running code from SRAM. Functions marked RAM_FUNC are linked into the .RamFunc
+ * section and copied to SRAM by the startup code together with .data.
+ */
+
+#ifndef __RAM_EXEC_H__
+#define __RAM_EXEC_H__
+
+/*Place a function in SRAM. On the single bank STM32F411 instruction fetches from flash stall while a sector is
+ *erased or programmed, everything that must keep running during that time (UART and DMA ISRs, SysTick, the
+ *flash engine) is placed here together with the vector table*/
+#define RAM_FUNC	__attribute__((section(".RamFunc"), noinline))
+
+/*Vector table entries of the STM32F411: 16 system exceptions and the device interrupts up to SPI5*/
+#define RAM_VECTOR_NUM		(16 + 86)
+
+void ram_vector_table_init(void);
+
+#endif
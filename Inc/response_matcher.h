@@ -0,0 +1,47 @@
+/*
+ * File : response_matcher.h
+ * Author : Sriramkumar Jayaraman
+ * Description : Header file for the streaming multi-pattern matcher that watches the ESP82xx replies.
+ */
+
+#ifndef __RESPONSE_MATCHER_H
+#define __RESPONSE_MATCHER_H
+
+#include <stdint.h>
+
+#define MATCHER_MAX_PATTERNS	32
+#define MATCHER_MAX_STATES		96
+#define MATCHER_MAX_CLASSES		40
+
+/*Aho-Corasick automaton turned into a full transition table, so every byte costs one lookup*/
+typedef struct
+{
+	uint8_t next[MATCHER_MAX_STATES][MATCHER_MAX_CLASSES];
+	uint32_t output[MATCHER_MAX_STATES];	/*Patterns ending in each state, one bit per pattern*/
+	uint8_t byte_class[256];				/*Bytes that occur in no pattern share class 0*/
+	uint32_t num_states;
+	uint32_t num_classes;
+
+}response_automaton;
+
+typedef struct
+{
+	const response_automaton *automaton;
+	uint32_t state;
+	uint32_t offset;	/*Bytes fed so far*/
+
+}response_matcher;
+
+typedef struct
+{
+	uint32_t patterns;	/*Patterns that ended on the matching byte, one bit per pattern*/
+	uint32_t offset;	/*Stream offset of the byte after the match*/
+
+}response_match;
+
+int response_automaton_build(response_automaton *automaton, const char * const *patterns, uint32_t count);
+void response_matcher_init(response_matcher *matcher, const response_automaton *automaton);
+uint32_t response_matcher_feed(response_matcher *matcher, const uint8_t *data, uint32_t length, uint32_t mask,
+		response_match *match);
+
+#endif
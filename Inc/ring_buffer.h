@@ -0,0 +1,130 @@
+/*
+ * File : ring_buffer.h
+ * Author : Prudhvi Raj Belide
+ * Description : Header file for the lock-free single-producer/single-consumer byte ring used between interrupt
+ * (or DMA) and thread context.
+ */
+
+#ifndef __RING_BUFFER_H
+#define __RING_BUFFER_H
+
+#include <stdint.h>
+#include "stm32f4xx.h"
+
+/*
+ * head and tail are free running counters, only the producer writes head and only the consumer writes tail.
+ * The capacity is a power of two so positions are found with a mask and the full capacity is usable.
+ */
+typedef struct
+{
+	uint8_t *storage;
+	uint32_t mask;			/*Capacity - 1*/
+	__IO uint32_t head;		/*Bytes ever written*/
+	__IO uint32_t tail;		/*Bytes ever read*/
+
+}ring_buffer;
+
+/*Up to two contiguous regions of a ring, the second one is used when the region wraps*/
+typedef struct
+{
+	uint8_t *data[2];
+	uint32_t length[2];
+
+}ring_span;
+
+/*Defines a ring with its own storage, the size is checked at compile time*/
+#define RING_BUFFER_DEFINE(name, size)															\
+	_Static_assert(((size) != 0) && (((size) & ((size) - 1)) == 0), #name " size must be a power of two");	\
+	static uint8_t name##_storage[(size)];													\
+	ring_buffer name = {name##_storage, (size) - 1U, 0U, 0U}
+
+__STATIC_FORCEINLINE uint32_t ring_capacity(const ring_buffer *ring)
+{
+	return ring->mask + 1U;
+}
+
+__STATIC_FORCEINLINE uint32_t ring_count(const ring_buffer *ring)
+{
+	return ring->head - ring->tail;
+}
+
+__STATIC_FORCEINLINE uint32_t ring_space(const ring_buffer *ring)
+{
+	return ring_capacity(ring) - ring_count(ring);
+}
+
+/*Producer side: store one byte, returns 0 if the ring is full*/
+__STATIC_FORCEINLINE int ring_put(ring_buffer *ring, uint8_t c)
+{
+	uint32_t head = ring->head;
+
+	if((head - ring->tail) > ring->mask)
+	{
+		return 0;
+	}
+
+	ring->storage[head & ring->mask] = c;
+
+	/*Data must be visible before the new head*/
+	__DMB();
+	ring->head = head + 1U;
+
+	return 1;
+}
+
+/*Producer side: publish bytes already placed in the free region*/
+__STATIC_FORCEINLINE void ring_commit(ring_buffer *ring, uint32_t count)
+{
+	__DMB();
+	ring->head += count;
+}
+
+/*Consumer side: next byte without removing it, -1 if empty*/
+__STATIC_FORCEINLINE int ring_peek(const ring_buffer *ring)
+{
+	uint32_t tail = ring->tail;
+
+	if(ring->head == tail)
+	{
+		return -1;
+	}
+
+	__DMB();
+	return ring->storage[tail & ring->mask];
+}
+
+/*Consumer side: read and remove one byte, -1 if empty*/
+__STATIC_FORCEINLINE int ring_get(ring_buffer *ring)
+{
+	uint32_t tail = ring->tail;
+	uint8_t c;
+
+	if(ring->head == tail)
+	{
+		return -1;
+	}
+
+	/*Head must be read before the data it covers*/
+	__DMB();
+	c = ring->storage[tail & ring->mask];
+
+	/*Data must be read before the slot is handed back*/
+	__DMB();
+	ring->tail = tail + 1U;
+
+	return c;
+}
+
+/*Consumer side: drop bytes that have been used in place*/
+__STATIC_FORCEINLINE void ring_consume(ring_buffer *ring, uint32_t count)
+{
+	__DMB();
+	ring->tail += count;
+}
+
+uint32_t ring_peek_contiguous(const ring_buffer *ring, ring_span *span);
+uint32_t ring_peek_free(const ring_buffer *ring, ring_span *span);
+uint32_t ring_read_span(ring_buffer *ring, uint8_t *dest, uint32_t length);
+uint32_t ring_write_span(ring_buffer *ring, const uint8_t *src, uint32_t length);
+
+#endif
@@ -0,0 +1,30 @@
+/*
+ * File : semver.h
+ * Author : Prudhvi Raj Belide
+ * Description : Header file for parsing release versions of the form [v]MAJOR.MINOR[.PATCH][-PRERELEASE][+BUILD]
+ * and ordering them by Semantic Versioning precedence.
+ */
+
+#ifndef __SEMVER_H
+#define __SEMVER_H
+
+#include <stdint.h>
+#include "flash_driver.h"
+
+#define SEMVER_PRE_SZ			16		/*Longest pre-release tag kept, with its terminator*/
+#define SEMVER_TEXT_SZ			32		/*Buffer that holds any version the parser accepts*/
+
+typedef struct
+{
+	uint32_t major;
+	uint32_t minor;
+	uint32_t patch;
+	char pre[SEMVER_PRE_SZ];	/*Pre-release tag without the '-', empty for a release*/
+
+}semver;
+
+StatusTypeDef semver_parse(const char *text, semver *version);
+int32_t semver_compare(const semver *a, const semver *b);
+void semver_from_numbers(semver *version, uint32_t major, uint32_t minor, uint32_t patch);
+
+#endif
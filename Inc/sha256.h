@@ -0,0 +1,28 @@
+/*
+ * File : sha256.h
+ * Author : Prudhvi Raj Belide
+ * Description : Header file for the streaming SHA-256 used to hash images while they are downloaded.
+ */
+
+#ifndef __SHA256_H
+#define __SHA256_H
+
+#include <stdint.h>
+
+#define SHA256_BLOCK_SZ			64
+#define SHA256_DIGEST_SZ		32
+
+typedef struct
+{
+	uint32_t state[8];
+	uint32_t length;					/*Bytes hashed so far, images stay far below 4GB*/
+	uint32_t fill;						/*Bytes waiting in block*/
+	uint8_t block[SHA256_BLOCK_SZ];
+
+}sha256_context;
+
+void sha256_init(sha256_context *ctx);
+void sha256_update(sha256_context *ctx, const uint8_t *data, uint32_t length);
+void sha256_final(sha256_context *ctx, uint8_t digest[SHA256_DIGEST_SZ]);
+
+#endif
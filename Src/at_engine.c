@@ -0,0 +1,252 @@
+/*
+ * File : at_engine.c
+ * Author : Sriramkumar Jayaraman
+ * Description : This file runs AT commands for the ESP82xx without blocking. Commands wait in a queue, each one is
+ * sent, its reply is picked out of the RX buffer by the reply matcher, and a deadline based on get_tick() bounds
+ * every attempt. Failed attempts are retried, and the final outcome is reported through a callback. The caller
+ * keeps calling at_engine_poll() and is free to do other work in between. While a connection carries +IPD frames
+ * the bytes go through its deframer instead, so data that arrives ahead of a reply reaches its owner.
+ */
+
+#include <string.h>
+#include "at_engine.h"
+#include "circular_buffer.h"
+#include "timebase.h"
+
+#define at_port			SLAVE_DEV_PORT
+
+typedef enum
+{
+	AT_IDLE = 0,
+	AT_SEND,			/*Command at the queue head is due to be sent*/
+	AT_WAIT_REPLY,		/*Waiting for a reply or the deadline*/
+	AT_RETRY_DELAY		/*Waiting before the next attempt*/
+
+}atState;
+
+typedef struct
+{
+	at_command queue[AT_QUEUE_SZ];
+	uint32_t head;
+	uint32_t tail;
+	atState state;
+	uint32_t attempt;
+	uint32_t deadline;
+	atResult last_result;
+	response_matcher matcher;
+	const response_automaton *replies;
+	ipd_deframer *deframer;		/*Takes the received bytes while a command waits, NULL to match them directly*/
+	uint32_t hit;				/*Replies found in the text the deframer handed back*/
+
+}at_engine;
+
+static at_engine engine;
+
+static void at_finish(atResult result, uint32_t reply);
+
+
+static int deadline_passed(uint32_t deadline)
+{
+	return (int32_t)(get_tick() - deadline) >= 0;
+}
+
+
+void at_engine_init(const response_automaton *replies)
+{
+	memset(&engine, 0, sizeof(engine));
+	engine.replies = replies;
+	engine.state = AT_IDLE;
+	engine.last_result = AT_DONE;
+}
+
+
+int at_engine_submit(const at_command *command)
+{
+	uint32_t next = (engine.head + 1) % AT_QUEUE_SZ;
+
+	if(next == engine.tail)
+	{
+		/*Queue full*/
+		return -1;
+	}
+
+	engine.queue[engine.head] = *command;
+	engine.head = next;
+
+	if(engine.state == AT_IDLE)
+	{
+		engine.attempt = 0;
+		engine.state = AT_SEND;
+	}
+
+	return 1;
+}
+
+
+int at_engine_idle(void)
+{
+	return engine.state == AT_IDLE;
+}
+
+
+atResult at_engine_last_result(void)
+{
+	return engine.last_result;
+}
+
+
+/*Hand the bytes received while a command waits to the deframer of an open connection, NULL once it is closed.
+ *The owner of the deframer passes the text between frames back through at_engine_text()*/
+void at_engine_route(ipd_deframer *deframer)
+{
+	engine.deframer = deframer;
+}
+
+
+/*Text between +IPD frames, the reply of the waiting command is looked for in it*/
+void at_engine_text(const uint8_t *data, uint32_t length)
+{
+	at_command *cmd = &engine.queue[engine.tail];
+	response_match match;
+
+	if((engine.state != AT_WAIT_REPLY) || (engine.hit != 0))
+	{
+		return;
+	}
+
+	response_matcher_feed(&engine.matcher, data, length, cmd->expect | cmd->fail, &match);
+	engine.hit = match.patterns;
+}
+
+
+void at_engine_poll(void)
+{
+	at_command *cmd = &engine.queue[engine.tail];
+	ring_span span;
+	response_match match;
+	uint32_t count;
+	uint32_t used;
+	uint32_t part;
+
+	switch(engine.state)
+	{
+		case AT_SEND:
+			/*Start matching from scratch, a wait-only command keeps what already arrived*/
+			response_matcher_init(&engine.matcher, engine.replies);
+			engine.hit = 0;
+
+			/*Drop stale replies of an earlier exchange, anything else may hold data of a connection*/
+			if(cmd->flags & AT_NEW_EXCHANGE)
+			{
+				buffer_clear(at_port);
+			}
+
+			if(cmd->text != 0)
+			{
+				buffer_send_block(cmd->text, strlen(cmd->text), at_port);
+			}
+
+			engine.deadline = get_tick() + cmd->timeout_ms;
+			engine.state = AT_WAIT_REPLY;
+			break;
+
+		case AT_WAIT_REPLY:
+			count = buffer_peek_contiguous(at_port, &span);
+
+			if(engine.deframer != 0)
+			{
+				/*Frames go to the connection and only the text between them is matched, a reply can not be faked by
+				 *data. The deframer carries on with the bytes after the reply, so all of them are consumed*/
+				ipd_deframer_feed(engine.deframer, span.data[0], span.length[0]);
+				ipd_deframer_feed(engine.deframer, span.data[1], span.length[1]);
+				buffer_consume(at_port, count);
+				match.patterns = engine.hit;
+			}
+			else
+			{
+				for(part = 0; part < 2; part++)
+				{
+					used = response_matcher_feed(&engine.matcher, span.data[part], span.length[part],
+							cmd->expect | cmd->fail, &match);
+
+					/*Bytes after the reply stay in the buffer*/
+					buffer_consume(at_port, used);
+
+					if(match.patterns != 0)
+					{
+						break;
+					}
+				}
+			}
+
+			if(match.patterns & cmd->expect)
+			{
+				/*Lowest reply number wins if several ended on the same byte*/
+				at_finish(AT_DONE, __builtin_ctz(match.patterns & cmd->expect));
+			}
+			else if((match.patterns != 0) || deadline_passed(engine.deadline))
+			{
+				if(engine.attempt < cmd->retries)
+				{
+					engine.attempt++;
+					engine.deadline = get_tick() + cmd->retry_delay_ms;
+					engine.state = AT_RETRY_DELAY;
+				}
+				else if(match.patterns != 0)
+				{
+					at_finish(AT_FAILED, __builtin_ctz(match.patterns));
+				}
+				else
+				{
+					at_finish(AT_TIMEOUT, AT_NO_REPLY);
+				}
+			}
+			break;
+
+		case AT_RETRY_DELAY:
+			if(deadline_passed(engine.deadline))
+			{
+				engine.state = AT_SEND;
+			}
+			break;
+
+		case AT_IDLE:
+		default:
+			break;
+	}
+}
+
+
+/*Report the outcome of the command at the queue head and move on to the next one*/
+static void at_finish(atResult result, uint32_t reply)
+{
+	at_command cmd = engine.queue[engine.tail];
+
+	engine.tail = (engine.tail + 1) % AT_QUEUE_SZ;
+	engine.last_result = result;
+
+	/*The following commands depend on this one, drop them*/
+	if(result != AT_DONE)
+	{
+		while(engine.tail != engine.head)
+		{
+			at_command *dropped = &engine.queue[engine.tail];
+
+			engine.tail = (engine.tail + 1) % AT_QUEUE_SZ;
+
+			if(dropped->callback != 0)
+			{
+				dropped->callback(dropped->ctx, AT_ABORTED, AT_NO_REPLY);
+			}
+		}
+	}
+
+	engine.attempt = 0;
+	engine.state = (engine.tail != engine.head) ? AT_SEND : AT_IDLE;
+
+	/*The callback may submit the next command*/
+	if(cmd.callback != 0)
+	{
+		cmd.callback(cmd.ctx, result, reply);
+	}
+}
@@ -0,0 +1,220 @@
+/*
+ * File : boot_control.c
+ * Author : Prudhvi Raj Belide
+ * Description : This file selects the application slot to boot. A new image is downloaded into the inactive slot
+ * and put on trial with one record write. It has BOOT_TRIAL_ATTEMPTS boots to confirm itself through the RTC backup
+ * register, after that the bootloader makes it active or rolls back to the previous slot.
+ */
+
+#include "boot_control.h"
+#include "nvm_store.h"
+#include "fota_processor.h"
+#include "image_header.h"
+
+#define BOOT_SLOT_BIT(slot)		(1U << (slot))
+
+static boot_control control;
+
+static const uint32_t slot_address[NUM_OF_BOOT_SLOTS] = {BOOT_SLOT_A_ADDRESS, BOOT_SLOT_B_ADDRESS};
+static const uint32_t slot_size[NUM_OF_BOOT_SLOTS]    = {BOOT_SLOT_A_SIZE, BOOT_SLOT_B_SIZE};
+static const char * const slot_file[NUM_OF_BOOT_SLOTS] = {BOOT_SLOT_A_FILE, BOOT_SLOT_B_FILE};
+static const char * const slot_manifest[NUM_OF_BOOT_SLOTS] = {BOOT_SLOT_A_MANIFEST, BOOT_SLOT_B_MANIFEST};
+
+static StatusTypeDef boot_control_save(void);
+static void backup_access_enable(void);
+
+
+void boot_control_init(void)
+{
+	if((nvm_read(NVM_KEY_BOOT_CONTROL, &control, sizeof(control)) != sizeof(control)) ||
+	   (control.active >= NUM_OF_BOOT_SLOTS) ||
+	   ((control.trial != BOOT_SLOT_NONE) && (control.trial >= NUM_OF_BOOT_SLOTS)))
+	{
+		/*No record yet, whatever is in slot A boots*/
+		control.active   = BOOT_SLOT_A;
+		control.trial    = BOOT_SLOT_NONE;
+		control.attempts = 0;
+		control.valid    = BOOT_SLOT_BIT(BOOT_SLOT_A);
+		control.verified[BOOT_SLOT_A] = 0;
+		control.verified[BOOT_SLOT_B] = 0;
+	}
+
+	backup_access_enable();
+}
+
+
+const boot_control *boot_control_get(void)
+{
+	return &control;
+}
+
+
+/*Slot an update is downloaded into*/
+uint8_t boot_inactive_slot(void)
+{
+	return (control.active == BOOT_SLOT_A) ? BOOT_SLOT_B : BOOT_SLOT_A;
+}
+
+
+uint32_t boot_slot_address(uint8_t slot)
+{
+	return slot_address[slot];
+}
+
+
+uint32_t boot_slot_size(uint8_t slot)
+{
+	return slot_size[slot];
+}
+
+
+const char *boot_slot_file(uint8_t slot)
+{
+	return slot_file[slot];
+}
+
+
+const char *boot_slot_manifest(uint8_t slot)
+{
+	return slot_manifest[slot];
+}
+
+
+/*Fast path for every boot: check the header and skip the payload CRC if this image passed it before*/
+uint8_t boot_image_valid(uint8_t slot)
+{
+	if(image_header_check(slot_address[slot], slot_size[slot]) != DEV_OK)
+	{
+		return 0;
+	}
+
+	if((control.verified[slot] != 0) && (control.verified[slot] == image_get_header(slot_address[slot])->header_crc))
+	{
+		return 1;
+	}
+
+	return boot_image_verify(slot);
+}
+
+
+/*Full check of a slot, the result is stored so the next boots take the fast path*/
+uint8_t boot_image_verify(uint8_t slot)
+{
+	if((image_header_check(slot_address[slot], slot_size[slot]) != DEV_OK) ||
+	   (image_verify_payload(slot_address[slot]) != DEV_OK))
+	{
+		return 0;
+	}
+
+	control.verified[slot] = image_get_header(slot_address[slot])->header_crc;
+	boot_control_save();
+
+	return 1;
+}
+
+
+/*Take a slot out of the selection before it is overwritten or once it turned out empty*/
+StatusTypeDef boot_control_invalidate(uint8_t slot)
+{
+	control.valid &= ~BOOT_SLOT_BIT(slot);
+	control.verified[slot] = 0;
+
+	if(control.trial == slot)
+	{
+		control.trial    = BOOT_SLOT_NONE;
+		control.attempts = 0;
+	}
+
+	return boot_control_save();
+}
+
+
+/*Put a verified image on trial. This single record write is the switch, until it lands the old slot stays active*/
+StatusTypeDef boot_control_set_trial(uint8_t slot)
+{
+	control.trial    = slot;
+	control.attempts = BOOT_TRIAL_ATTEMPTS;
+	control.valid   &= ~BOOT_SLOT_BIT(slot);
+
+	/*A confirmation left by the running application must not count for the new image*/
+	RTC->BKP0R = 0;
+
+	return boot_control_save();
+}
+
+
+/*Decide which slot boots now, called once per reset*/
+uint8_t boot_select_slot(void)
+{
+	if(control.trial == BOOT_SLOT_NONE)
+	{
+		return control.active;
+	}
+
+	if(RTC->BKP0R == BOOT_CONFIRM_MAGIC)
+	{
+		/*The image on trial confirmed itself, make it active*/
+		control.active   = control.trial;
+		control.valid   |= BOOT_SLOT_BIT(control.trial);
+		control.trial    = BOOT_SLOT_NONE;
+		control.attempts = 0;
+		RTC->BKP0R = 0;
+		boot_control_save();
+
+		return control.active;
+	}
+
+	if(control.attempts != 0)
+	{
+		/*Give the image another boot, it has to confirm again*/
+		control.attempts--;
+		RTC->BKP0R = 0;
+		boot_control_save();
+
+		return control.trial;
+	}
+
+	/*Out of attempts without a confirmation, roll back*/
+	control.trial = BOOT_SLOT_NONE;
+	boot_control_save();
+
+	return control.active;
+}
+
+
+void boot_start_application(void)
+{
+	uint8_t slot = boot_select_slot();
+
+	if(!boot_image_valid(slot))
+	{
+		/*Selected image is missing or damaged, boot the other one if it checks out*/
+		boot_control_invalidate(slot);
+		slot ^= 1U;
+
+		if(!boot_image_valid(slot))
+		{
+			/*Nothing to start, stay in the bootloader*/
+			return;
+		}
+
+		control.active = slot;
+		boot_control_save();
+	}
+
+	jump_to_app(slot_address[slot] + IMAGE_HEADER_SZ);
+}
+
+
+static StatusTypeDef boot_control_save(void)
+{
+	return nvm_write(NVM_KEY_BOOT_CONTROL, &control, sizeof(control));
+}
+
+
+/*The confirmation lives in RTC->BKP0R, which keeps its value across resets*/
+static void backup_access_enable(void)
+{
+	RCC->APB1ENR |= RCC_APB1ENR_PWREN;
+	PWR->CR |= PWR_CR_DBP;
+}
@@ -0,0 +1,233 @@
+/*
+ * File : chunk_index.c
+ * Author : Prudhvi Raj Belide
+ * Description : This file cuts an image into content-defined chunks with a gear rolling hash, so an insertion only
+ * moves the boundaries next to it, and matches the chunk manifest of a new image against them and against the flash
+ * it is written to. The manifest is read as it streams in, only the plan of where each chunk comes from is kept.
+ */
+
+#include <string.h>
+#include "chunk_index.h"
+#include "sha256.h"
+
+/*One random word per byte value, generated once*/
+static uint32_t chunk_gear[256];
+static uint8_t chunk_gear_ready;
+
+static void chunk_gear_init(void);
+static uint32_t chunk_length(const uint8_t *data, uint32_t length);
+static uint32_t chunk_word(const uint8_t *bytes);
+static void chunk_record(chunk_manifest *manifest);
+
+
+/*Cut the base image into chunks and hash each of them*/
+StatusTypeDef chunk_index_build(chunk_index *index, const uint8_t *base, uint32_t size)
+{
+	sha256_context ctx;
+	uint8_t digest[SHA256_DIGEST_SZ];
+	uint32_t offset = 0;
+	uint32_t length;
+
+	index->base  = base;
+	index->count = 0;
+
+	chunk_gear_init();
+
+	while(offset < size)
+	{
+		if(index->count == CHUNK_MAX_NUM)
+		{
+			index->count = 0;
+			return DEV_ERROR;
+		}
+
+		length = chunk_length(base + offset, size - offset);
+
+		sha256_init(&ctx);
+		sha256_update(&ctx, base + offset, length);
+		sha256_final(&ctx, digest);
+
+		index->chunk[index->count].offset = offset;
+		memcpy(index->chunk[index->count].hash, digest, CHUNK_HASH_SZ);
+		index->count++;
+
+		offset += length;
+	}
+
+	index->chunk[index->count].offset = size;
+
+	return DEV_OK;
+}
+
+
+void chunk_manifest_init(chunk_manifest *manifest, const chunk_index *index, const uint8_t *target, uint32_t target_size)
+{
+	manifest->index       = index;
+	manifest->target      = target;
+	manifest->target_size = target_size;
+	manifest->image_size  = 0;
+	manifest->count       = 0;
+	manifest->parsed      = 0;
+	manifest->total       = 0;
+	manifest->present     = 0;
+	manifest->in_place    = 0;
+	manifest->fill        = 0;
+	manifest->status      = DEV_OK;
+}
+
+
+/*Read the manifest as it arrives: the first record is the manifest header, the others describe one chunk each*/
+void chunk_manifest_feed(chunk_manifest *manifest, const uint8_t *data, uint32_t length)
+{
+	while((length != 0) && (manifest->status == DEV_OK))
+	{
+		manifest->record[manifest->fill++] = *data++;
+		length--;
+
+		if(manifest->fill == CHUNK_RECORD_SZ)
+		{
+			manifest->fill = 0;
+			chunk_record(manifest);
+		}
+	}
+}
+
+
+StatusTypeDef chunk_manifest_finish(const chunk_manifest *manifest)
+{
+	if((manifest->status != DEV_OK) || (manifest->count == 0) || (manifest->parsed != (manifest->count + 1)) ||
+	   (manifest->total != manifest->image_size))
+	{
+		return DEV_ERROR;
+	}
+
+	return DEV_OK;
+}
+
+
+/*xorshift32, Tools/fw_manifest.py builds the same table*/
+static void chunk_gear_init(void)
+{
+	uint32_t x = CHUNK_GEAR_SEED;
+	uint32_t i;
+
+	if(chunk_gear_ready)
+	{
+		return;
+	}
+
+	for(i = 0; i < 256; i++)
+	{
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		chunk_gear[i] = x;
+	}
+
+	chunk_gear_ready = 1;
+}
+
+
+/*Length of the chunk starting at data. The hash only depends on the last 32 bytes, so boundaries follow content*/
+static uint32_t chunk_length(const uint8_t *data, uint32_t length)
+{
+	uint32_t hash = 0;
+	uint32_t i;
+
+	if(length <= CHUNK_MIN_SZ)
+	{
+		return length;
+	}
+
+	if(length > CHUNK_MAX_SZ)
+	{
+		length = CHUNK_MAX_SZ;
+	}
+
+	/*Only the last 32 bytes count, start hashing there*/
+	for(i = CHUNK_MIN_SZ - 32; i < length; i++)
+	{
+		hash = (hash << 1) + chunk_gear[data[i]];
+
+		if((i >= (CHUNK_MIN_SZ - 1)) && ((hash & CHUNK_MASK) == 0))
+		{
+			return i + 1;
+		}
+	}
+
+	return length;
+}
+
+
+static uint32_t chunk_word(const uint8_t *bytes)
+{
+	return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+
+static void chunk_record(chunk_manifest *manifest)
+{
+	const chunk_index *index = manifest->index;
+	sha256_context ctx;
+	uint8_t digest[SHA256_DIGEST_SZ];
+	chunk_plan *plan;
+	uint32_t length;
+	uint32_t i;
+
+	if(manifest->parsed == 0)
+	{
+		manifest->image_size = chunk_word(&manifest->record[4]);
+		manifest->count      = chunk_word(&manifest->record[8]);
+
+		if((chunk_word(manifest->record) != CHUNK_MANIFEST_MAGIC) || (manifest->count > CHUNK_MAX_NUM))
+		{
+			manifest->status = DEV_ERROR;
+		}
+
+		manifest->parsed++;
+		return;
+	}
+
+	length = chunk_word(manifest->record);
+
+	if((manifest->parsed > manifest->count) || (length == 0) || (length > CHUNK_MAX_SZ))
+	{
+		manifest->status = DEV_ERROR;
+		return;
+	}
+
+	plan = &manifest->plan[manifest->parsed - 1];
+	plan->length   = (uint16_t)length;
+	plan->local    = CHUNK_MISSING;
+	plan->in_place = 0;
+
+	/*The chunk starts where the ones before it end, hash what the target holds there*/
+	if((manifest->target != 0) && (length <= manifest->target_size) &&
+	   (manifest->total <= (manifest->target_size - length)))
+	{
+		sha256_init(&ctx);
+		sha256_update(&ctx, manifest->target + manifest->total, length);
+		sha256_final(&ctx, digest);
+
+		if(memcmp(digest, &manifest->record[4], CHUNK_HASH_SZ) == 0)
+		{
+			plan->in_place = 1;
+			manifest->in_place += length;
+		}
+	}
+
+	/*A linear search is fine, the lists are short and this runs once per chunk*/
+	for(i = 0; i < index->count; i++)
+	{
+		if(((index->chunk[i + 1].offset - index->chunk[i].offset) == length) &&
+		   (memcmp(index->chunk[i].hash, &manifest->record[4], CHUNK_HASH_SZ) == 0))
+		{
+			plan->local = (uint16_t)i;
+			manifest->present += length;
+			break;
+		}
+	}
+
+	manifest->total += length;
+	manifest->parsed++;
+}
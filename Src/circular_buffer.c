@@ -7,82 +7,98 @@
  */
 
 #include "circular_buffer.h"
+#include "ram_exec.h"
 #include <string.h>
 
 #define CR1_RXNEIE		(1U<<5)
 #define CR1_TXEIE		(1U<<7)
+#define CR1_IDLEIE		(1U<<4)
 
 #define SR_RXNE		(1U<<5)
 #define SR_TXE		(1U<<7)
-
-//portType debug_port = 0;
-//portType slave_dev_port = 1;
+#define SR_IDLE		(1U<<4)
 
 
 /*Buffer for Slave Device UART*/
-circular_buffer rx_buffer1 = {{INIT_VAL}, INIT_VAL,INIT_VAL}; //RX Buffer for Slave Device
-circular_buffer tx_buffer1 = {{INIT_VAL}, INIT_VAL,INIT_VAL}; //TX Buffer for Slave Device
+RING_BUFFER_DEFINE(rx_buffer1, ESP_RX_BUFFER_SIZE);		//RX Buffer for Slave Device
+RING_BUFFER_DEFINE(tx_buffer1, ESP_TX_BUFFER_SIZE);		//TX Buffer for Slave Device
 
 /*Buffer for Debug  UART*/
-circular_buffer rx_buffer2 = {{INIT_VAL}, INIT_VAL,INIT_VAL}; //RX Buffer for Debug
-circular_buffer tx_buffer2 = {{INIT_VAL}, INIT_VAL,INIT_VAL}; //TX Buffer for Debug
+RING_BUFFER_DEFINE(rx_buffer2, DEBUG_RX_BUFFER_SIZE);	//RX Buffer for Debug
+RING_BUFFER_DEFINE(tx_buffer2, DEBUG_TX_BUFFER_SIZE);	//TX Buffer for Debug
 
-/*Define pointers to the buffers*/
-circular_buffer * _rx_buffer1;
-circular_buffer * _tx_buffer1;
-circular_buffer * _rx_buffer2;
-circular_buffer * _tx_buffer2;
+/*Buffers by port, kept out of .rodata so the RAM resident ISRs never read flash*/
+static ring_buffer *rx_ring[NUM_OF_PORTS] = {&rx_buffer2, &rx_buffer1};
+static ring_buffer *tx_ring[NUM_OF_PORTS] = {&tx_buffer2, &tx_buffer1};
+static USART_TypeDef *port_uart[NUM_OF_PORTS] = {USART2, USART1};
 
+/*Set when received bytes were lost because the consumer fell a whole buffer behind, cleared by buffer_clear()*/
+static __IO uint8_t rx_overrun[NUM_OF_PORTS];
 
-void circular_buffer_init(void)
+#ifdef ESP_UART_RX_DMA
+/*Bytes the RX DMA has written, free running like the ring counters. Can run ahead of the ring head on overrun*/
+static __IO uint32_t rx_dma_written;
+#endif
+
+#ifdef UART_TX_DMA
+#define TX_SEGMENT_QUEUE_SZ		16
+#define TX_DMA_MAX_LEN			0xFFFFU		/*NDTR is 16 bits wide*/
+
+typedef struct
 {
-	/*Init buff pointers*/
-	_rx_buffer1 =  &rx_buffer1;
-	_rx_buffer2 =  &rx_buffer2;
+	const unsigned char *data;
+	uint32_t length;
+	uint8_t from_ring;		/*Segment lives in the TX buffer and frees its space once sent*/
 
-	_tx_buffer1 =  &tx_buffer1;
-	_tx_buffer2 =  &tx_buffer2;
+}tx_segment;
 
-	/*Initial RX interrupt*/
-	USART1->CR1 |=CR1_RXNEIE;
-	USART2->CR1 |=CR1_RXNEIE;
+typedef struct
+{
+	tx_segment segment[TX_SEGMENT_QUEUE_SZ];
+	__IO uint32_t head;		/*Next free slot*/
+	__IO uint32_t tail;		/*Segment being sent*/
+	__IO uint8_t busy;		/*DMA transfer running*/
 
-}
+}tx_queue;
 
+/*Segments waiting for DMA, in the order they were written*/
+static tx_queue tx_queues[NUM_OF_PORTS];
 
-static void buff_store_char(unsigned char c, circular_buffer * buffer)
-{
-	int loc =  (uint32_t)(buffer->head +1 )% UART_BUFFER_SIZE;
+static void tx_queue_segment(portType uart, const unsigned char *data, uint32_t length, uint8_t from_ring);
+static void tx_ring_write(portType uart, const unsigned char *data, uint32_t length);
+#endif
 
-	/*Check if no overflow will occur*/
-	if( loc != buffer->tail)
-	{
-		/*Store character*/
-		buffer->buffer[buffer->head] = c;
 
-		/*Update head*/
-		buffer->head =  loc;
-	}
+void circular_buffer_init(void)
+{
+	/*Initial RX interrupt*/
+#ifdef ESP_UART_RX_DMA
+	esp_uart_rx_dma_init(rx_buffer1.storage, ring_capacity(&rx_buffer1));
+#else
+	USART1->CR1 |=CR1_RXNEIE;
+#endif
+	USART2->CR1 |=CR1_RXNEIE;
+
+#ifdef UART_TX_DMA
+	esp_uart_tx_dma_init();
+	debug_uart_tx_dma_init();
+#endif
 }
 
 
 void buffer_clear(portType uart)
 {
-	switch(uart){
-
-		case SLAVE_DEV_PORT:
-			/*Set content to '\0'*/
-			memset(_rx_buffer1->buffer,'\0', UART_BUFFER_SIZE);
-			_rx_buffer1->head = 0;
-			break;
-		case DEBUG_PORT:
-			/*Set content to '\0'*/
-			memset(_rx_buffer2->buffer,'\0', UART_BUFFER_SIZE);
-			_rx_buffer2->head = 0;
-			break;
+	ring_buffer *ring = rx_ring[uart];
 
-	}
+	/*Drop everything received so far*/
+	ring_consume(ring, ring_count(ring));
+	rx_overrun[uart] = 0;
+}
 
+/*Received bytes were lost since the last buffer_clear(), what is in the buffer can not be trusted*/
+uint8_t buffer_rx_overrun(portType uart)
+{
+	return rx_overrun[uart];
 }
 
 /*Check the next value in the buffer
@@ -90,39 +106,7 @@ void buffer_clear(portType uart)
 
 int buffer_peek(portType uart)
 {
-
-
-	switch(uart)
-	{
-		case SLAVE_DEV_PORT:
-			if(_rx_buffer1->head  == _rx_buffer1->tail )
-			{
-				/*Return error*/
-				return -1;
-			}
-			else
-			{
-				return _rx_buffer1->buffer[_rx_buffer1->tail];
-			}
-			break;
-
-     case DEBUG_PORT:
-			if(_rx_buffer2->head  == _rx_buffer2->tail )
-			{
-				/*Return error*/
-				return -1;
-			}
-			else
-			{
-				return _rx_buffer2->buffer[_rx_buffer2->tail];
-			}
-			 break;
-
-
-      default:
-		return -1;
-	}
-
+	return ring_peek(rx_ring[uart]);
 }
 
 /*Function to read(and remove) the next value
@@ -130,305 +114,295 @@ int buffer_peek(portType uart)
 
 int buffer_read(portType uart)
 {
+	return ring_get(rx_ring[uart]);
+}
 
-	int ret;
-
-	switch(uart){
-	case SLAVE_DEV_PORT:
-
-		if(_rx_buffer1->head  == _rx_buffer1->tail )
-		{
-			/*Return error*/
-			ret = -1;
-		}
-		else
-		{
-			unsigned char c =  _rx_buffer1->buffer[_rx_buffer1->tail];
-			_rx_buffer1->tail =  (uint32_t)(_rx_buffer1->tail + 1)%UART_BUFFER_SIZE;
-			ret =  c;
-		}
-		break;
-
-    case DEBUG_PORT:
-		if(_rx_buffer2->head  == _rx_buffer2->tail )
-		{
-			/*Return error*/
-			ret = -1;
-		}
-		else
-		{
-			unsigned char c =  _rx_buffer2->buffer[_rx_buffer2->tail];
-			_rx_buffer2->tail =  (uint32_t)(_rx_buffer2->tail + 1)%UART_BUFFER_SIZE;
-			ret = c;
-		}
-
-	  break;
-
-    default:
-		ret = -1;
-		break;
-	}
+/*Function to get the received data in place as up to two contiguous regions.
+ *Call buffer_consume() once the data has been used*/
+uint32_t buffer_peek_contiguous(portType uart, ring_span *span)
+{
+	return ring_peek_contiguous(rx_ring[uart], span);
+}
 
-	return ret;
+void buffer_consume(portType uart, uint32_t count)
+{
+	ring_consume(rx_ring[uart], count);
 }
 
 
 void buffer_write(unsigned char c, portType uart)
 {
-
-	int loc;
-
-	switch(uart){
-
-	case SLAVE_DEV_PORT:
-
-		 loc =  (uint32_t)(_tx_buffer1->head + 1)%UART_BUFFER_SIZE;
-
-		while(loc ==  _tx_buffer1->tail){}
-		_tx_buffer1->buffer[_tx_buffer1->head] = c;
-		_tx_buffer1->head = loc;
-
-		/*Initial TX interrupt*/
-		USART1->CR1 |=CR1_TXEIE;
-	break;
-
-    case DEBUG_PORT:
-
-		 loc =  (uint32_t)(_tx_buffer2->head + 1)%UART_BUFFER_SIZE;
-
-		while(loc ==  _tx_buffer2->tail){}
-		_tx_buffer2->buffer[_tx_buffer2->head] = c;
-		_tx_buffer2->head = loc;
-
-		/*Initial TX interrupt*/
-		USART2->CR1 |=CR1_TXEIE;
-
-	break;
-
-    default:
-    	break;
-	}
+#ifdef UART_TX_DMA
+	tx_ring_write(uart, &c, 1);
+#else
+	/*Wait for room in the buffer*/
+	while(!ring_put(tx_ring[uart], c)){}
+
+	/*Initial TX interrupt*/
+	port_uart[uart]->CR1 |=CR1_TXEIE;
+#endif
 }
 
 /*Function to check if there is data in the buffer*/
 int is_data(portType uart)
 {
-	int ret;
-	switch(uart)
-	{
-	case  SLAVE_DEV_PORT:
-	      ret = (uint32_t)(UART_BUFFER_SIZE +  _rx_buffer1->head -  _rx_buffer1->tail)%UART_BUFFER_SIZE;
-	      break;
-
-	case  DEBUG_PORT:
-	      ret =  (uint32_t)(UART_BUFFER_SIZE +  _rx_buffer2->head -  _rx_buffer2->tail)%UART_BUFFER_SIZE;
-	      break;
-	default:
-		break;
-	}
-
-	return ret;
-
+	return (int)ring_count(rx_ring[uart]);
 }
 
-/*Get first character of a specified string from buffer*/
-static void get_first_char(char *str)
+/*Function to send a string to the buffer*/
+void buffer_send_string(const char *s,portType uart)
 {
-	/*Make sure there is data in the buffer*/
-	while(!is_data(SLAVE_DEV_PORT)){}
-
-	while(buffer_peek(SLAVE_DEV_PORT) != str[0])
+#ifdef UART_TX_DMA
+	tx_ring_write(uart, (const unsigned char *)s, strlen(s));
+#else
+	while( *s != '\0')
 	{
-		_rx_buffer1->tail =  (uint16_t)(_rx_buffer1->tail +1)%UART_BUFFER_SIZE;
-
-		while(!is_data(SLAVE_DEV_PORT)){}
+		buffer_write(*s++,uart);
 	}
+#endif
 }
 
-/*Function to check if a certain response is present in the buffer*/
-
-int is_response(char *str)
+/*Function to send a block in place without copying it into the buffer.
+ *The block must stay valid until it has been sent, e.g. a constant string*/
+void buffer_send_block(const void *data, uint32_t length, portType uart)
 {
-	int curr_pos = 0;
-	int len =  strlen(str);
+#ifdef UART_TX_DMA
+	tx_queue_segment(uart, data, length, 0);
+#else
+	const unsigned char *p = data;
 
-	while(curr_pos != len)
+	while(length--)
 	{
-		 curr_pos = 0;
-		 get_first_char(str);
-
-		 while(buffer_peek(SLAVE_DEV_PORT) == str[curr_pos])
-		 {
-			 curr_pos++;
-			 buffer_read(SLAVE_DEV_PORT);
-			 if(curr_pos ==  len)
-			 {
-				 /*Success*/
-				 return 1;
-			 }
-
-			 while(!is_data(SLAVE_DEV_PORT)){}
-		 }
-
+		buffer_write(*p++,uart);
 	}
-	return -1;
+#endif
 }
 
-
-/*Function to get specified number of characters from buffer*/
-void get_strs(uint8_t num_of_chars,char *dest_buffer)
+#ifdef UART_TX_DMA
+/*Start the DMA on the oldest queued segment, called with interrupts disabled or from the DMA ISR*/
+RAM_FUNC static void tx_start_next(portType uart)
 {
+	tx_queue *queue = &tx_queues[uart];
+	tx_segment *seg;
 
-	for( int indx = 0; indx < num_of_chars; indx++  )
+	if(queue->head == queue->tail)
 	{
-		for(int i =0; i < 9000; i++){}
+		queue->busy = 0;
+		return;
+	}
+
+	seg = &queue->segment[queue->tail];
+	queue->busy = 1;
 
-		dest_buffer[indx] =  buffer_read(SLAVE_DEV_PORT);
+	if(uart == SLAVE_DEV_PORT)
+	{
+		esp_uart_tx_dma_start(seg->data, seg->length);
+	}
+	else
+	{
+		debug_uart_tx_dma_start(seg->data, seg->length);
 	}
 }
 
-/*Function to send a string to the buffer*/
-void buffer_send_string(const char *s,portType uart)
+/*Called from the DMA ISR when a segment has been sent*/
+RAM_FUNC static void tx_complete(portType uart)
 {
-	while( *s != '\0')
+	tx_queue *queue = &tx_queues[uart];
+	tx_segment *seg = &queue->segment[queue->tail];
+
+	/*Release the space of a buffered segment*/
+	if(seg->from_ring)
 	{
-		buffer_write(*s++,uart);
+		ring_consume(tx_ring[uart], seg->length);
 	}
+
+	queue->tail = (queue->tail + 1) % TX_SEGMENT_QUEUE_SZ;
+
+	/*Chain the next segment*/
+	tx_start_next(uart);
 }
 
-void slave_dev_uart_callback(void)
+static void tx_queue_segment(portType uart, const unsigned char *data, uint32_t length, uint8_t from_ring)
 {
-	/*Check if RXNE is raised and RXNEIE is enabled*/
-	if(((USART1->SR & SR_RXNE ) != 0) &&((USART1->CR1 & CR1_RXNEIE) !=0))
-	{
-	  unsigned char c =  USART1->DR;
-	  buff_store_char(c,_rx_buffer1);
-	}
+	tx_queue *queue = &tx_queues[uart];
+	uint32_t last;
+	uint32_t chunk;
 
-	/*Check if TXE is raised and TXEIE is enabled*/
-	if(((USART1->SR & SR_TXE ) != 0) &&((USART1->CR1 & CR1_TXEIE) !=0))
+	while(length != 0)
 	{
-		if(tx_buffer1.head == tx_buffer1.tail)
+		chunk = (length > TX_DMA_MAX_LEN) ? TX_DMA_MAX_LEN : length;
+
+		__disable_irq();
+
+		last = (queue->head + TX_SEGMENT_QUEUE_SZ - 1) % TX_SEGMENT_QUEUE_SZ;
+
+		/*Grow the last buffered segment if the new bytes follow it and it is not being sent yet*/
+		if(from_ring && (queue->head != queue->tail) && !(queue->busy && (last == queue->tail)) &&
+		   queue->segment[last].from_ring && ((queue->segment[last].data + queue->segment[last].length) == data) &&
+		   ((queue->segment[last].length + chunk) <= TX_DMA_MAX_LEN))
 		{
-			USART1->CR1 &= ~CR1_TXEIE;
+			queue->segment[last].length += chunk;
 		}
 		else
 		{
-			/*Get character from buffer*/
-			unsigned char c =  tx_buffer1.buffer[tx_buffer1.tail];
+			/*Wait for a free slot, the DMA ISR needs to run to release one*/
+			while(((queue->head + 1) % TX_SEGMENT_QUEUE_SZ) == queue->tail)
+			{
+				__enable_irq();
+				__disable_irq();
+			}
 
-			/*Update position*/
-			tx_buffer1.tail =  (uint32_t)(tx_buffer1.tail +1)%UART_BUFFER_SIZE;
+			queue->segment[queue->head].data = data;
+			queue->segment[queue->head].length = chunk;
+			queue->segment[queue->head].from_ring = from_ring;
+			queue->head = (queue->head + 1) % TX_SEGMENT_QUEUE_SZ;
+		}
 
-			/*Transmit character*/
-			USART1->DR =  c;
+		if(!queue->busy)
+		{
+			tx_start_next(uart);
 		}
-	}
 
+		__enable_irq();
 
+		data   += chunk;
+		length -= chunk;
+	}
 }
 
-
-void debug_uart_callback(void)
+/*Copy bytes into the TX buffer and queue them as contiguous segments*/
+static void tx_ring_write(portType uart, const unsigned char *data, uint32_t length)
 {
-	/*Check if RXNE is raised and RXNEIE is enabled*/
-	if(((USART2->SR & SR_RXNE ) != 0) &&((USART2->CR1 & CR1_RXNEIE) !=0))
-	{
-	  unsigned char c =  USART2->DR;
-	  buff_store_char(c,_rx_buffer2);
-	}
+	ring_buffer *ring = tx_ring[uart];
+	ring_span span;
+	uint32_t chunk;
 
-	/*Check if TXE is raised and TXEIE is enabled*/
-	if(((USART2->SR & SR_TXE ) != 0) &&((USART2->CR1 & CR1_TXEIE) !=0))
+	while(length != 0)
 	{
-		if(tx_buffer2.head == tx_buffer2.tail)
-		{
-			USART2->CR1 &= ~CR1_TXEIE;
-		}
-		else
-		{
-			/*Get character from buffer*/
-			unsigned char c =  tx_buffer2.buffer[tx_buffer2.tail];
+		/*Wait for room in the buffer*/
+		while(ring_space(ring) == 0){}
 
-			/*Update position*/
-			tx_buffer2.tail =  (uint32_t)(tx_buffer2.tail +1)%UART_BUFFER_SIZE;
+		/*Fill the region up to the wrap, the rest goes in the next pass*/
+		ring_peek_free(ring, &span);
+		chunk = (span.length[0] < length) ? span.length[0] : length;
 
-			/*Transmit character*/
-			USART2->DR =  c;
-		}
-	}
+		memcpy(span.data[0], data, chunk);
+		ring_commit(ring, chunk);
 
+		tx_queue_segment(uart, span.data[0], chunk, 1);
 
+		data   += chunk;
+		length -= chunk;
+	}
 }
 
+RAM_FUNC void DMA2_Stream7_IRQHandler(void)
+{
+	esp_uart_tx_dma_clear_flags();
+	tx_complete(SLAVE_DEV_PORT);
+}
 
-
-
-static int8_t process_copy(char * str, char * dest_buffer, int start_pos)
+RAM_FUNC void DMA1_Stream6_IRQHandler(void)
 {
-	int curr_pos = 0;
-	int len =  strlen(str);
-	int indx = start_pos;
+	debug_uart_tx_dma_clear_flags();
+	tx_complete(DEBUG_PORT);
+}
+#endif
 
-	while(!is_data(SLAVE_DEV_PORT)){}
+/*Common RX/TX interrupt handling of both uarts*/
+RAM_FUNC static void uart_callback(portType uart)
+{
+	USART_TypeDef *usart = port_uart[uart];
+	int c;
 
-	while(buffer_peek(SLAVE_DEV_PORT) != str[curr_pos] )
+	/*Check if RXNE is raised and RXNEIE is enabled*/
+	if(((usart->SR & SR_RXNE ) != 0) &&((usart->CR1 & CR1_RXNEIE) !=0))
 	{
-		dest_buffer[indx] =  _rx_buffer1->buffer[_rx_buffer1->tail];
-		_rx_buffer1->tail =  (uint16_t)(_rx_buffer1->tail + 1) % UART_BUFFER_SIZE;
-		indx++;
-
-		while(!is_data(SLAVE_DEV_PORT)){}
-
-
+		/*The byte is dropped if the buffer is full*/
+		if(!ring_put(rx_ring[uart], (uint8_t)usart->DR))
+		{
+			rx_overrun[uart] = 1;
+		}
 	}
 
-	while(buffer_peek(SLAVE_DEV_PORT) == str[curr_pos])
+	/*Check if TXE is raised and TXEIE is enabled*/
+	if(((usart->SR & SR_TXE ) != 0) &&((usart->CR1 & CR1_TXEIE) !=0))
 	{
-		curr_pos++;
-		dest_buffer[indx++] = buffer_read(SLAVE_DEV_PORT);
-
-		if(curr_pos == len){
+		/*Get character from buffer*/
+		c = ring_get(tx_ring[uart]);
 
-			return 1;
+		if(c < 0)
+		{
+			usart->CR1 &= ~CR1_TXEIE;
+		}
+		else
+		{
+			/*Transmit character*/
+			usart->DR = (uint8_t)c;
 		}
-
-		while(!is_data(SLAVE_DEV_PORT)){}
-
 	}
+}
 
-	if(curr_pos != len)
-	{
-		curr_pos = 0;
+#ifdef ESP_UART_RX_DMA
+/*Move head up to the byte the DMA will write next. The half and full transfer interrupts run at least twice per
+ *lap, so the distance to the DMA position is never more than one lap*/
+RAM_FUNC static void slave_dev_rx_dma_update(void)
+{
+	uint32_t pos = esp_uart_rx_dma_position(ring_capacity(&rx_buffer1));
+	uint32_t limit;
 
-		process_copy(str, dest_buffer, indx);
+	rx_dma_written += (pos - rx_dma_written) & rx_buffer1.mask;
 
-	}
+	/*The DMA wrote over bytes not read yet, never publish more than a full buffer*/
+	limit = rx_buffer1.tail + ring_capacity(&rx_buffer1);
 
-	if(curr_pos  ==  len)
+	if((int32_t)(rx_dma_written - limit) > 0)
 	{
-		return 1;
+		rx_overrun[SLAVE_DEV_PORT] = 1;
+		ring_commit(&rx_buffer1, limit - rx_buffer1.head);
 	}
 	else
 	{
-		return -1;
+		ring_commit(&rx_buffer1, rx_dma_written - rx_buffer1.head);
 	}
+}
 
+RAM_FUNC void DMA2_Stream2_IRQHandler(void)
+{
+	/*Half transfer or transfer complete*/
+	esp_uart_rx_dma_clear_flags();
+	slave_dev_rx_dma_update();
+}
+#endif
 
+RAM_FUNC void slave_dev_uart_callback(void)
+{
+	uart_callback(SLAVE_DEV_PORT);
 
+#ifdef ESP_UART_RX_DMA
+	/*Check if IDLE is raised and IDLEIE is enabled*/
+	if(((USART1->SR & SR_IDLE ) != 0) &&((USART1->CR1 & CR1_IDLEIE) !=0))
+	{
+		/*Clear IDLE by reading SR followed by DR*/
+		(void)USART1->DR;
+		slave_dev_rx_dma_update();
+	}
+#endif
 }
-int8_t copy_up_to_string(char * str, char * dest_buffer)
+
+
+RAM_FUNC void debug_uart_callback(void)
 {
-	/*Process copy*/
-	return (process_copy(str,dest_buffer, 0));
+	uart_callback(DEBUG_PORT);
 }
-void USART2_IRQHandler (void)
+
+
+RAM_FUNC void USART2_IRQHandler (void)
 {
 	debug_uart_callback();
 }
 
-void USART1_IRQHandler (void)
+RAM_FUNC void USART1_IRQHandler (void)
 {
 	slave_dev_uart_callback();
 }
-
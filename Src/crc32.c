@@ -0,0 +1,162 @@
+/*
+ * File : crc32.c
+ * Author : Prudhvi Raj Belide
+ * Description : This file computes the CRC-32 of word aligned data in software, four bits at a time from a 16 entry
+ * table, and drives the CRC unit for image payloads, either fed byte by byte during a download or from flash by DMA.
+ */
+
+#include "crc32.h"
+
+#define CRCEN					(1U<<12)
+#define DMA2EN					(1U<<22)
+#define DMA_CR_EN				(1U<<0)
+#define DMA_CR_DIR_M2M			(1U<<7)
+#define DMA_CR_PINC				(1U<<9)
+#define DMA_CR_PSIZE_32			(2U<<11)
+#define DMA_CR_MSIZE_32			(2U<<13)
+#define DMA_FCR_DMDIS			(1U<<2)
+#define DMA_FCR_FTH_FULL		(3U<<0)
+#define DMA_LIFCR_STREAM0		(0x3DU<<0)	/*All flags of stream 0*/
+#define DMA_MAX_ITEMS			0xFFFFU		/*NDTR is 16 bits wide*/
+
+/*CRC of each nibble value shifted into the top of the register*/
+static const uint32_t crc32_nibble[16] =
+{
+	0x00000000U, 0x04C11DB7U, 0x09823B6EU, 0x0D4326D9U,
+	0x130476DCU, 0x17C56B6BU, 0x1A864DB2U, 0x1E475005U,
+	0x2608EDB8U, 0x22C9F00FU, 0x2F8AD6D6U, 0x2B4BCB61U,
+	0x350C9B64U, 0x31CD86D3U, 0x3C8EA00AU, 0x384FBDBDU
+};
+
+
+uint32_t crc32_words(uint32_t crc, const uint32_t *data, uint32_t count)
+{
+	uint32_t bit;
+
+	while(count--)
+	{
+		crc ^= *data++;
+
+		/*Shift the word out of the top, one nibble per step*/
+		for(bit = 0; bit < 8; bit++)
+		{
+			crc = (crc << 4) ^ crc32_nibble[crc >> 28];
+		}
+	}
+
+	return crc;
+}
+
+
+void crc32_hw_init(void)
+{
+	/*Enable clock access to the CRC unit and DMA2*/
+	RCC->AHB1ENR |= CRCEN | DMA2EN;
+}
+
+
+/*CRC of count words starting at a word aligned address, computed by the CRC unit*/
+uint32_t crc32_hw_memory(uint32_t address, uint32_t count)
+{
+	uint32_t chunk;
+
+	CRC->CR = CRC_CR_RESET;
+
+#ifdef CRC32_HW_DMA
+	while(count != 0)
+	{
+		chunk = (count > DMA_MAX_ITEMS) ? DMA_MAX_ITEMS : count;
+
+		/*Memory to memory: PAR is the source, the CRC data register is the fixed destination*/
+		DMA2_Stream0->CR &= ~DMA_CR_EN;
+		while(DMA2_Stream0->CR & DMA_CR_EN){}
+
+		DMA2->LIFCR = DMA_LIFCR_STREAM0;
+		DMA2_Stream0->PAR  = address;
+		DMA2_Stream0->M0AR = (uint32_t)&CRC->DR;
+		DMA2_Stream0->NDTR = chunk;
+		DMA2_Stream0->FCR  = DMA_FCR_DMDIS | DMA_FCR_FTH_FULL;
+		DMA2_Stream0->CR   = DMA_CR_DIR_M2M | DMA_CR_PINC | DMA_CR_PSIZE_32 | DMA_CR_MSIZE_32;
+		DMA2_Stream0->CR  |= DMA_CR_EN;
+
+		while(!(DMA2->LISR & (DMA_LISR_TCIF0 | DMA_LISR_TEIF0))){}
+
+		if(DMA2->LISR & DMA_LISR_TEIF0)
+		{
+			/*Bus error, return a value that matches no image*/
+			DMA2->LIFCR = DMA_LIFCR_STREAM0;
+			return ~CRC->DR;
+		}
+
+		address += chunk * 4;
+		count   -= chunk;
+	}
+
+	DMA2->LIFCR = DMA_LIFCR_STREAM0;
+#else
+	(void)chunk;
+
+	while(count--)
+	{
+		CRC->DR = *(__IO uint32_t *)address;
+		address += 4;
+	}
+#endif
+
+	return CRC->DR;
+}
+
+
+void crc32_stream_start(crc32_stream *stream)
+{
+	stream->word  = 0;
+	stream->fill  = 0;
+	stream->bytes = 0;
+
+	CRC->CR = CRC_CR_RESET;
+}
+
+
+/*Feed bytes as they arrive, the CRC unit takes a little endian word once four of them are in*/
+void crc32_stream_update(crc32_stream *stream, const uint8_t *data, uint32_t length)
+{
+	stream->bytes += length;
+
+	/*Complete the word left over from the last call*/
+	while((length != 0) && (stream->fill != 0))
+	{
+		stream->word |= (uint32_t)*data++ << (stream->fill * 8);
+		length--;
+
+		if(++stream->fill == 4)
+		{
+			CRC->DR = stream->word;
+			stream->word = 0;
+			stream->fill = 0;
+		}
+	}
+
+	/*The ring buffer gives no alignment, assemble the words from bytes*/
+	while(length >= 4)
+	{
+		CRC->DR = data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+		data   += 4;
+		length -= 4;
+	}
+
+	while(length != 0)
+	{
+		stream->word |= (uint32_t)*data++ << (stream->fill * 8);
+		stream->fill++;
+		length--;
+	}
+}
+
+
+/*CRC of the complete words fed so far*/
+uint32_t crc32_stream_value(const crc32_stream *stream)
+{
+	(void)stream;
+
+	return CRC->DR;
+}
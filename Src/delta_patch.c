@@ -0,0 +1,204 @@
+/*
+ * File : delta_patch.c
+ * Author : Prudhvi Raj Belide
+ * Description : This file applies a delta patch while it is downloaded. COPY hands bytes of the base image straight
+ * from flash to the sink, ADD rebuilds code that moved by adding the patch bytes to the base bytes, INSERT passes new
+ * bytes through. The patch may be cut into chunks anywhere.
+ */
+
+#include <string.h>
+#include "delta_patch.h"
+
+enum
+{
+	DELTA_STATE_HEADER = 0,
+	DELTA_STATE_OP,
+	DELTA_STATE_ARGS,
+	DELTA_STATE_ADD,
+	DELTA_STATE_INSERT
+};
+
+static uint32_t delta_word(const uint8_t *bytes);
+static void delta_run_op(delta_patcher *patcher);
+static void delta_fail(delta_patcher *patcher);
+
+
+void delta_init(delta_patcher *patcher, const uint8_t *base, uint32_t base_size, const uint8_t *base_hash,
+		delta_sink sink, void *ctx)
+{
+	patcher->base        = base;
+	patcher->base_size   = base_size;
+	patcher->base_hash   = base_hash;
+	patcher->target_size = 0;
+	patcher->produced    = 0;
+	patcher->copied      = 0;
+	patcher->state       = DELTA_STATE_HEADER;
+	patcher->fill        = 0;
+	patcher->buffer_fill = 0;
+	patcher->status      = DEV_OK;
+	patcher->sink        = sink;
+	patcher->ctx         = ctx;
+}
+
+
+StatusTypeDef delta_feed(delta_patcher *patcher, const uint8_t *data, uint32_t length)
+{
+	uint32_t count;
+	uint8_t needed;
+
+	while((length != 0) && (patcher->status == DEV_OK))
+	{
+		switch(patcher->state)
+		{
+		case DELTA_STATE_HEADER:
+			patcher->args[patcher->fill++] = *data++;
+			length--;
+
+			if(patcher->fill == DELTA_HEADER_SZ)
+			{
+				/*The patch only fits the image it was made against*/
+				if(memcmp(patcher->args, patcher->base_hash, DELTA_BASE_HASH_SZ) != 0)
+				{
+					delta_fail(patcher);
+					break;
+				}
+
+				patcher->target_size = delta_word(&patcher->args[DELTA_BASE_HASH_SZ]);
+				patcher->state = DELTA_STATE_OP;
+			}
+			break;
+
+		case DELTA_STATE_OP:
+			patcher->op = *data++;
+			length--;
+			patcher->fill = 0;
+			patcher->state = DELTA_STATE_ARGS;
+
+			if(patcher->op > DELTA_OP_INSERT)
+			{
+				delta_fail(patcher);
+			}
+			break;
+
+		case DELTA_STATE_ARGS:
+			needed = (patcher->op == DELTA_OP_INSERT) ? 4 : 8;
+			patcher->args[patcher->fill++] = *data++;
+			length--;
+
+			if(patcher->fill == needed)
+			{
+				delta_run_op(patcher);
+			}
+			break;
+
+		case DELTA_STATE_ADD:
+			count = (length < patcher->remaining) ? length : patcher->remaining;
+			patcher->remaining -= count;
+			length -= count;
+
+			while(count--)
+			{
+				patcher->buffer[patcher->buffer_fill++] = patcher->base[patcher->offset++] + *data++;
+
+				if(patcher->buffer_fill == DELTA_BUFFER_SZ)
+				{
+					patcher->sink(patcher->ctx, patcher->buffer, DELTA_BUFFER_SZ);
+					patcher->buffer_fill = 0;
+				}
+			}
+
+			if(patcher->remaining == 0)
+			{
+				if(patcher->buffer_fill != 0)
+				{
+					patcher->sink(patcher->ctx, patcher->buffer, patcher->buffer_fill);
+					patcher->buffer_fill = 0;
+				}
+
+				patcher->state = DELTA_STATE_OP;
+			}
+			break;
+
+		case DELTA_STATE_INSERT:
+			/*New bytes need no copy, pass them on in place*/
+			count = (length < patcher->remaining) ? length : patcher->remaining;
+			patcher->sink(patcher->ctx, data, count);
+			patcher->remaining -= count;
+			data   += count;
+			length -= count;
+
+			if(patcher->remaining == 0)
+			{
+				patcher->state = DELTA_STATE_OP;
+			}
+			break;
+
+		default:
+			delta_fail(patcher);
+			break;
+		}
+	}
+
+	return patcher->status;
+}
+
+
+/*The patch is complete once it built every byte it announced*/
+StatusTypeDef delta_finish(const delta_patcher *patcher)
+{
+	if((patcher->status != DEV_OK) || (patcher->state != DELTA_STATE_OP) ||
+	   (patcher->produced != patcher->target_size))
+	{
+		return DEV_ERROR;
+	}
+
+	return DEV_OK;
+}
+
+
+static uint32_t delta_word(const uint8_t *bytes)
+{
+	return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+
+/*All arguments of an operation are in, check them against the base and the announced size*/
+static void delta_run_op(delta_patcher *patcher)
+{
+	uint32_t offset = delta_word(patcher->args);
+	uint32_t length = delta_word(&patcher->args[(patcher->op == DELTA_OP_INSERT) ? 0 : 4]);
+
+	if((length == 0) || (length > (patcher->target_size - patcher->produced)))
+	{
+		delta_fail(patcher);
+		return;
+	}
+
+	if((patcher->op != DELTA_OP_INSERT) && ((offset > patcher->base_size) || (length > (patcher->base_size - offset))))
+	{
+		delta_fail(patcher);
+		return;
+	}
+
+	patcher->produced += length;
+
+	if(patcher->op == DELTA_OP_COPY)
+	{
+		/*Straight from the active slot, the sink copies it before the next operation*/
+		patcher->sink(patcher->ctx, patcher->base + offset, length);
+		patcher->copied += length;
+		patcher->state = DELTA_STATE_OP;
+	}
+	else
+	{
+		patcher->offset    = offset;
+		patcher->remaining = length;
+		patcher->state     = (patcher->op == DELTA_OP_ADD) ? DELTA_STATE_ADD : DELTA_STATE_INSERT;
+	}
+}
+
+
+static void delta_fail(delta_patcher *patcher)
+{
+	patcher->status = DEV_ERROR;
+}
@@ -0,0 +1,509 @@
+/*
+ * File : ecdsa_p256.c
+ * Author : Prudhvi Raj Belide
+ * Description : This file verifies ECDSA signatures on the NIST P-256 curve. Numbers are held as eight 32 bit words,
+ * least significant first. Arithmetic modulo p and modulo n both goes through one Montgomery multiplier whose inner
+ * loops are UMAAL instructions on the Cortex-M4. Points use Jacobian coordinates and u1*G + u2*Q is computed in a
+ * single pass over the scalar bits (Shamir's trick). Only public values are processed, so nothing here needs to run
+ * in constant time.
+ */
+
+#include <string.h>
+#include "ecdsa_p256.h"
+
+/*lo:hi = a * b + lo + hi, which never overflows 64 bits*/
+#if defined(__ARM_FEATURE_DSP)
+#define UMAAL(lo, hi, a, b)		__asm__ ("umaal %0, %1, %2, %3" : "+r"(lo), "+r"(hi) : "r"(a), "r"(b))
+#else
+#define UMAAL(lo, hi, a, b)		do { uint64_t umaal_t = (uint64_t)(a) * (b) + (lo) + (hi); \
+									 (lo) = (uint32_t)umaal_t; (hi) = (uint32_t)(umaal_t >> 32); } while(0)
+#endif
+
+typedef struct
+{
+	uint32_t m[P256_WORDS];		/*Modulus*/
+	uint32_t n0;				/*-m^-1 mod 2^32*/
+	uint32_t r2[P256_WORDS];	/*2^512 mod m, converts into the Montgomery domain*/
+
+}p256_modulus;
+
+/*Jacobian point, x = X/Z^2 and y = Y/Z^3, infinity has Z = 0. Coordinates are in the Montgomery domain*/
+typedef struct
+{
+	uint32_t x[P256_WORDS];
+	uint32_t y[P256_WORDS];
+	uint32_t z[P256_WORDS];
+
+}p256_point;
+
+static const p256_modulus p256_p =
+{
+	{0xFFFFFFFFU, 0xFFFFFFFFU, 0xFFFFFFFFU, 0x00000000U, 0x00000000U, 0x00000000U, 0x00000001U, 0xFFFFFFFFU},
+	0x00000001U,
+	{0x00000003U, 0x00000000U, 0xFFFFFFFFU, 0xFFFFFFFBU, 0xFFFFFFFEU, 0xFFFFFFFFU, 0xFFFFFFFDU, 0x00000004U}
+};
+
+static const p256_modulus p256_n =
+{
+	{0xFC632551U, 0xF3B9CAC2U, 0xA7179E84U, 0xBCE6FAADU, 0xFFFFFFFFU, 0xFFFFFFFFU, 0x00000000U, 0xFFFFFFFFU},
+	0xEE00BC4FU,
+	{0xBE79EEA2U, 0x83244C95U, 0x49BD6FA6U, 0x4699799CU, 0x2B6BEC59U, 0x2845B239U, 0xF3D95620U, 0x66E12D94U}
+};
+
+/*Curve constant b, generator and 1, already in the Montgomery domain modulo p*/
+static const uint32_t p256_b[P256_WORDS] =
+	{0x29C4BDDFU, 0xD89CDF62U, 0x78843090U, 0xACF005CDU, 0xF7212ED6U, 0xE5A220ABU, 0x04874834U, 0xDC30061DU};
+static const uint32_t p256_gx[P256_WORDS] =
+	{0x18A9143CU, 0x79E730D4U, 0x5FEDB601U, 0x75BA95FCU, 0x77622510U, 0x79FB732BU, 0xA53755C6U, 0x18905F76U};
+static const uint32_t p256_gy[P256_WORDS] =
+	{0xCE95560AU, 0xDDF25357U, 0xBA19E45CU, 0x8B4AB8E4U, 0xDD21F325U, 0xD2E88688U, 0x25885D85U, 0x8571FF18U};
+static const uint32_t p256_one[P256_WORDS] =
+	{0x00000001U, 0x00000000U, 0x00000000U, 0xFFFFFFFFU, 0xFFFFFFFFU, 0xFFFFFFFFU, 0xFFFFFFFEU, 0x00000000U};
+
+static void p256_from_bytes(uint32_t *r, const uint8_t *bytes);
+static int p256_compare(const uint32_t *a, const uint32_t *b);
+static uint8_t p256_is_zero(const uint32_t *a);
+static uint32_t p256_raw_add(uint32_t *r, const uint32_t *a, const uint32_t *b);
+static uint32_t p256_raw_sub(uint32_t *r, const uint32_t *a, const uint32_t *b);
+static void p256_mod_add(uint32_t *r, const uint32_t *a, const uint32_t *b, const p256_modulus *mod);
+static void p256_mod_sub(uint32_t *r, const uint32_t *a, const uint32_t *b, const p256_modulus *mod);
+static void p256_mont_mul(uint32_t *r, const uint32_t *a, const uint32_t *b, const p256_modulus *mod);
+static void p256_mont_inv(uint32_t *r, const uint32_t *a, const p256_modulus *mod);
+static void p256_double(p256_point *r);
+static void p256_add_affine(p256_point *r, const uint32_t *x, const uint32_t *y);
+static uint8_t p256_on_curve(const uint32_t *x, const uint32_t *y);
+
+
+StatusTypeDef ecdsa_p256_verify(const uint8_t public_key[2 * P256_BYTES], const uint8_t hash[P256_BYTES],
+		const uint8_t signature[2 * P256_BYTES])
+{
+	uint32_t table_x[3][P256_WORDS];	/*G, Q and G + Q in affine coordinates*/
+	uint32_t table_y[3][P256_WORDS];
+	uint8_t table_used[3] = {1, 1, 1};
+	uint32_t r[P256_WORDS], s[P256_WORDS], e[P256_WORDS];
+	uint32_t u1[P256_WORDS], u2[P256_WORDS];
+	uint32_t t[P256_WORDS], z2[P256_WORDS];
+	p256_point acc;
+	uint32_t index;
+	int bit;
+
+	p256_from_bytes(r, signature);
+	p256_from_bytes(s, signature + P256_BYTES);
+	p256_from_bytes(e, hash);
+
+	/*r and s must lie in [1, n-1]*/
+	if(p256_is_zero(r) || p256_is_zero(s) || (p256_compare(r, p256_n.m) >= 0) || (p256_compare(s, p256_n.m) >= 0))
+	{
+		return DEV_ERROR;
+	}
+
+	/*The hash is as wide as n, one subtraction reduces it*/
+	if(p256_compare(e, p256_n.m) >= 0)
+	{
+		p256_raw_sub(e, e, p256_n.m);
+	}
+
+	/*w = s^-1, u1 = e * w, u2 = r * w, all mod n. Multiplying a normal number by a Montgomery one leaves the
+	 *Montgomery domain*/
+	p256_mont_mul(t, s, p256_n.r2, &p256_n);
+	p256_mont_inv(t, t, &p256_n);
+	p256_mont_mul(u1, e, t, &p256_n);
+	p256_mont_mul(u2, r, t, &p256_n);
+
+	/*Load Q and reject keys that are not on the curve*/
+	memcpy(table_x[0], p256_gx, sizeof(p256_gx));
+	memcpy(table_y[0], p256_gy, sizeof(p256_gy));
+	p256_from_bytes(table_x[1], public_key);
+	p256_from_bytes(table_y[1], public_key + P256_BYTES);
+
+	if((p256_compare(table_x[1], p256_p.m) >= 0) || (p256_compare(table_y[1], p256_p.m) >= 0))
+	{
+		return DEV_ERROR;
+	}
+
+	p256_mont_mul(table_x[1], table_x[1], p256_p.r2, &p256_p);
+	p256_mont_mul(table_y[1], table_y[1], p256_p.r2, &p256_p);
+
+	if(!p256_on_curve(table_x[1], table_y[1]))
+	{
+		return DEV_ERROR;
+	}
+
+	/*G + Q, one inversion here saves mixed additions being replaced by full ones in the loop*/
+	memcpy(acc.x, p256_gx, sizeof(p256_gx));
+	memcpy(acc.y, p256_gy, sizeof(p256_gy));
+	memcpy(acc.z, p256_one, sizeof(p256_one));
+	p256_add_affine(&acc, table_x[1], table_y[1]);
+
+	if(p256_is_zero(acc.z))
+	{
+		/*Q = -G, the sum is the point at infinity*/
+		table_used[2] = 0;
+	}
+	else
+	{
+		p256_mont_inv(t, acc.z, &p256_p);
+		p256_mont_mul(z2, t, t, &p256_p);
+		p256_mont_mul(table_x[2], acc.x, z2, &p256_p);
+		p256_mont_mul(z2, z2, t, &p256_p);
+		p256_mont_mul(table_y[2], acc.y, z2, &p256_p);
+	}
+
+	/*acc = u1 * G + u2 * Q, one doubling per bit and at most one addition*/
+	memset(&acc, 0, sizeof(acc));
+
+	for(bit = 255; bit >= 0; bit--)
+	{
+		p256_double(&acc);
+
+		index = ((u1[bit >> 5] >> (bit & 31)) & 1U) | (((u2[bit >> 5] >> (bit & 31)) & 1U) << 1);
+
+		if((index != 0) && table_used[index - 1])
+		{
+			p256_add_affine(&acc, table_x[index - 1], table_y[index - 1]);
+		}
+	}
+
+	if(p256_is_zero(acc.z))
+	{
+		return DEV_ERROR;
+	}
+
+	/*Accept if x mod n == r. Instead of inverting Z compare X with r * Z^2, and with (r + n) * Z^2 while that is
+	 *still below p*/
+	p256_mont_mul(z2, acc.z, acc.z, &p256_p);
+
+	for(;;)
+	{
+		p256_mont_mul(t, r, p256_p.r2, &p256_p);
+		p256_mont_mul(t, t, z2, &p256_p);
+
+		if(p256_compare(t, acc.x) == 0)
+		{
+			return DEV_OK;
+		}
+
+		if((p256_raw_add(r, r, p256_n.m) != 0) || (p256_compare(r, p256_p.m) >= 0))
+		{
+			return DEV_ERROR;
+		}
+	}
+}
+
+
+static void p256_from_bytes(uint32_t *r, const uint8_t *bytes)
+{
+	uint32_t i;
+
+	for(i = 0; i < P256_WORDS; i++)
+	{
+		const uint8_t *word = bytes + (P256_BYTES - 4) - (i * 4);
+
+		r[i] = ((uint32_t)word[0] << 24) | ((uint32_t)word[1] << 16) | ((uint32_t)word[2] << 8) | word[3];
+	}
+}
+
+
+static int p256_compare(const uint32_t *a, const uint32_t *b)
+{
+	int i;
+
+	for(i = P256_WORDS - 1; i >= 0; i--)
+	{
+		if(a[i] != b[i])
+		{
+			return (a[i] > b[i]) ? 1 : -1;
+		}
+	}
+
+	return 0;
+}
+
+
+static uint8_t p256_is_zero(const uint32_t *a)
+{
+	uint32_t bits = 0;
+	uint32_t i;
+
+	for(i = 0; i < P256_WORDS; i++)
+	{
+		bits |= a[i];
+	}
+
+	return bits == 0;
+}
+
+
+/*r = a + b, returns the carry out*/
+static uint32_t p256_raw_add(uint32_t *r, const uint32_t *a, const uint32_t *b)
+{
+	uint64_t sum = 0;
+	uint32_t i;
+
+	for(i = 0; i < P256_WORDS; i++)
+	{
+		sum += (uint64_t)a[i] + b[i];
+		r[i] = (uint32_t)sum;
+		sum >>= 32;
+	}
+
+	return (uint32_t)sum;
+}
+
+
+/*r = a - b, returns the borrow out*/
+static uint32_t p256_raw_sub(uint32_t *r, const uint32_t *a, const uint32_t *b)
+{
+	uint64_t diff;
+	uint32_t borrow = 0;
+	uint32_t i;
+
+	for(i = 0; i < P256_WORDS; i++)
+	{
+		diff = (uint64_t)a[i] - b[i] - borrow;
+		r[i] = (uint32_t)diff;
+		borrow = (uint32_t)(diff >> 32) & 1U;
+	}
+
+	return borrow;
+}
+
+
+static void p256_mod_add(uint32_t *r, const uint32_t *a, const uint32_t *b, const p256_modulus *mod)
+{
+	if((p256_raw_add(r, a, b) != 0) || (p256_compare(r, mod->m) >= 0))
+	{
+		p256_raw_sub(r, r, mod->m);
+	}
+}
+
+
+static void p256_mod_sub(uint32_t *r, const uint32_t *a, const uint32_t *b, const p256_modulus *mod)
+{
+	if(p256_raw_sub(r, a, b) != 0)
+	{
+		p256_raw_add(r, r, mod->m);
+	}
+}
+
+
+/*r = a * b / 2^256 mod m for a, b < m. Word-serial Montgomery multiplication (CIOS): every inner step is one
+ *multiply-accumulate of a word product into the running sum*/
+static void p256_mont_mul(uint32_t *r, const uint32_t *a, const uint32_t *b, const p256_modulus *mod)
+{
+	uint32_t t[P256_WORDS + 2] = {0};
+	uint32_t carry, q, low, ai;
+	uint64_t sum;
+	uint32_t i, j;
+
+	for(i = 0; i < P256_WORDS; i++)
+	{
+		/*t += a[i] * b*/
+		ai = a[i];
+		carry = 0;
+
+		for(j = 0; j < P256_WORDS; j++)
+		{
+			UMAAL(t[j], carry, ai, b[j]);
+		}
+
+		sum = (uint64_t)t[P256_WORDS] + carry;
+		t[P256_WORDS]     = (uint32_t)sum;
+		t[P256_WORDS + 1] = (uint32_t)(sum >> 32);
+
+		/*t = (t + q * m) / 2^32, q clears the lowest word*/
+		q = t[0] * mod->n0;
+		carry = 0;
+		low = t[0];
+		UMAAL(low, carry, q, mod->m[0]);
+
+		for(j = 1; j < P256_WORDS; j++)
+		{
+			UMAAL(t[j], carry, q, mod->m[j]);
+			t[j - 1] = t[j];
+		}
+
+		sum = (uint64_t)t[P256_WORDS] + carry;
+		t[P256_WORDS - 1] = (uint32_t)sum;
+		t[P256_WORDS]     = t[P256_WORDS + 1] + (uint32_t)(sum >> 32);
+	}
+
+	/*t < 2m, one subtraction at most*/
+	if((t[P256_WORDS] != 0) || (p256_compare(t, mod->m) >= 0))
+	{
+		p256_raw_sub(r, t, mod->m);
+	}
+	else
+	{
+		memcpy(r, t, P256_BYTES);
+	}
+}
+
+
+/*r = a^-1 in the Montgomery domain, computed as a^(m-2) (m is prime)*/
+static void p256_mont_inv(uint32_t *r, const uint32_t *a, const p256_modulus *mod)
+{
+	static const uint32_t two[P256_WORDS] = {2};
+	uint32_t exponent[P256_WORDS];
+	uint32_t base[P256_WORDS];
+	uint32_t result[P256_WORDS];
+	uint8_t started = 0;
+	int bit;
+
+	p256_raw_sub(exponent, mod->m, two);
+	memcpy(base, a, P256_BYTES);
+
+	for(bit = 255; bit >= 0; bit--)
+	{
+		if(started)
+		{
+			p256_mont_mul(result, result, result, mod);
+		}
+
+		if((exponent[bit >> 5] >> (bit & 31)) & 1U)
+		{
+			if(started)
+			{
+				p256_mont_mul(result, result, base, mod);
+			}
+			else
+			{
+				memcpy(result, base, P256_BYTES);
+				started = 1;
+			}
+		}
+	}
+
+	memcpy(r, result, P256_BYTES);
+}
+
+
+/*r = 2r for a = -3 (dbl-2001-b)*/
+static void p256_double(p256_point *r)
+{
+	uint32_t delta[P256_WORDS], gamma[P256_WORDS], beta[P256_WORDS], alpha[P256_WORDS];
+	uint32_t t1[P256_WORDS], t2[P256_WORDS];
+
+	if(p256_is_zero(r->z))
+	{
+		return;
+	}
+
+	p256_mont_mul(delta, r->z, r->z, &p256_p);
+	p256_mont_mul(gamma, r->y, r->y, &p256_p);
+	p256_mont_mul(beta, r->x, gamma, &p256_p);
+
+	/*alpha = 3 * (X - delta) * (X + delta)*/
+	p256_mod_sub(t1, r->x, delta, &p256_p);
+	p256_mod_add(t2, r->x, delta, &p256_p);
+	p256_mont_mul(alpha, t1, t2, &p256_p);
+	p256_mod_add(t1, alpha, alpha, &p256_p);
+	p256_mod_add(alpha, t1, alpha, &p256_p);
+
+	/*Z3 = (Y + Z)^2 - gamma - delta*/
+	p256_mod_add(t1, r->y, r->z, &p256_p);
+	p256_mont_mul(t1, t1, t1, &p256_p);
+	p256_mod_sub(t1, t1, gamma, &p256_p);
+	p256_mod_sub(r->z, t1, delta, &p256_p);
+
+	/*X3 = alpha^2 - 8 * beta*/
+	p256_mod_add(beta, beta, beta, &p256_p);
+	p256_mod_add(beta, beta, beta, &p256_p);
+	p256_mod_add(t2, beta, beta, &p256_p);
+	p256_mont_mul(t1, alpha, alpha, &p256_p);
+	p256_mod_sub(r->x, t1, t2, &p256_p);
+
+	/*Y3 = alpha * (4 * beta - X3) - 8 * gamma^2*/
+	p256_mod_sub(t1, beta, r->x, &p256_p);
+	p256_mont_mul(t1, alpha, t1, &p256_p);
+	p256_mont_mul(gamma, gamma, gamma, &p256_p);
+	p256_mod_add(gamma, gamma, gamma, &p256_p);
+	p256_mod_add(gamma, gamma, gamma, &p256_p);
+	p256_mod_add(gamma, gamma, gamma, &p256_p);
+	p256_mod_sub(r->y, t1, gamma, &p256_p);
+}
+
+
+/*r = r + (x, y) with (x, y) affine (madd-2007-bl)*/
+static void p256_add_affine(p256_point *r, const uint32_t *x, const uint32_t *y)
+{
+	uint32_t z1z1[P256_WORDS], h[P256_WORDS], hh[P256_WORDS], i4[P256_WORDS], j[P256_WORDS];
+	uint32_t rr[P256_WORDS], v[P256_WORDS], t1[P256_WORDS];
+
+	if(p256_is_zero(r->z))
+	{
+		memcpy(r->x, x, P256_BYTES);
+		memcpy(r->y, y, P256_BYTES);
+		memcpy(r->z, p256_one, P256_BYTES);
+		return;
+	}
+
+	/*H = x * Z1^2 - X1, rr = 2 * (y * Z1^3 - Y1)*/
+	p256_mont_mul(z1z1, r->z, r->z, &p256_p);
+	p256_mont_mul(h, x, z1z1, &p256_p);
+	p256_mod_sub(h, h, r->x, &p256_p);
+	p256_mont_mul(t1, r->z, z1z1, &p256_p);
+	p256_mont_mul(t1, y, t1, &p256_p);
+	p256_mod_sub(rr, t1, r->y, &p256_p);
+
+	if(p256_is_zero(h))
+	{
+		if(p256_is_zero(rr))
+		{
+			/*Same point*/
+			p256_double(r);
+		}
+		else
+		{
+			/*Opposite points*/
+			memset(r->z, 0, P256_BYTES);
+		}
+		return;
+	}
+
+	p256_mod_add(rr, rr, rr, &p256_p);
+
+	/*I = 4 * H^2, J = H * I, V = X1 * I*/
+	p256_mont_mul(hh, h, h, &p256_p);
+	p256_mod_add(i4, hh, hh, &p256_p);
+	p256_mod_add(i4, i4, i4, &p256_p);
+	p256_mont_mul(j, h, i4, &p256_p);
+	p256_mont_mul(v, r->x, i4, &p256_p);
+
+	/*Z3 = (Z1 + H)^2 - Z1Z1 - HH*/
+	p256_mod_add(t1, r->z, h, &p256_p);
+	p256_mont_mul(t1, t1, t1, &p256_p);
+	p256_mod_sub(t1, t1, z1z1, &p256_p);
+	p256_mod_sub(r->z, t1, hh, &p256_p);
+
+	/*X3 = rr^2 - J - 2 * V*/
+	p256_mont_mul(t1, rr, rr, &p256_p);
+	p256_mod_sub(t1, t1, j, &p256_p);
+	p256_mod_sub(t1, t1, v, &p256_p);
+	p256_mod_sub(r->x, t1, v, &p256_p);
+
+	/*Y3 = rr * (V - X3) - 2 * Y1 * J*/
+	p256_mod_sub(t1, v, r->x, &p256_p);
+	p256_mont_mul(t1, rr, t1, &p256_p);
+	p256_mont_mul(j, r->y, j, &p256_p);
+	p256_mod_add(j, j, j, &p256_p);
+	p256_mod_sub(r->y, t1, j, &p256_p);
+}
+
+
+/*y^2 = x^3 - 3x + b*/
+static uint8_t p256_on_curve(const uint32_t *x, const uint32_t *y)
+{
+	uint32_t left[P256_WORDS], right[P256_WORDS];
+
+	p256_mont_mul(left, y, y, &p256_p);
+
+	p256_mont_mul(right, x, x, &p256_p);
+	p256_mont_mul(right, right, x, &p256_p);
+	p256_mod_sub(right, right, x, &p256_p);
+	p256_mod_sub(right, right, x, &p256_p);
+	p256_mod_sub(right, right, x, &p256_p);
+	p256_mod_add(right, right, p256_b, &p256_p);
+
+	return p256_compare(left, right) == 0;
+}
@@ -7,6 +7,7 @@
 
 #include <esp82xx_driver.h>
 #include <stdint.h>
+#include "ram_exec.h"
 
 #define GPIOAEN		(1U<<0)
 #define UART2EN		(1U<<17)
@@ -22,9 +23,27 @@
 
 #define CR1_UE					(1U<<13)
 #define SR_TXE					(1U<<7)
+#define CR1_IDLEIE				(1U<<4)
+#define CR3_DMAR				(1U<<6)
+#define CR3_DMAT				(1U<<7)
+
+#define DMA1EN					(1U<<21)
+#define DMA2EN					(1U<<22)
+#define DMA_CR_EN				(1U<<0)
+#define DMA_CR_HTIE				(1U<<3)
+#define DMA_CR_TCIE				(1U<<4)
+#define DMA_CR_DIR_M2P			(1U<<6)
+#define DMA_CR_CIRC				(1U<<8)
+#define DMA_CR_MINC				(1U<<10)
+#define DMA_CR_CHSEL_4			(4U<<25)
+#define DMA_LIFCR_STREAM2		(0x3DU<<16)	/*All flags of stream 2*/
+#define DMA_HIFCR_STREAM6		(0x3DU<<16)	/*All flags of stream 6*/
+#define DMA_HIFCR_STREAM7		(0x3DU<<22)	/*All flags of stream 7*/
 
 
 static uint16_t compute_uart_bd(uint32_t periph_clk,uint32_t baudrate);
+static void uart_tx_dma_init(DMA_Stream_TypeDef *stream, uint32_t periph_addr);
+static void uart_tx_dma_start(DMA_Stream_TypeDef *stream, const uint8_t *data, uint32_t length);
 
 static void uart_set_baudrate(uint32_t periph_clk,uint32_t baudrate);
 static void uart_write(int ch);
@@ -171,6 +190,137 @@ void esp_uart_init(void)
 }
 
 
+/*USART1_RX is mapped to DMA2 Stream2 Channel4.
+ * The stream runs in circular mode and writes straight into the ring storage,
+ * the half, full transfer and UART IDLE interrupts tell the ring how far it got*/
+void esp_uart_rx_dma_init(uint8_t *buffer, uint32_t size)
+{
+	/*Enable clock access to DMA2*/
+	RCC->AHB1ENR |= DMA2EN;
+
+	/*Disable the stream and wait until it is off*/
+	DMA2_Stream2->CR &= ~DMA_CR_EN;
+	while(DMA2_Stream2->CR & DMA_CR_EN){}
+
+	/*Clear all interrupt flags of the stream*/
+	DMA2->LIFCR = DMA_LIFCR_STREAM2;
+
+	/*Set peripheral address, memory address and number of transfers*/
+	DMA2_Stream2->PAR  = (uint32_t)&USART1->DR;
+	DMA2_Stream2->M0AR = (uint32_t)buffer;
+	DMA2_Stream2->NDTR = size;
+
+	/*Channel 4, byte transfers, memory increment, circular, peripheral to memory*/
+	DMA2_Stream2->CR = DMA_CR_CHSEL_4 | DMA_CR_MINC | DMA_CR_CIRC | DMA_CR_HTIE | DMA_CR_TCIE;
+
+	/*Direct mode*/
+	DMA2_Stream2->FCR = 0;
+
+	/*Enable interrupt in NVIC*/
+	NVIC_EnableIRQ(DMA2_Stream2_IRQn);
+
+	/*Enable DMA receiver in UART1 and the IDLE line interrupt*/
+	USART1->CR3 |= CR3_DMAR;
+	USART1->CR1 |= CR1_IDLEIE;
+
+	/*Enable the stream*/
+	DMA2_Stream2->CR |= DMA_CR_EN;
+}
+
+RAM_FUNC uint32_t esp_uart_rx_dma_position(uint32_t size)
+{
+	/*NDTR counts down from size and reloads in circular mode*/
+	uint32_t pos = size - DMA2_Stream2->NDTR;
+
+	return (pos == size) ? 0 : pos;
+}
+
+RAM_FUNC void esp_uart_rx_dma_clear_flags(void)
+{
+	DMA2->LIFCR = DMA_LIFCR_STREAM2;
+}
+
+/*USART1_TX is mapped to DMA2 Stream7 Channel4*/
+void esp_uart_tx_dma_init(void)
+{
+	/*Enable clock access to DMA2*/
+	RCC->AHB1ENR |= DMA2EN;
+
+	DMA2->HIFCR = DMA_HIFCR_STREAM7;
+	uart_tx_dma_init(DMA2_Stream7, (uint32_t)&USART1->DR);
+
+	/*Enable interrupt in NVIC*/
+	NVIC_EnableIRQ(DMA2_Stream7_IRQn);
+
+	/*Enable DMA transmitter in UART1*/
+	USART1->CR3 |= CR3_DMAT;
+}
+
+RAM_FUNC void esp_uart_tx_dma_start(const uint8_t *data, uint32_t length)
+{
+	DMA2->HIFCR = DMA_HIFCR_STREAM7;
+	uart_tx_dma_start(DMA2_Stream7, data, length);
+}
+
+RAM_FUNC void esp_uart_tx_dma_clear_flags(void)
+{
+	DMA2->HIFCR = DMA_HIFCR_STREAM7;
+}
+
+/*USART2_TX is mapped to DMA1 Stream6 Channel4*/
+void debug_uart_tx_dma_init(void)
+{
+	/*Enable clock access to DMA1*/
+	RCC->AHB1ENR |= DMA1EN;
+
+	DMA1->HIFCR = DMA_HIFCR_STREAM6;
+	uart_tx_dma_init(DMA1_Stream6, (uint32_t)&USART2->DR);
+
+	/*Enable interrupt in NVIC*/
+	NVIC_EnableIRQ(DMA1_Stream6_IRQn);
+
+	/*Enable DMA transmitter in UART2*/
+	USART2->CR3 |= CR3_DMAT;
+}
+
+RAM_FUNC void debug_uart_tx_dma_start(const uint8_t *data, uint32_t length)
+{
+	DMA1->HIFCR = DMA_HIFCR_STREAM6;
+	uart_tx_dma_start(DMA1_Stream6, data, length);
+}
+
+RAM_FUNC void debug_uart_tx_dma_clear_flags(void)
+{
+	DMA1->HIFCR = DMA_HIFCR_STREAM6;
+}
+
+static void uart_tx_dma_init(DMA_Stream_TypeDef *stream, uint32_t periph_addr)
+{
+	/*Disable the stream and wait until it is off*/
+	stream->CR &= ~DMA_CR_EN;
+	while(stream->CR & DMA_CR_EN){}
+
+	stream->PAR = periph_addr;
+
+	/*Channel 4, byte transfers, memory increment, memory to peripheral*/
+	stream->CR = DMA_CR_CHSEL_4 | DMA_CR_MINC | DMA_CR_DIR_M2P | DMA_CR_TCIE;
+
+	/*Direct mode*/
+	stream->FCR = 0;
+}
+
+RAM_FUNC static void uart_tx_dma_start(DMA_Stream_TypeDef *stream, const uint8_t *data, uint32_t length)
+{
+	/*The stream turns itself off at the end of the previous transfer*/
+	while(stream->CR & DMA_CR_EN){}
+
+	stream->M0AR = (uint32_t)data;
+	stream->NDTR = length;
+
+	stream->CR |= DMA_CR_EN;
+}
+
+
 static void uart_write(int ch)
 {
 	/*Make sure transmit data register is empty*/
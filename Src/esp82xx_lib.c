@@ -1,215 +1,222 @@
 /*
  * File : esp82xx_lib.c
  * Author : Sriramkumar Jayaraman, Harshal Wadhwa
- * Description : This file is for ESP82xx module to connect Wi-Fi, send HTTP GET requests, and fetch firmware/version files.
+ * Description : This file is for ESP82xx module to connect Wi-Fi and carry the TCP connection of the HTTP client.
  */
 
 #include "esp82xx_lib.h"
+#include "fota_processor.h"
 
 
 
-#define TEMP_BUFF_LNG_SZ		600
+#define TEMP_BUFF_SHT_SZ		80
 #define TEMP_BUFF2_SHT_SZ		30
 
 // Macros for commonly used strings in the function
-#define SERVER_ADDRESS "esd-fota.batcave.net"
-
-#define TCP_START_COMMAND "AT+CIPSTART=\"TCP\",\"" SERVER_ADDRESS "\",80\r\n"
-#define OK_RESPONSE "OK\r\n"
-#define SEND_PROMPT ">"
-#define SEND_OK_RESPONSE "SEND OK\r\n"
-#define END_OF_HEADERS "\r\n\r\n"
-#define LINE_TERMINATOR "\r\n"
-#define CLOSED_RESPONSE "CLOSED\r\n"
+#define TCP_START_COMMAND "AT+CIPSTART=\"TCP\",\"%s\",%u\r\n"
 #define CIPSEND_COMMAND "AT+CIPSEND=%d\r\n"
-#define HTTP_GET_REQUEST_VER_FILE "GET /releases/firmware_version.txt HTTP/1.1\r\n" \
-                          "Host: " SERVER_ADDRESS "\r\n" \
-                          "Connection: close\r\n\r\n"
+#define CIPCLOSE_COMMAND "AT+CIPCLOSE\r\n"
 
-#define HTTP_GET_REQUEST_FIRM "GET /releases/%s HTTP/1.1\r\n" \
-                                "Host: " SERVER_ADDRESS "\r\n" \
-                                "Connection: close\r\n\r\n"
+/*Replies that end a wait no matter what was expected*/
+#define ESP_FAILURE_REPLIES		(ESP_REPLY_BIT(ESP_REPLY_ERROR) | ESP_REPLY_BIT(ESP_REPLY_FAIL) | \
+								 ESP_REPLY_BIT(ESP_REPLY_SEND_FAIL) | ESP_REPLY_BIT(ESP_REPLY_BUSY))
 
-
-static void esp82xx_reset(void);
-static void esp82xx_startup_test(void);
-static void esp82xx_sta_mode(void);
-static void esp82xx_ap_connect(char *ssid, char *password);
-
-void esp8266_init(char *ssid, char *password)
+/*Reply strings, in the order of espReply*/
+static const char * const esp_replies[NUM_OF_ESP_REPLIES] =
 {
-	esp82xx_reset();
-	esp82xx_startup_test();
-	esp82xx_sta_mode();
-	esp82xx_ap_connect(ssid, password);
-}
- static void esp82xx_startup_test(void)
+	"OK\r\n",
+	"ERROR\r\n",
+	"FAIL\r\n",
+	"SEND OK\r\n",
+	"SEND FAIL\r\n",
+	"CLOSED\r\n",
+	"+IPD,",
+	"WIFI GOT IP\r\n",
+	">",
+	"ready\r\n",
+	"busy p...",
+	"ALREADY CONNECTED\r\n"
+};
+
+static response_automaton esp_automaton;
+
+/*Connection state of the ESP, see espStatus*/
+static volatile espStatus esp_status = ESP_OFF;
+
+/*Commands built at run time must outlive their queue entry*/
+static char join_command[100];
+static char send_command[TEMP_BUFF2_SHT_SZ];
+static char start_command[TEMP_BUFF_SHT_SZ];
+
+static void esp82xx_step_done(void *ctx, atResult result, uint32_t reply);
+static void esp82xx_join_done(void *ctx, atResult result, uint32_t reply);
+static int esp82xx_run(void);
+
+/*Bring-up sequence: "ready" after the reset replaces the fixed one second sleep*/
+static const at_command esp_reset_cmd =
 {
-	/*Clear ESP uart buffer*/
-	buffer_clear(esp82xx_port);
-
-	/*Send test command*/
-	buffer_send_string("AT\r\n",esp82xx_port);
-
-	/*Wait for "OK" response*/
-	while(!(is_response("OK\r\n"))){}
+	"AT+RST\r\n", ESP_REPLY_BIT(ESP_REPLY_READY), 0, 5000, 1, 500,
+	esp82xx_step_done, "Reset was successful....\n\r", AT_NEW_EXCHANGE
+};
 
+static const at_command esp_startup_test_cmd =
+{
+	"AT\r\n", ESP_REPLY_BIT(ESP_REPLY_OK), ESP_FAILURE_REPLIES, 1000, 5, 200,
+	esp82xx_step_done, "AT startup test successful....\n\r", AT_NEW_EXCHANGE
+};
 
-	buffer_send_string("AT startup test successful....\n\r",debug_port);
-}
+static const at_command esp_sta_mode_cmd =
+{
+	"AT+CWMODE=1\r\n", ESP_REPLY_BIT(ESP_REPLY_OK), ESP_FAILURE_REPLIES, 1000, 3, 200,
+	esp82xx_step_done, "STA Mode set successful....\n\r", AT_NEW_EXCHANGE
+};
 
 
-static void esp82xx_reset(void)
+void esp8266_start(char *ssid, char *password)
 {
-	/*Clear ESP uart buffer*/
-	buffer_clear(esp82xx_port);
+	at_command join =
+	{
+		join_command, ESP_REPLY_BIT(ESP_REPLY_OK), ESP_FAILURE_REPLIES, 20000, 2, 1000,
+		esp82xx_join_done, 0, AT_NEW_EXCHANGE
+	};
 
-	/*Send test command*/
-	buffer_send_string("AT+RST\r\n",esp82xx_port);
+	/*Build the reply matcher once*/
+	response_automaton_build(&esp_automaton, esp_replies, NUM_OF_ESP_REPLIES);
+	at_engine_init(&esp_automaton);
 
-	/*Delay for 1 second*/
-	systick_delay_ms(1000);
+	/*Pust ssid, password and command into one string packet*/
+	snprintf(join_command,sizeof(join_command),"AT+CWJAP=\"%s\",\"%s\"\r\n",ssid,password);
 
-	/*Wait for "OK" response*/
-	while(!(is_response("OK\r\n"))){}
+	esp_status = ESP_BUSY;
 
-	buffer_send_string("Reset was successful....\n\r",debug_port);
+	at_engine_submit(&esp_reset_cmd);
+	at_engine_submit(&esp_startup_test_cmd);
+	at_engine_submit(&esp_sta_mode_cmd);
+	at_engine_submit(&join);
 }
 
-
-static void esp82xx_sta_mode(void)
+int esp8266_init(char *ssid, char *password)
 {
-	/*Clear ESP uart buffer*/
-	buffer_clear(esp82xx_port);
-
-	/*Send test command*/
-	buffer_send_string("AT+CWMODE=1\r\n",esp82xx_port);
+	esp8266_start(ssid, password);
 
-	/*Wait for "OK" response*/
-	while(!(is_response("OK\r\n"))){}
+	while(esp_status == ESP_BUSY)
+	{
+		at_engine_poll();
+	}
 
-
-	buffer_send_string("STA Mode set successful....\n\r",debug_port);
+	return (esp_status == ESP_READY) ? 1 : -1;
 }
 
-
-static void esp82xx_ap_connect(char *ssid, char *password)
+espStatus esp82xx_status(void)
 {
-	char data[80];
-
-	/*Clear ESP uart buffer*/
-	buffer_clear(esp82xx_port);
-
-	buffer_send_string("Connecting to access point....\n\r",debug_port);
-
-	/*Pust ssid, password and command into one string packet*/
-	sprintf(data,"AT+CWJAP=\"%s\",\"%s\"\r\n",ssid,password);
-
-	/*Send test command*/
-	buffer_send_string(data,esp82xx_port);
-
-
-
-	/*Wait for "OK" response*/
-	while(!(is_response("OK\r\n"))){}
-
-    sprintf(data,"Connected : \"%s\"\r\n",ssid);
-
-	buffer_send_string(data,debug_port);
+	return esp_status;
 }
 
-void esp82xx_get_firmware(char *dest_buffer, const char *firmware_file)
+const response_automaton *esp82xx_replies(void)
 {
-	/*Buffer to hold HTTP GET request and other string*/
-	char request_buffer[TEMP_BUFF_LNG_SZ] = {0};
-	char send_command_buffer[TEMP_BUFF2_SHT_SZ] = {0};
-
-	/*Clear esp uart buffer*/
-	buffer_clear(esp82xx_port);
-
-	/*Establish a TCP connection to the server*/
-	buffer_send_string(TCP_START_COMMAND,esp82xx_port);
-
-	/*Wait until connection is successfully established*/
-	while(!is_response(OK_RESPONSE)){}
-
-	/*Prepare the HTTP GET request to retrieve the file*/
-	snprintf(request_buffer, sizeof(request_buffer),HTTP_GET_REQUEST_FIRM,firmware_file);
-
-	/*Get the length of the prepared request*/
-	int request_length = strlen(request_buffer);
-
-	/*Prepare the AT+CIPSEND command with the request length */
-
-	snprintf(send_command_buffer,sizeof(send_command_buffer),CIPSEND_COMMAND,request_length);
-
-	/*Send the AT+CIPSEND command */
-	buffer_send_string(send_command_buffer,esp82xx_port);
-	buffer_send_string(send_command_buffer,debug_port);
-
-	/*Wait for the ESP to be ready to receive the HTTP GET request*/
-	while(!is_response(SEND_PROMPT)){}
-
-	/*Send the actual HTTP GET request to the server*/
-	buffer_send_string(request_buffer,esp82xx_port);
-
-	/*Wait to confirm that the data was sent*/
-	while(!is_response(SEND_OK_RESPONSE)){}
-
-	/*Wait for the HTTP response header to finish*/
-	while(!is_response(END_OF_HEADERS)){}
-
-	/*Copy the data to destination buffer*/
-	while(!copy_up_to_string(CLOSED_RESPONSE,dest_buffer)){}
-
-
-
+	return &esp_automaton;
 }
 
-
-void esp82xx_get_version_file(char *dest_buffer)
+static void esp82xx_step_done(void *ctx, atResult result, uint32_t reply)
 {
-	/*Buffer to hold HTTP GET request and other string*/
-	char request_buffer[TEMP_BUFF_LNG_SZ] = {0};
-	char send_command_buffer[TEMP_BUFF2_SHT_SZ] = {0};
-
-	/*Clear esp uart buffer*/
-	buffer_clear(esp82xx_port);
-
-	/*Establish a TCP connection to the server*/
-	buffer_send_string(TCP_START_COMMAND,esp82xx_port);
-
-	/*Wait until connection is successfully established*/
-	while(!is_response(OK_RESPONSE)){}
-
-	/*Prepare the HTTP GET request to retrieve the file*/
-	snprintf(request_buffer, sizeof(request_buffer),HTTP_GET_REQUEST_VER_FILE);
+	if(result == AT_DONE)
+	{
+#ifdef DEBUG_OUTPUT
+		buffer_send_string((const char *)ctx,debug_port);
+#endif
+	}
+	else if(result != AT_ABORTED)
+	{
+		/*Reported by the step that failed, the ones queued behind it come back aborted*/
+		esp_status = ESP_FAILED;
+#ifdef DEBUG_OUTPUT
+		buffer_send_string("ESP bring-up failed....\n\r",debug_port);
+#endif
+	}
+}
 
-	/*Get the length of the prepared request*/
-	int request_length = strlen(request_buffer);
+static void esp82xx_join_done(void *ctx, atResult result, uint32_t reply)
+{
+	if(result == AT_DONE)
+	{
+		esp_status = ESP_READY;
+#ifdef DEBUG_OUTPUT
+		buffer_send_string("Connected to access point....\n\r",debug_port);
+#endif
+	}
+	else if(result != AT_ABORTED)
+	{
+		esp_status = ESP_FAILED;
+#ifdef DEBUG_OUTPUT
+		buffer_send_string("Connecting to access point failed....\n\r",debug_port);
+#endif
+	}
+}
 
-	/*Prepare the AT+CIPSEND command with the request length */
+/*Poll the engine until the queued commands are done, returns 1 if all of them succeeded*/
+static int esp82xx_run(void)
+{
+	while(!at_engine_idle())
+	{
+		at_engine_poll();
+	}
 
-	snprintf(send_command_buffer,sizeof(send_command_buffer),CIPSEND_COMMAND,request_length);
+	return (at_engine_last_result() == AT_DONE) ? 1 : -1;
+}
 
-	/*Send the AT+CIPSEND command */
-	buffer_send_string(send_command_buffer,esp82xx_port);
+/*Open a TCP connection, returns 1 once the ESP reports it connected and -1 if it failed or timed out*/
+int esp82xx_connect(const char *host, uint16_t port)
+{
+	at_command cmd =
+	{
+		start_command, ESP_REPLY_BIT(ESP_REPLY_OK) | ESP_REPLY_BIT(ESP_REPLY_ALREADY_CONNECTED),
+		ESP_FAILURE_REPLIES, 10000, 1, 1000, 0, 0, AT_NEW_EXCHANGE
+	};
 
-	/*Wait for the ESP to be ready to receive the HTTP GET request*/
-	while(!is_response(SEND_PROMPT)){}
+	snprintf(start_command,sizeof(start_command),TCP_START_COMMAND,host,(unsigned int)port);
 
-	/*Send the actual HTTP GET request to the server*/
-	buffer_send_string(request_buffer,esp82xx_port);
+	at_engine_submit(&cmd);
 
-	/*Wait to confirm that the data was sent*/
-	while(!is_response(SEND_OK_RESPONSE)){}
+	return esp82xx_run();
+}
 
-	/*Wait for the HTTP response header to finish*/
-	while(!is_response(END_OF_HEADERS)){}
+/*Send data over the open connection. Responses to earlier requests may be arriving meanwhile, nothing is dropped.
+ *Returns 1 once the ESP reports "SEND OK" and -1 if any step failed or timed out*/
+int esp82xx_send(const char *data)
+{
+	at_command cmd =
+	{
+		send_command, ESP_REPLY_BIT(ESP_REPLY_PROMPT), ESP_FAILURE_REPLIES, 2000, 0, 0, 0, 0, 0
+	};
+
+	/*Prepare the AT+CIPSEND command with the data length, wait for the prompt*/
+	snprintf(send_command,sizeof(send_command),CIPSEND_COMMAND,(int)strlen(data));
+	at_engine_submit(&cmd);
+
+	/*Send the data and wait to confirm that it was sent, the reply to it is left in the ESP uart buffer*/
+	cmd.text = data;
+	cmd.expect = ESP_REPLY_BIT(ESP_REPLY_SEND_OK);
+	cmd.timeout_ms = 5000;
+	at_engine_submit(&cmd);
+
+	return esp82xx_run();
+}
 
-	/*Copy the data to destination buffer*/
-	while(!copy_up_to_string(CLOSED_RESPONSE,dest_buffer)){}
+/*Close the connection, along with whatever it left in the ESP uart buffer*/
+void esp82xx_close(void)
+{
+	at_command cmd =
+	{
+		CIPCLOSE_COMMAND, ESP_REPLY_BIT(ESP_REPLY_OK) | ESP_REPLY_BIT(ESP_REPLY_ERROR), 0, 2000, 0, 0, 0, 0,
+		AT_NEW_EXCHANGE
+	};
 
+	/*The deframer of the connection is done with*/
+	at_engine_route(0);
 
+	/*ERROR only means the connection is closed already*/
+	at_engine_submit(&cmd);
+	esp82xx_run();
 
+	buffer_clear(esp82xx_port);
 }
@@ -0,0 +1,275 @@
+/*
+ * File : flash_async.c
+ * Author : Prudhvi Raj Belide
+ * Description : This file implements the interrupt driven flash engine. Erase and program requests are queued and
+ * started one after the other from the FLASH end of operation and error interrupts, so the CPU can keep working
+ * while a sector erase or a page program runs.
+ */
+
+#include "flash_async.h"
+
+#define CR_ERRIE		(1U<<25)
+
+typedef struct
+{
+	flash_async_request queue[FLASH_ASYNC_QUEUE_SZ];
+	volatile uint32_t head;			/*Requests submitted*/
+	volatile uint32_t tail;			/*Requests finished*/
+	volatile uint8_t running;
+	uint32_t offset;				/*Bytes of the running program request already written*/
+	uint32_t unit;					/*Bytes of the program operation in flight*/
+	uint32_t operations;			/*Program operations of the running request*/
+	uint32_t start_cycles;
+
+}flash_async_engine;
+
+static flash_async_engine engine;
+
+static void flash_async_start(void);
+static void flash_async_write_unit(const flash_async_request *request);
+static void flash_async_finish(StatusTypeDef status, uint32_t error);
+static int flash_async_submit(const flash_async_request *request);
+
+
+void flash_async_init(void)
+{
+	engine.head    = 0;
+	engine.tail    = 0;
+	engine.running = 0;
+
+	/*Enable interrupt in NVIC*/
+	NVIC_EnableIRQ(FLASH_IRQn);
+}
+
+
+int flash_async_erase(uint32_t sector, uint32_t voltage_range, flash_async_callback callback, void *ctx)
+{
+	flash_async_request request;
+
+	request.type          = FLASH_ASYNC_ERASE;
+	request.address       = sector;
+	request.data          = 0;
+	request.length        = 0;
+	request.voltage_range = voltage_range;
+	request.callback      = callback;
+	request.ctx           = ctx;
+
+	return flash_async_submit(&request);
+}
+
+
+int flash_async_program(uint32_t address, const uint8_t *data, uint32_t length, uint32_t voltage_range,
+		flash_async_callback callback, void *ctx)
+{
+	flash_async_request request;
+
+	request.type          = FLASH_ASYNC_PROGRAM;
+	request.address       = address;
+	request.data          = data;
+	request.length        = length;
+	request.voltage_range = voltage_range;
+	request.callback      = callback;
+	request.ctx           = ctx;
+
+	return flash_async_submit(&request);
+}
+
+
+uint32_t flash_async_pending(void)
+{
+	return engine.head - engine.tail;
+}
+
+
+/*Wait until every queued request finished*/
+void flash_async_flush(void)
+{
+	while(flash_async_pending() != 0){}
+}
+
+
+static int flash_async_submit(const flash_async_request *request)
+{
+	int result = -1;
+
+	__disable_irq();
+
+	if((engine.head - engine.tail) < FLASH_ASYNC_QUEUE_SZ)
+	{
+		engine.queue[engine.head % FLASH_ASYNC_QUEUE_SZ] = *request;
+		engine.head++;
+
+		/*Kick the engine if it is idle, otherwise the interrupt picks the request up*/
+		if(!engine.running)
+		{
+			flash_async_start();
+		}
+
+		result = 0;
+	}
+
+	__enable_irq();
+
+	return result;
+}
+
+
+/*Start the request at the tail of the queue, called with interrupts disabled or from the FLASH interrupt*/
+RAM_FUNC static void flash_async_start(void)
+{
+	const flash_async_request *request = &engine.queue[engine.tail % FLASH_ASYNC_QUEUE_SZ];
+
+	engine.running = 1;
+	engine.offset = 0;
+	engine.operations = 0;
+	engine.start_cycles = DWT->CYCCNT;
+
+	if(flash_unlock() != DEV_OK)
+	{
+		flash_async_finish(DEV_ERROR, FLASH_ERROR_WRP);
+		return;
+	}
+
+	/*Enable end of operation and error interrupts*/
+	FLASH->CR |= FLASH_CR_EOPIE | CR_ERRIE;
+
+	if(request->type == FLASH_ASYNC_ERASE)
+	{
+		FLASH->CR &=~(FLASH_CR_PSIZE | FLASH_CR_SNB);
+		FLASH->CR |= flash_get_psize(request->voltage_range);
+
+		/*Set SER bit, select sector and start*/
+		FLASH->CR |= FLASH_CR_SER | (FLASH_SECTOR_SNB(request->address) << FLASH_CR_SNB_Pos);
+		FLASH->CR |= FLASH_CR_STRT;
+	}
+	else if(request->length == 0)
+	{
+		flash_async_finish(DEV_OK, FLASH_ERROR_NONE);
+	}
+	else
+	{
+		flash_async_write_unit(request);
+	}
+}
+
+
+/*Issue the next program operation, as wide as alignment and the voltage range allow*/
+RAM_FUNC static void flash_async_write_unit(const flash_async_request *request)
+{
+	uint32_t psize   = flash_get_psize(request->voltage_range);
+	uint32_t width   = 1U << (psize >> FLASH_CR_PSIZE_Pos);
+	uint32_t address = request->address + engine.offset;
+	const uint8_t *data = request->data + engine.offset;
+	uint32_t word;
+
+	if(((address & (width - 1)) != 0) || ((request->length - engine.offset) < width))
+	{
+		psize = FLASH_PSIZE_BYTE;
+		width = 1;
+	}
+
+	FLASH->CR &=~FLASH_CR_PSIZE;
+	FLASH->CR |= psize | FLASH_CR_PG;
+
+	engine.unit = width;
+	engine.operations++;
+
+	if(width == 1)
+	{
+		*(__IO uint8_t *)address = *data;
+	}
+	else if(width == 2)
+	{
+		*(__IO uint16_t *)address = (uint16_t)(data[0] | (data[1] << 8));
+	}
+	else
+	{
+		/*The source buffer may be unaligned, memcpy would run from flash*/
+		word = data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+		*(__IO uint32_t *)address = word;
+
+		if(width == 8)
+		{
+			/*Flush pipeline : ensure programming is performed steps.*/
+			__ISB();
+			word = data[4] | (data[5] << 8) | (data[6] << 16) | ((uint32_t)data[7] << 24);
+			*(__IO uint32_t *)(address + 4) = word;
+		}
+	}
+}
+
+
+/*Retire the running request and start the next one before the callback runs, so the callback may submit more*/
+RAM_FUNC static void flash_async_finish(StatusTypeDef status, uint32_t error)
+{
+	const flash_async_request *request = &engine.queue[engine.tail % FLASH_ASYNC_QUEUE_SZ];
+	flash_async_callback callback = request->callback;
+	void *ctx = request->ctx;
+
+	/*Clear program and erase bits*/
+	FLASH->CR &=~(FLASH_CR_PG | FLASH_CR_SER | FLASH_CR_SNB);
+
+	if(request->type == FLASH_ASYNC_ERASE)
+	{
+		flash_flush_caches();
+	}
+	else
+	{
+		flash_stats_record(engine.operations, engine.offset, DWT->CYCCNT - engine.start_cycles);
+	}
+
+	if(status != DEV_OK)
+	{
+		pFlash.ErrorCode |= error;
+	}
+
+	engine.tail++;
+	engine.running = 0;
+
+	if(engine.head != engine.tail)
+	{
+		flash_async_start();
+	}
+	else
+	{
+		FLASH->CR &=~(FLASH_CR_EOPIE | CR_ERRIE);
+		flash_lock();
+	}
+
+	if(callback != 0)
+	{
+		callback(ctx, status, error);
+	}
+}
+
+
+RAM_FUNC void FLASH_IRQHandler(void)
+{
+	uint32_t status_reg = FLASH->SR;
+	const flash_async_request *request = &engine.queue[engine.tail % FLASH_ASYNC_QUEUE_SZ];
+
+	if((status_reg & FLASH_SR_ERRORS) != RESET)
+	{
+		/*Clear the flags and fail the running request*/
+		FLASH->SR = status_reg & (FLASH_SR_ERRORS | FLASH_SR_EOP);
+		flash_async_finish(DEV_ERROR, flash_decode_error(status_reg));
+	}
+	else if((status_reg & FLASH_SR_EOP) != RESET)
+	{
+		/*Clear end of operation pending bit*/
+		FLASH->SR = FLASH_SR_EOP;
+
+		if(request->type == FLASH_ASYNC_PROGRAM)
+		{
+			engine.offset += engine.unit;
+
+			if(engine.offset < request->length)
+			{
+				flash_async_write_unit(request);
+				return;
+			}
+		}
+
+		flash_async_finish(DEV_OK, FLASH_ERROR_NONE);
+	}
+}
@@ -9,21 +9,40 @@
 #include "flash_driver.h"
 #include "timebase.h"
 
-#define TEMP_BUFF_SZ		4
 
 
+#define DWT_CTRL_CYCCNTENA		(1U<<0)
+#define DEMCR_TRCENA			(1U<<24)
+
 
 FLASH_ProcessTypeDef pFlash;
-uint8_t temp_buff[TEMP_BUFF_SZ];
+static flash_program_stats program_stats;
+
+#define OPTCR_DB1M				(1U<<30)
+
+/*Parts whose CMSIS headers ship in chip_headers, the sector layout follows from the flash size*/
+static const flash_part flash_parts[] =
+{
+	{0x423, 0, "STM32F401xB/C"},
+	{0x433, 0, "STM32F401xD/E"},
+	{0x413, 0, "STM32F405/407"},
+	{0x431, 0, "STM32F411"},
+	{0x419, 1, "STM32F42x/43x"},
+	{0x421, 0, "STM32F446"},
+	{0x000, 0, "Unknown STM32F4"}
+};
+
+static flash_geometry geometry;
 
 StatusTypeDef  flash_wait_for_last_operation(uint32_t timeout);
-static void flush_caches(void);
+static StatusTypeDef flash_wait_ready(void);
 
 
-StatusTypeDef flash_ex_erase(FLASH_EraseInitTypeDef *pt_erase_init, uint32_t *sect_err)
+RAM_FUNC StatusTypeDef flash_ex_erase(FLASH_EraseInitTypeDef *pt_erase_init, uint32_t *sect_err)
 {
 	StatusTypeDef  status =  DEV_ERROR;
 	uint32_t index = 0U;
+	uint32_t count = 0U;
 
 	/*wait for last operation to be completed*/
 	status = flash_wait_for_last_operation(FLASH_TIMEOUT_VALUE);
@@ -46,7 +65,7 @@ StatusTypeDef flash_ex_erase(FLASH_EraseInitTypeDef *pt_erase_init, uint32_t *se
 	   else
 	   {
 		   /*Sector erase*/
-		   for(index = pt_erase_init->Sector; index <  (pt_erase_init->NbSectors + pt_erase_init->Sector); index++)
+		   for(index = pt_erase_init->Sector; count < pt_erase_init->NbSectors; count++, index = flash_next_sector(index))
 		   {
 			   flash_sector_erase(index, (uint8_t)pt_erase_init->VoltageRange);
 
@@ -64,7 +83,7 @@ StatusTypeDef flash_ex_erase(FLASH_EraseInitTypeDef *pt_erase_init, uint32_t *se
 		   }
 	   }
 
-	   flush_caches();
+	   flash_flush_caches();
 
 	}
 
@@ -72,7 +91,7 @@ StatusTypeDef flash_ex_erase(FLASH_EraseInitTypeDef *pt_erase_init, uint32_t *se
 }
 
 
-void flash_sector_erase(uint32_t sector, uint8_t voltage_range)
+RAM_FUNC void flash_sector_erase(uint32_t sector, uint8_t voltage_range)
 {
 	uint32_t tmp_psize = 0U;
 
@@ -98,7 +117,7 @@ void flash_sector_erase(uint32_t sector, uint8_t voltage_range)
 	FLASH->CR |= tmp_psize;
 
 	/*Set SER bit and select sector*/
-	FLASH->CR |=  FLASH_CR_SER |(sector << FLASH_CR_SNB_Pos);
+	FLASH->CR |=  FLASH_CR_SER |(FLASH_SECTOR_SNB(sector) << FLASH_CR_SNB_Pos);
 
 	/*Very IMPORTANT*/
 	FLASH->CR |= FLASH_CR_STRT;
@@ -107,7 +126,7 @@ void flash_sector_erase(uint32_t sector, uint8_t voltage_range)
 
 }
 
-void flash_mass_erase(uint8_t voltage_range)
+RAM_FUNC void flash_mass_erase(uint8_t voltage_range)
 {
 	/*Clear PSIZE field*/
 	FLASH->CR &=~FLASH_CR_PSIZE;
@@ -118,7 +137,7 @@ void flash_mass_erase(uint8_t voltage_range)
 	FLASH->CR |=  FLASH_CR_STRT |((uint32_t)voltage_range <<8U);
 }
 
-StatusTypeDef  flash_wait_for_last_operation(uint32_t timeout)
+RAM_FUNC StatusTypeDef  flash_wait_for_last_operation(uint32_t timeout)
 {
    uint32_t tickstart = 0U;
 
@@ -144,19 +163,31 @@ StatusTypeDef  flash_wait_for_last_operation(uint32_t timeout)
 	   FLASH->SR = (1U<<0);
    }
 
+   /*Check error flags*/
+   if((FLASH->SR & FLASH_SR_ERRORS) != RESET)
+   {
+	   pFlash.ErrorCode = flash_decode_error(FLASH->SR);
+	   FLASH->SR = FLASH_SR_ERRORS;
+	   return DEV_ERROR;
+   }
+
    return DEV_OK;
 }
 
 
-StatusTypeDef flash_program(uint32_t prg_type,  uint32_t address, uint64_t data)
+RAM_FUNC StatusTypeDef flash_program(uint32_t prg_type,  uint32_t address, uint64_t data)
 {
 	StatusTypeDef status = DEV_ERROR;
+	uint32_t start_cycles = DWT->CYCCNT;
 
 	/*wait for last operation to be completed*/
 	status = flash_wait_for_last_operation(FLASH_TIMEOUT_VALUE);
 
 	if( status == DEV_OK)
 	{
+		program_stats.operations++;
+		program_stats.bytes += (1U << prg_type);
+
 		if(prg_type == FLASH_TYPEPROGRAM_BYTE)
 		{
 			flash_program_byte(address,(uint8_t)data);
@@ -183,9 +214,196 @@ StatusTypeDef flash_program(uint32_t prg_type,  uint32_t address, uint64_t data)
 		FLASH->CR &=~FLASH_CR_PG;
 	}
 
+	program_stats.cycles += DWT->CYCCNT - start_cycles;
+
+	return status;
+}
+
+
+/*Program a whole buffer with one setup. The aligned body is written with the widest parallelism the voltage
+ *range allows (x32, or x64 with external Vpp), only the unaligned head and tail are programmed byte-wise.
+ *The target must be erased and the flash unlocked.*/
+RAM_FUNC StatusTypeDef flash_program_buffer(uint32_t address, const uint8_t *data, uint32_t length, uint32_t voltage_range)
+{
+	StatusTypeDef status;
+	uint32_t start_cycles = DWT->CYCCNT;
+	uint32_t psize = flash_get_psize(voltage_range);
+	uint32_t width = 1U << (psize >> FLASH_CR_PSIZE_Pos);
+	flash_program_plan plan;
+	uint32_t count;
+	uint32_t word;
+
+	status = flash_wait_ready();
+
+	if(status != DEV_OK)
+	{
+		return status;
+	}
+
+	flash_plan_program(address, length, width, &plan);
+
+	/*Clear stale error flags, they would block programming*/
+	FLASH->SR = FLASH_SR_ERRORS;
+
+	/*Head: byte-wise up to the first aligned address*/
+	FLASH->CR &=~FLASH_CR_PSIZE;
+	FLASH->CR |= FLASH_PSIZE_BYTE | FLASH_CR_PG;
+
+	for(count = 0; (count < plan.head) && (status == DEV_OK); count++)
+	{
+		*(__IO uint8_t *)address = *data++;
+		program_stats.operations++;
+		program_stats.bytes++;
+		address++;
+		status = flash_wait_ready();
+	}
+
+	/*Body: one operation per word or double word*/
+	if((plan.body != 0) && (status == DEV_OK))
+	{
+		FLASH->CR &=~FLASH_CR_PSIZE;
+		FLASH->CR |= psize;
+
+		for(count = 0; (count < plan.body) && (status == DEV_OK); count++)
+		{
+			if(width == 1)
+			{
+				*(__IO uint8_t *)address = *data;
+			}
+			else if(width == 2)
+			{
+				*(__IO uint16_t *)address = (uint16_t)(data[0] | (data[1] << 8));
+			}
+			else
+			{
+				/*The source buffer may be unaligned, memcpy would run from flash*/
+				word = data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t)data[3] << 24);
+				*(__IO uint32_t *)address = word;
+
+				if(width == 8)
+				{
+					/*Flush pipeline : ensure programming is performed steps.*/
+					__ISB();
+					word = data[4] | (data[5] << 8) | (data[6] << 16) | ((uint32_t)data[7] << 24);
+					*(__IO uint32_t *)(address + 4) = word;
+				}
+			}
+
+			program_stats.operations++;
+			program_stats.bytes += width;
+			address += width;
+			data    += width;
+			status = flash_wait_ready();
+		}
+
+		FLASH->CR &=~FLASH_CR_PSIZE;
+		FLASH->CR |= FLASH_PSIZE_BYTE;
+	}
+
+	/*Tail: byte-wise*/
+	for(count = 0; (count < plan.tail) && (status == DEV_OK); count++)
+	{
+		*(__IO uint8_t *)address = *data++;
+		program_stats.operations++;
+		program_stats.bytes++;
+		address++;
+		status = flash_wait_ready();
+	}
+
+	/*Clear Program bit*/
+	FLASH->CR &=~FLASH_CR_PG;
+
+	program_stats.cycles += DWT->CYCCNT - start_cycles;
+
 	return status;
 }
-void flash_program_byte(uint32_t address, uint8_t data)
+
+
+void flash_stats_reset(void)
+{
+	/*Start the cycle counter used to time programming*/
+	CoreDebug->DEMCR |= DEMCR_TRCENA;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA;
+
+	program_stats.operations = 0;
+	program_stats.bytes      = 0;
+	program_stats.cycles     = 0;
+}
+
+const flash_program_stats *flash_get_stats(void)
+{
+	return &program_stats;
+}
+
+/*Account for programming done outside this file*/
+RAM_FUNC void flash_stats_record(uint32_t operations, uint32_t bytes, uint32_t cycles)
+{
+	program_stats.operations += operations;
+	program_stats.bytes      += bytes;
+	program_stats.cycles     += cycles;
+}
+
+uint32_t flash_stats_bytes_per_sec(void)
+{
+	if(program_stats.cycles == 0)
+	{
+		return 0;
+	}
+
+	return (uint32_t)(((uint64_t)program_stats.bytes * FLASH_STATS_CPU_HZ) / program_stats.cycles);
+}
+
+
+/*Wait for the running program operation and fold its error flags into pFlash.ErrorCode*/
+RAM_FUNC static StatusTypeDef flash_wait_ready(void)
+{
+	uint32_t tickstart;
+	uint32_t errors;
+
+	if((FLASH->SR & FLASH_SR_BSY) != RESET)
+	{
+		tickstart = get_tick();
+
+		while((FLASH->SR & FLASH_SR_BSY) != RESET)
+		{
+			if((get_tick() - tickstart) > FLASH_TIMEOUT_VALUE)
+			{
+				return DEV_TIMEOUT;
+			}
+		}
+	}
+
+	errors = FLASH->SR & FLASH_SR_ERRORS;
+
+	if(errors != 0)
+	{
+		pFlash.ErrorCode |= flash_decode_error(errors);
+		FLASH->SR = errors;
+		return DEV_ERROR;
+	}
+
+	return DEV_OK;
+}
+
+/*Program parallelism allowed by the supply voltage range*/
+RAM_FUNC uint32_t flash_get_psize(uint32_t voltage_range)
+{
+	if(voltage_range == FLASH_VOLTAGE_RANGE_1)
+	{
+		return FLASH_PSIZE_BYTE;
+	}
+	else if(voltage_range == FLASH_VOLTAGE_RANGE_2)
+	{
+		return FLASH_PSIZE_HALF_WORD;
+	}
+	else if(voltage_range == FLASH_VOLTAGE_RANGE_3)
+	{
+		return FLASH_PSIZE_WORD;
+	}
+
+	return FLASH_PSIZE_DOUBLE_WORD;
+}
+RAM_FUNC void flash_program_byte(uint32_t address, uint8_t data)
 {
 	/*Clear PSIZE field*/
 	FLASH->CR &=~FLASH_CR_PSIZE;
@@ -200,7 +418,7 @@ void flash_program_byte(uint32_t address, uint8_t data)
 	*(__IO uint8_t *)address =  data;
 }
 
-void flash_program_halfword(uint32_t address, uint16_t data)
+RAM_FUNC void flash_program_halfword(uint32_t address, uint16_t data)
 {
 	/*Clear PSIZE field*/
 	FLASH->CR &=~FLASH_CR_PSIZE;
@@ -215,7 +433,7 @@ void flash_program_halfword(uint32_t address, uint16_t data)
 	*(__IO uint16_t *)address =  data;
 }
 
-void flash_program_word(uint32_t address, uint32_t data)
+RAM_FUNC void flash_program_word(uint32_t address, uint32_t data)
 {
 	/*Clear PSIZE field*/
 	FLASH->CR &=~FLASH_CR_PSIZE;
@@ -230,7 +448,7 @@ void flash_program_word(uint32_t address, uint32_t data)
 	*(__IO uint32_t *)address =  data;
 }
 
-void flash_program_doubleword(uint32_t address, uint64_t data)
+RAM_FUNC void flash_program_doubleword(uint32_t address, uint64_t data)
 {
 	/*Clear PSIZE field*/
 	FLASH->CR &=~FLASH_CR_PSIZE;
@@ -251,7 +469,7 @@ void flash_program_doubleword(uint32_t address, uint64_t data)
 	*(__IO uint32_t *)(address+4) =  (uint32_t)(data>>32);
 }
 
-static void flush_caches(void)
+RAM_FUNC void flash_flush_caches(void)
 {
 	/*Flush instruction cache*/
 	  if (READ_BIT(FLASH->ACR, FLASH_ACR_ICEN) != RESET)
@@ -285,7 +503,7 @@ static void flush_caches(void)
 }
 
 
-StatusTypeDef flash_unlock(void)
+RAM_FUNC StatusTypeDef flash_unlock(void)
 {
 	StatusTypeDef status = DEV_OK;
 
@@ -303,10 +521,13 @@ StatusTypeDef flash_unlock(void)
 
 	}
 
+	/*Stale error flags would block the next operation*/
+	FLASH->SR = FLASH_SR_ERRORS;
+
 	return status;
 }
 
-StatusTypeDef flash_lock(void)
+RAM_FUNC StatusTypeDef flash_lock(void)
 {
 	FLASH->CR |= FLASH_CR_LOCK;
 	return DEV_OK;
@@ -318,87 +539,232 @@ uint32_t flash_get_error(void)
 	return pFlash.ErrorCode;
 }
 
-static uint32_t get_sector(uint32_t address)
+/*Translate FLASH->SR error flags into FLASH_ERROR_* bits*/
+RAM_FUNC uint32_t flash_decode_error(uint32_t status_reg)
 {
-	uint32_t sector = 0;
-	if((address < 0x08003FFF) && (address >= 0x08000000))
-	 {
-	     sector = FLASH_SECTOR_0;
-	 }
-   else if((address < 0x08007FFF) && (address >= 0x08004000))
-   {
-	 sector = FLASH_SECTOR_1;
-   }
-   else if((address < 0x0800BFFF) && (address >= 0x08008000))
-   {
-	 sector = FLASH_SECTOR_2;
-   }
-   else if((address < 0x0800FFFF) && (address >= 0x0800C000))
-   {
-	 sector = FLASH_SECTOR_3;
-   }
-   else if((address < 0x0801FFFF) && (address >= 0x08010000))
-   {
-	 sector = FLASH_SECTOR_4;
-   }
-   else if((address < 0x0803FFFF) && (address >= 0x08020000))
-   {
-	 sector = FLASH_SECTOR_5;
-   }
-   else if((address < 0x0805FFFF) && (address >= 0x08040000))
-   {
-	 sector = FLASH_SECTOR_6;
-   }
-   else if((address < 0x0807FFFF) && (address >= 0x08060000))
-   {
-	 sector = FLASH_SECTOR_7;
-   }
-   else
-   {
-     //Do something
-   }
+	uint32_t error = FLASH_ERROR_NONE;
+
+	if((status_reg & FLASH_SR_RDERR) != RESET)
+	{
+		error |= FLASH_ERROR_RD;
+	}
+
+	if((status_reg & FLASH_SR_PGSERR) != RESET)
+	{
+		error |= FLASH_ERROR_PGS;
+	}
+
+	if((status_reg & FLASH_SR_PGPERR) != RESET)
+	{
+		error |= FLASH_ERROR_PGP;
+	}
+
+	if((status_reg & FLASH_SR_PGAERR) != RESET)
+	{
+		error |= FLASH_ERROR_PGA;
+	}
+
+	if((status_reg & FLASH_SR_WRPERR) != RESET)
+	{
+		error |= FLASH_ERROR_WRP;
+	}
+
+	if((status_reg & FLASH_SR_SOP) != RESET)
+	{
+		error |= FLASH_ERROR_OPERATION;
+	}
+
+	return error;
+}
+
+/*Initialize the geometry from the device ID and the flash size register*/
+void flash_geometry_init(void)
+{
+	uint32_t dev_id = DBGMCU->IDCODE & DBGMCU_IDCODE_DEV_ID_Msk;
+	uint32_t index;
+
+	/*The last entry matches any part*/
+	for(index = 0; index < ((sizeof(flash_parts) / sizeof(flash_parts[0])) - 1); index++)
+	{
+		if(flash_parts[index].dev_id == dev_id)
+		{
+			break;
+		}
+	}
+
+	geometry.part = &flash_parts[index];
+	geometry.size = (uint32_t)(*(__IO uint16_t *)FLASHSIZE_BASE) * 1024U;
+
+	/*2MB parts always run dual bank, 1MB parts when DB1M is set*/
+	geometry.dual_bank = geometry.part->dual_bank &&
+			((geometry.size == 0x200000U) || ((geometry.size == 0x100000U) && ((FLASH->OPTCR & OPTCR_DB1M) != 0)));
+
+	geometry.bank_size = geometry.dual_bank ? (geometry.size / 2U) : geometry.size;
+	geometry.sectors_per_bank = 5U + ((geometry.bank_size - FLASH_LARGE_SECTOR_SZ) / FLASH_LARGE_SECTOR_SZ);
+}
+
+const flash_geometry *flash_get_geometry(void)
+{
+	if(geometry.part == 0)
+	{
+		flash_geometry_init();
+	}
+
+	return &geometry;
+}
+
+/*Sector holding an address, FLASH_SECTOR_INVALID outside the flash*/
+uint32_t get_sector(uint32_t address)
+{
+	const flash_geometry *geo = flash_get_geometry();
+	uint32_t offset = address - FLASH_BASE;
+	uint32_t first = 0;
+
+	if((address < FLASH_BASE) || (offset >= geo->size))
+	{
+		return FLASH_SECTOR_INVALID;
+	}
+
+	if(geo->dual_bank && (offset >= geo->bank_size))
+	{
+		offset -= geo->bank_size;
+		first   = FLASH_BANK2_FIRST_SECTOR;
+	}
 
-	return sector;
+	if(offset < FLASH_MEDIUM_SECTOR_SZ)
+	{
+		return first + (offset / FLASH_SMALL_SECTOR_SZ);
+	}
+	else if(offset < FLASH_LARGE_SECTOR_SZ)
+	{
+		return first + 4U;
+	}
 
+	return first + 4U + (offset / FLASH_LARGE_SECTOR_SZ);
 }
 
-uint32_t flash_write_data_byte(uint32_t start_sect_addr, uint8_t *data, uint16_t numberofbytes)
+/*First address of a sector, 0 for a sector the device does not have*/
+uint32_t get_sector_address(uint32_t sector)
+{
+	const flash_geometry *geo = flash_get_geometry();
+	uint32_t address = FLASH_BASE;
+
+	if(geo->dual_bank && (sector >= FLASH_BANK2_FIRST_SECTOR))
+	{
+		sector  -= FLASH_BANK2_FIRST_SECTOR;
+		address += geo->bank_size;
+	}
+
+	if(sector >= geo->sectors_per_bank)
+	{
+		return 0;
+	}
+
+	if(sector < 4U)
+	{
+		return address + (sector * FLASH_SMALL_SECTOR_SZ);
+	}
+
+	return address + ((sector - 4U) * FLASH_LARGE_SECTOR_SZ) + FLASH_MEDIUM_SECTOR_SZ;
+}
+
+/*Size of a sector, 0 for a sector the device does not have*/
+uint32_t get_sector_size(uint32_t sector)
+{
+	const flash_geometry *geo = flash_get_geometry();
+
+	if(geo->dual_bank && (sector >= FLASH_BANK2_FIRST_SECTOR))
+	{
+		sector -= FLASH_BANK2_FIRST_SECTOR;
+	}
+
+	if(sector >= geo->sectors_per_bank)
+	{
+		return 0;
+	}
+
+	if(sector < 4U)
+	{
+		return FLASH_SMALL_SECTOR_SZ;
+	}
+	else if(sector == 4U)
+	{
+		return FLASH_MEDIUM_SECTOR_SZ;
+	}
+
+	return FLASH_LARGE_SECTOR_SZ;
+}
+
+/*Sector following a sector in address order, skips the numbering gap in front of bank 2*/
+RAM_FUNC uint32_t flash_next_sector(uint32_t sector)
+{
+	if(geometry.dual_bank && ((sector + 1U) == geometry.sectors_per_bank))
+	{
+		return FLASH_BANK2_FIRST_SECTOR;
+	}
+
+	return sector + 1U;
+}
+
+/*Sectors touched by an address range*/
+StatusTypeDef flash_get_sector_span(uint32_t address, uint32_t length, flash_sector_span *span)
+{
+	const flash_geometry *geo = flash_get_geometry();
+
+	if(length == 0)
+	{
+		return DEV_ERROR;
+	}
+
+	span->first = get_sector(address);
+	span->last  = get_sector(address + length - 1);
+
+	if((span->first == FLASH_SECTOR_INVALID) || (span->last == FLASH_SECTOR_INVALID) || (span->last < span->first))
+	{
+		return DEV_ERROR;
+	}
+
+	span->count = (span->last - span->first) + 1;
+
+	/*Range crosses from bank 1 into bank 2*/
+	if((span->first < FLASH_BANK2_FIRST_SECTOR) && (span->last >= FLASH_BANK2_FIRST_SECTOR))
+	{
+		span->count -= FLASH_BANK2_FIRST_SECTOR - geo->sectors_per_bank;
+	}
+
+	return DEV_OK;
+}
+
+uint32_t flash_write_data_byte(uint32_t start_sect_addr, uint8_t *data, uint32_t numberofbytes)
 {
     FLASH_EraseInitTypeDef EraseInitStruct;
+    flash_sector_span span;
     uint32_t sect_err;
-    uint16_t write_count  = 0;
 
     /* Unlock flash */
     flash_unlock();
 
-    /* Get Number of sectors to erase starting from the first sector */
-    uint32_t start_sector = get_sector(start_sect_addr);
-    uint32_t end_sect_addr = start_sect_addr + numberofbytes;
-    uint32_t end_sector = get_sector(end_sect_addr);
+    /* Get the sectors to erase */
+    if(flash_get_sector_span(start_sect_addr, numberofbytes, &span) != DEV_OK)
+    {
+        return FLASH_ERROR_OPERATION;
+    }
 
     /* Initialize EraseInit Struct */
     EraseInitStruct.TypeErase = FLASH_TYPEERASE_SECTORS;
     EraseInitStruct.VoltageRange = FLASH_VOLTAGE_RANGE_3;
-    EraseInitStruct.Sector = start_sector;
-    EraseInitStruct.NbSectors = (end_sector - start_sector) + 1;
+    EraseInitStruct.Sector = span.first;
+    EraseInitStruct.NbSectors = span.count;
 
     if(flash_ex_erase(&EraseInitStruct, &sect_err) != DEV_OK)
     {
         return flash_get_error();
     }
 
-    /* Program flash byte-by-byte */
-    while(write_count < numberofbytes)
+    /* Program the buffer word-by-word, unaligned ends byte-by-byte */
+    if(flash_program_buffer(start_sect_addr, data, numberofbytes, FLASH_VOLTAGE_RANGE_3) != DEV_OK)
     {
-        if(flash_program(FLASH_TYPEPROGRAM_BYTE, start_sect_addr, data[write_count]) == DEV_OK)
-        {
-            start_sect_addr += 1;  // Move to the next byte address
-            write_count++;
-        }
-        else
-        {
-            return flash_get_error();
-        }
+        return flash_get_error();
     }
 
     return 0;
@@ -408,22 +774,24 @@ uint32_t flash_write_data_byte(uint32_t start_sect_addr, uint8_t *data, uint16_t
 uint32_t flash_write_data(uint32_t start_sect_addr,uint32_t *data, uint16_t numberofwords)
 {
 	FLASH_EraseInitTypeDef EraseInitStruct;
+	flash_sector_span span;
 	uint32_t sect_err;
 	uint16_t write_count  = 0;
 
 	/*Unlock flash*/
 	flash_unlock();
 
-	/*Get Number of sectors to erase starting from first sector*/
-	uint32_t start_sector =  get_sector(start_sect_addr);
-	uint32_t end_sect_addr =  start_sect_addr + numberofwords * 4;
-	uint32_t end_sector =  get_sector(end_sect_addr);
+	/*Get the sectors to erase*/
+	if(flash_get_sector_span(start_sect_addr, numberofwords * 4, &span) != DEV_OK)
+	{
+		return FLASH_ERROR_OPERATION;
+	}
 
 	/*Initialize EraseInit Struct*/
 	EraseInitStruct.TypeErase =  FLASH_TYPEERASE_SECTORS;
 	EraseInitStruct.VoltageRange = FLASH_VOLTAGE_RANGE_3;
-	EraseInitStruct.Sector       =  start_sector;
-	EraseInitStruct.NbSectors    =  (end_sector - start_sector) + 1;
+	EraseInitStruct.Sector       =  span.first;
+	EraseInitStruct.NbSectors    =  span.count;
 
 	if(flash_ex_erase(&EraseInitStruct, &sect_err) != DEV_OK )
 	{
@@ -470,40 +838,6 @@ void flash_read_data(uint32_t start_sect_addr, uint32_t *rx_buff, uint16_t numbe
 
 }
 
-void float_to_bytes(uint8_t * rsult_buff, float value)
-{
-	union{
-		float float_value;
-		uint8_t bytes_value[4];
-	}data_t;
-
-	data_t.float_value = value;
-
-	for( int i = 0; i < 4; i++)
-	{
-		rsult_buff[i] = data_t.bytes_value[i];
-	}
-
-}
-
-float bytes_to_float(uint8_t * value)
-{
-	float result;
-	union{
-		float float_value;
-		uint8_t bytes_value[4];
-	}data_t;
-
-	for(int i = 0; i < 4; i++)
-	{
-		data_t.bytes_value[i] =  value[i];
-	}
-
-	result =  data_t.float_value;
-
-	return result;
-}
-
  void get_str(uint32_t *src_data, char *dest_buff)
  {
 
@@ -519,22 +853,6 @@ float bytes_to_float(uint8_t * value)
  }
 
 
- void flash_write_num(uint32_t start_sect_addr, float num)
- {
-	 float_to_bytes(temp_buff, num);
-	 flash_write_data(start_sect_addr,(uint32_t *)temp_buff, 1);
- }
-
- float flash_read_num(uint32_t start_sect_addr)
- {
-	 uint8_t buff[4];
-	 float value;
-	 flash_read_data(start_sect_addr,(uint32_t *)buff,1);
-	 value =  bytes_to_float(buff);
-
-	 return value;
- }
-
  /**
   * @brief Writes data to flash memory starting from a specific address.
   *
@@ -0,0 +1,247 @@
+/*
+ * File : flash_stream.c
+ * Author : Prudhvi Raj Belide
+ * Description : This file implements the streaming flash writer. Incoming firmware bytes are collected in a page
+ * buffer and programmed into the target slot every time the page fills up, so the image size is only limited by
+ * the slot and not by RAM. Erase and program run on the interrupt driven flash engine and the next page is filled
+ * while the previous one is programmed. The CPU stalls while a sector is erased, so the caller erases what the image
+ * needs before its data is requested instead of in the middle of the stream. A sector the caller does not erase is
+ * kept, the pages written to it must match the flash and are skipped.
+ */
+
+#include <string.h>
+#include "flash_stream.h"
+
+static StatusTypeDef flash_stream_flush(flash_stream *stream);
+static StatusTypeDef flash_stream_mark(flash_stream *stream, uint32_t offset, uint32_t length, uint8_t erase);
+static void flash_stream_erased(void *ctx, StatusTypeDef status, uint32_t error);
+static void flash_stream_programmed(void *ctx, StatusTypeDef status, uint32_t error);
+
+
+StatusTypeDef flash_stream_open(flash_stream *stream, uint32_t start_address, uint32_t size)
+{
+	stream->start_address  = start_address;
+	stream->end_address    = start_address + size;
+	stream->write_address  = start_address;
+	stream->fill           = 0;
+	stream->erased_sectors = 0;
+	stream->submitted      = 0;
+	stream->completed      = 0;
+	stream->status         = DEV_OK;
+	stream->pages_skipped  = 0;
+
+	/*Nothing is erased here, the caller erases what it writes with flash_stream_erase()*/
+	return stream->status;
+}
+
+
+/*Queue the erase of every sector touching length bytes at offset into the slot that is not queued yet.
+ *The caller can start this long before the data arrives, the pages queue up behind the erases*/
+StatusTypeDef flash_stream_erase(flash_stream *stream, uint32_t offset, uint32_t length)
+{
+	return flash_stream_mark(stream, offset, length, 1);
+}
+
+
+/*Pick up a write the stream of an earlier boot left at offset. The sectors touching the first length bytes were
+ *erased before it started, they are marked as erased without erasing them again*/
+StatusTypeDef flash_stream_resume(flash_stream *stream, uint32_t offset, uint32_t length)
+{
+	if((offset > length) || ((offset % FLASH_STREAM_PAGE_SZ) != 0) || (stream->fill != 0) ||
+	   (stream->write_address != stream->start_address))
+	{
+		return DEV_ERROR;
+	}
+
+	if(flash_stream_mark(stream, 0, length, 0) == DEV_OK)
+	{
+		stream->write_address += offset;
+	}
+
+	return stream->status;
+}
+
+
+/*Returns 1 if no sector touching length bytes at offset into the slot is erased, the flash there is kept*/
+uint8_t flash_stream_is_kept(const flash_stream *stream, uint32_t offset, uint32_t length)
+{
+	uint32_t address = stream->start_address + offset;
+	uint32_t sector;
+
+	while(address < (stream->start_address + offset + length))
+	{
+		sector = get_sector(address);
+
+		if((sector == FLASH_SECTOR_INVALID) || (stream->erased_sectors & (1UL << sector)))
+		{
+			return 0;
+		}
+
+		address = get_sector_address(sector) + get_sector_size(sector);
+	}
+
+	return 1;
+}
+
+
+StatusTypeDef flash_stream_write(flash_stream *stream, const uint8_t *data, uint32_t length)
+{
+	uint32_t chunk;
+	uint8_t *page;
+
+	while((length != 0) && (stream->status == DEV_OK))
+	{
+		/*The page is reused once the engine is done with it*/
+		while((stream->submitted - stream->completed) >= FLASH_STREAM_NUM_PAGES){}
+
+		/*Copy as much as fits into the page buffer*/
+		page  = stream->page[stream->submitted % FLASH_STREAM_NUM_PAGES];
+		chunk = FLASH_STREAM_PAGE_SZ - stream->fill;
+
+		if(chunk > length)
+		{
+			chunk = length;
+		}
+
+		memcpy(&page[stream->fill], data, chunk);
+		stream->fill += chunk;
+		data   += chunk;
+		length -= chunk;
+
+		/*Program the page once it is full*/
+		if(stream->fill == FLASH_STREAM_PAGE_SZ)
+		{
+			flash_stream_flush(stream);
+		}
+	}
+
+	return stream->status;
+}
+
+
+StatusTypeDef flash_stream_close(flash_stream *stream)
+{
+	/*Program the last partial page*/
+	if((stream->status == DEV_OK) && (stream->fill != 0))
+	{
+		while((stream->submitted - stream->completed) >= FLASH_STREAM_NUM_PAGES){}
+
+		flash_stream_flush(stream);
+	}
+
+	/*Wait for the engine, it locks the flash once it runs out of work*/
+	flash_async_flush();
+
+	return stream->status;
+}
+
+
+uint32_t flash_stream_bytes_written(const flash_stream *stream)
+{
+	return (stream->write_address - stream->start_address) + stream->fill;
+}
+
+
+static StatusTypeDef flash_stream_flush(flash_stream *stream)
+{
+	uint32_t sector = get_sector(stream->write_address);
+	uint8_t *page;
+
+	/*Make sure the page does not run past the end of the slot*/
+	if(((stream->write_address + stream->fill) > stream->end_address) || (sector == FLASH_SECTOR_INVALID))
+	{
+		stream->status = DEV_ERROR;
+		return stream->status;
+	}
+
+	page = stream->page[stream->submitted % FLASH_STREAM_NUM_PAGES];
+
+	if(!(stream->erased_sectors & (1UL << sector)))
+	{
+		/*A kept sector already holds the page, anything else would be programmed over old data*/
+		if(memcmp((const uint8_t *)stream->write_address, page, stream->fill) != 0)
+		{
+			stream->status = DEV_ERROR;
+			return stream->status;
+		}
+
+		stream->pages_skipped++;
+		stream->write_address += stream->fill;
+		stream->fill = 0;
+
+		return stream->status;
+	}
+
+	/*Hand the page to the flash engine and move on to the next buffer*/
+	while(flash_async_program(stream->write_address, page, stream->fill, FLASH_STREAM_PROGRAM_RANGE, flash_stream_programmed, stream) != 0){}
+
+	stream->submitted++;
+	stream->write_address += stream->fill;
+	stream->fill = 0;
+
+	return stream->status;
+}
+
+
+/*Mark every sector touching length bytes at offset into the slot as erased, queueing the erase if asked to*/
+static StatusTypeDef flash_stream_mark(flash_stream *stream, uint32_t offset, uint32_t length, uint8_t erase)
+{
+	uint32_t address = stream->start_address + offset;
+	uint32_t target  = address + length;
+	uint32_t sector;
+
+	if((target > stream->end_address) || (target < address))
+	{
+		target = stream->end_address;
+	}
+
+	while((address < target) && (stream->status == DEV_OK))
+	{
+		sector = get_sector(address);
+
+		if(sector == FLASH_SECTOR_INVALID)
+		{
+			stream->status = DEV_ERROR;
+			break;
+		}
+
+		if(!(stream->erased_sectors & (1UL << sector)))
+		{
+			stream->erased_sectors |= (1UL << sector);
+
+			if(erase)
+			{
+				while(flash_async_erase(sector, FLASH_STREAM_VOLTAGE_RANGE, flash_stream_erased, stream) != 0){}
+			}
+		}
+
+		/*Move on to the start of the next sector*/
+		address = get_sector_address(sector) + get_sector_size(sector);
+	}
+
+	return stream->status;
+}
+
+
+RAM_FUNC static void flash_stream_erased(void *ctx, StatusTypeDef status, uint32_t error)
+{
+	flash_stream *stream = (flash_stream *)ctx;
+
+	if(status != DEV_OK)
+	{
+		stream->status = status;
+	}
+}
+
+
+RAM_FUNC static void flash_stream_programmed(void *ctx, StatusTypeDef status, uint32_t error)
+{
+	flash_stream *stream = (flash_stream *)ctx;
+
+	if(status != DEV_OK)
+	{
+		stream->status = status;
+	}
+
+	stream->completed++;
+}
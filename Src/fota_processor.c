@@ -6,14 +6,109 @@
  */
 
 
+#include <string.h>
 #include "fota_processor.h"
-#define IPD_MARKER "\r\n+IPD,"
-#define CLOSED_MARKER "\r\nCLOSED\r\n"
-#define COLON_MARKER ":"
+#include "flash_stream.h"
+#include "ipd_deframer.h"
+#include "boot_control.h"
+#include "image_header.h"
+#include "crc32.h"
+#include "sha256.h"
+#include "lzss.h"
+#include "delta_patch.h"
+#include "chunk_index.h"
+#include "nvm_store.h"
+#include "http_client.h"
+#include "semver.h"
 
-char firmware_buffer[MAX_FIRMWARE_SIZE] = {0};
+/*Where the response body goes*/
+typedef enum
+{
+	FIRMWARE_ROUTE_BODY = 0,	/*Whole image, possibly compressed or a patch*/
+	FIRMWARE_ROUTE_RANGE,		/*Part of the plain image answering a range request*/
+	FIRMWARE_ROUTE_MANIFEST,	/*Chunk manifest*/
+	FIRMWARE_ROUTE_HEADER		/*Image header only, nothing is written*/
+
+}firmwareRoute;
+
+typedef struct
+{
+	firmwareRoute route;
+	uint32_t range_left;		/*Bytes still expected from a range request*/
+	uint8_t overrun;			/*The server sent more than the range asked for*/
+	http_response response;		/*Framing of the response the body comes from*/
+	uint8_t magic[4];			/*First word of the body, tells a compressed stream from the rest*/
+	uint8_t magic_fill;
+	uint8_t compressed;			/*Body is an LZSS stream*/
+	uint8_t stream_magic[4];	/*First word after decompression, tells a patch from a plain image*/
+	uint8_t stream_magic_fill;
+	uint8_t patched;			/*Image is rebuilt from a delta patch against the active slot*/
+	uint32_t wire_bytes;		/*Bytes of the response body as sent*/
+	uint32_t decode_cycles;		/*Cycles spent in the decompressor, the image sink included*/
+	uint32_t sink_cycles;		/*Cycles spent behind the decompressor while decompressing*/
+	uint32_t body_bytes;		/*Bytes of the image received, after decompression*/
+	image_header header;		/*Copy of the image header, the slot may not hold it yet when the download ends*/
+	crc32_stream crc;			/*CRC of the payload behind the image header*/
+	sha256_context sha;			/*SHA-256 of the payload, matched against the signed header*/
+	uint32_t hash_cycles;		/*Cycles spent hashing, to see what authentication adds to the download*/
+
+}firmware_receiver;
+
+/*Destination of the version file*/
+typedef struct
+{
+	char *text;
+	uint32_t size;
+	uint32_t length;
+
+}firmware_version;
+
+/*Last release seen on the server, kept in the NVM store under NVM_KEY_RELEASE*/
+typedef struct
+{
+	semver version;
+	char etag[HTTP_ETAG_SZ];		/*ETag of the version file that announced it, empty if the server sent none*/
+
+}firmware_release;
+
+/*Progress of a ranged download, kept in the NVM store under NVM_KEY_DOWNLOAD_JOURNAL*/
+typedef struct
+{
+	uint32_t slot;
+	uint32_t image_size;
+	uint32_t offset;				/*Bytes of the image programmed to the slot*/
+	uint8_t sha256[32];				/*Payload hash of the image header, tells whether the server still has the same image*/
+
+}firmware_journal;
+
+static flash_stream fw_stream;
+static uint8_t fw_prepared;
+static uint8_t fw_slot;
 
-char temp_rx_buffer[TEMP_RX_BUFF_SZ] = {0};
+/*Window of the decompressor and the patcher, too big for the stack*/
+static lzss_decoder fw_decoder;
+static delta_patcher fw_patcher;
+
+/*First request of the update, it goes out together with the version check*/
+static firmware_receiver fw_probe;
+static uint8_t fw_probe_queued;
+
+/*Release the server offers, recorded once it is installed*/
+static firmware_release fw_release;
+
+#ifdef FIRMWARE_CHUNKED
+/*Chunks of the active slot and the plan of the new image*/
+static chunk_index fw_chunks;
+static chunk_manifest fw_manifest;
+#endif
+
+#ifdef FIRMWARE_DIFFERENTIAL
+/*Sectors of the slot decided from the manifest so far*/
+static uint8_t fw_planning;			/*The update goes ahead, sectors may be erased*/
+static uint32_t fw_planned;			/*Bytes of the image whose sectors are decided*/
+static uint32_t fw_plan_chunk;		/*First chunk touching the next sector*/
+static uint32_t fw_plan_offset;		/*Offset of that chunk*/
+#endif
 
 
 #define EMPTY_MEM		0xFFFFFFFF
@@ -41,6 +136,9 @@ void jump_to_app(uint32_t address)
 		/*Convert to function pointer*/
 		jump_to_app =  (func_ptr)app_start_address;
 
+		/*Hand the vector table over to the application*/
+		SCB->VTOR = address;
+
 		/*Initial the MSP*/
 		__set_MSP(*(uint32_t *)address);
 
@@ -56,120 +154,1160 @@ void jump_to_app(uint32_t address)
 }
 
 /**
- * @brief Calculates the length of a null-terminated string.
+ * @brief Keeps a copy of the image header and feeds the payload behind it to the CRC unit and the hash.
+ *
+ * @param rx Pointer to the receiver state.
+ * @param data Pointer to the body bytes.
+ * @param length Number of body bytes.
+ */
+static void firmware_check(firmware_receiver *rx, const uint8_t *data, uint32_t length)
+{
+	uint8_t *header = (uint8_t *)&rx->header;
+	uint32_t skip;
+	uint32_t start;
+
+	while((length != 0) && (rx->body_bytes < sizeof(image_header)))
+	{
+		header[rx->body_bytes++] = *data++;
+		length--;
+	}
+
+	/*Header padding is not covered by the CRC*/
+	skip = (rx->body_bytes < IMAGE_HEADER_SZ) ? (IMAGE_HEADER_SZ - rx->body_bytes) : 0;
+	skip = (skip < length) ? skip : length;
+
+	rx->body_bytes += length;
+	crc32_stream_update(&rx->crc, data + skip, length - skip);
+
+	start = DWT->CYCCNT;
+	sha256_update(&rx->sha, data + skip, length - skip);
+	rx->hash_cycles += DWT->CYCCNT - start;
+}
+
+/**
+ * @brief Collects the first word of a stream.
+ *
+ * @param magic Buffer of the word.
+ * @param fill Number of bytes collected.
+ * @param data Pointer to the stream bytes, advanced past the bytes taken.
+ * @param length Number of stream bytes, reduced by the bytes taken.
+ * @return 1 once the word is complete with this call, 0 otherwise.
+ */
+static uint8_t firmware_probe(uint8_t *magic, uint8_t *fill, const uint8_t **data, uint32_t *length)
+{
+	while((*length != 0) && (*fill < 4))
+	{
+		magic[(*fill)++] = *(*data)++;
+		(*length)--;
+
+		if(*fill == 4)
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+static uint32_t firmware_magic(const uint8_t *magic)
+{
+	return magic[0] | (magic[1] << 8) | (magic[2] << 16) | ((uint32_t)magic[3] << 24);
+}
+
+/**
+ * @brief Takes the image bytes, straight from the stream or out of the patcher, to the flash writer and checks.
+ *
+ * @param ctx Pointer to the receiver state.
+ * @param data Pointer to the image bytes.
+ * @param length Number of image bytes.
+ */
+static void firmware_image(void *ctx, const uint8_t *data, uint32_t length)
+{
+	flash_stream_write(&fw_stream, data, length);
+	firmware_check(ctx, data, length);
+}
+
+/**
+ * @brief Prepares the patcher with the image of the active slot as the base.
+ *
+ * @param rx Pointer to the receiver state.
+ */
+static void firmware_patch_start(firmware_receiver *rx)
+{
+	uint8_t active = boot_control_get()->active;
+	const image_header *base = image_get_header(boot_slot_address(active));
+	uint32_t base_size = 0;
+
+	/*Without a valid base every COPY and ADD fails*/
+	if(image_header_check(boot_slot_address(active), boot_slot_size(active)) == DEV_OK)
+	{
+		base_size = IMAGE_HEADER_SZ + base->image_size;
+	}
+
+	delta_init(&fw_patcher, (const uint8_t *)base, base_size, base->sha256, firmware_image, rx);
+}
+
+/**
+ * @brief Receives the stream after decompression. A stream starting with DELTA_MAGIC is a patch against the active
+ * slot, anything else is taken as the image itself.
+ *
+ * @param ctx Pointer to the receiver state.
+ * @param data Pointer to the stream bytes.
+ * @param length Number of stream bytes.
+ */
+static void firmware_stream(void *ctx, const uint8_t *data, uint32_t length)
+{
+	firmware_receiver *rx = ctx;
+	uint32_t start = DWT->CYCCNT;
+
+	if(firmware_probe(rx->stream_magic, &rx->stream_magic_fill, &data, &length))
+	{
+		rx->patched = (firmware_magic(rx->stream_magic) == DELTA_MAGIC);
+
+		if(rx->patched)
+		{
+			firmware_patch_start(rx);
+		}
+		else
+		{
+			firmware_image(rx, rx->stream_magic, sizeof(rx->stream_magic));
+		}
+	}
+
+	if(length != 0)
+	{
+		if(rx->patched)
+		{
+			delta_feed(&fw_patcher, data, length);
+		}
+		else
+		{
+			firmware_image(rx, data, length);
+		}
+	}
+
+	rx->sink_cycles += DWT->CYCCNT - start;
+}
+
+/**
+ * @brief Receives the response body. A body starting with LZSS_MAGIC is decompressed on the fly.
+ *
+ * @param rx Pointer to the receiver state.
+ * @param data Pointer to the body bytes.
+ * @param length Number of body bytes.
+ */
+static void firmware_body(firmware_receiver *rx, const uint8_t *data, uint32_t length)
+{
+	uint32_t start;
+
+	rx->wire_bytes += length;
+
+	if(firmware_probe(rx->magic, &rx->magic_fill, &data, &length))
+	{
+		rx->compressed = (firmware_magic(rx->magic) == LZSS_MAGIC);
+
+		if(rx->compressed)
+		{
+			lzss_init(&fw_decoder, firmware_stream, rx);
+		}
+		else
+		{
+			firmware_stream(rx, rx->magic, sizeof(rx->magic));
+		}
+	}
+
+	if(length == 0)
+	{
+		return;
+	}
+
+	if(rx->compressed)
+	{
+		start = DWT->CYCCNT;
+		lzss_feed(&fw_decoder, data, length);
+		rx->decode_cycles += DWT->CYCCNT - start;
+	}
+	else
+	{
+		firmware_stream(rx, data, length);
+	}
+}
+
+#ifdef FIRMWARE_DIFFERENTIAL
+/**
+ * @brief Decides the sectors of the slot the manifest covers so far. A sector is kept when every chunk touching it is
+ * in place, any other sector the image needs is erased before a byte is written to it. The erase is only queued, it
+ * runs while the rest of the manifest comes in and the manifest fits in the RX buffer.
  *
- * @param str Pointer to the null-terminated string.
- * @return The length of the string (number of characters before the null terminator).
+ * @param last 1 once the manifest is complete, the sector holding the end of the image is decided as well.
  */
-int string_length(const char *str) {
-    int length = 0;
+static void firmware_plan_sectors(uint8_t last)
+{
+	const chunk_plan *plan = fw_manifest.plan;
+	uint32_t known = (fw_manifest.parsed != 0) ? (fw_manifest.parsed - 1) : 0;
+	uint32_t slot = boot_slot_address(fw_slot);
+	uint32_t sector;
+	uint32_t end;
+	uint8_t keep;
+
+	while((fw_planned < fw_manifest.total) && ((slot + fw_planned) < fw_stream.end_address) &&
+		  (fw_manifest.status == DEV_OK))
+	{
+		sector = get_sector(slot + fw_planned);
+
+		if(sector == FLASH_SECTOR_INVALID)
+		{
+			return;
+		}
+
+		end = get_sector_address(sector) + get_sector_size(sector) - slot;
+
+		/*Chunks beyond the manifest read so far may still touch the sector*/
+		if(!last && (end > fw_manifest.total))
+		{
+			return;
+		}
+
+		keep = 1;
+
+		while((fw_plan_chunk < known) && (fw_plan_offset < end))
+		{
+			keep &= plan[fw_plan_chunk].in_place;
+
+			/*A chunk running into the next sector counts for that one as well*/
+			if((fw_plan_offset + plan[fw_plan_chunk].length) > end)
+			{
+				break;
+			}
 
-    // Iterate through the string until the null terminator is found
-    while (str[length] != '\0') {
-        length++;
-    }
+			fw_plan_offset += plan[fw_plan_chunk].length;
+			fw_plan_chunk++;
+		}
 
-    return length;
+		if(!keep)
+		{
+			flash_stream_erase(&fw_stream, fw_planned, end - fw_planned);
+		}
+
+		fw_planned = end;
+	}
 }
+#endif
+
 /**
- * @brief Finds the first occurrence of a substring within a given string.
+ * @brief Receives the body of an HTTP response and routes it.
  *
- * @param str Pointer to the string in which to search for the substring.
- * @param substr Pointer to the substring to search for.
- * @param str_size The size of the main string.
- * @return Pointer to the first occurrence of the substring within the main string,
- *         or NULL if the substring is not found.
+ * @param ctx Pointer to the receiver state.
+ * @param data Pointer to the body bytes.
+ * @param length Number of body bytes.
  */
-char* find_substring(const char *str, const char *substr, int str_size) {
-    int str_len = string_length(substr);
-    char *found_ptr = NULL;
+static void firmware_payload(void *ctx, const uint8_t *data, uint32_t length)
+{
+	firmware_receiver *rx = ctx;
+
+	if(rx->route == FIRMWARE_ROUTE_BODY)
+	{
+		firmware_body(rx, data, length);
+	}
+	else if(rx->route == FIRMWARE_ROUTE_RANGE)
+	{
+		/*A server ignoring the range sends the whole file, keep only what was asked for*/
+		if(length > rx->range_left)
+		{
+			rx->overrun = 1;
+			length = rx->range_left;
+			http_client_abort(&rx->response);
+		}
+
+		rx->range_left -= length;
+		firmware_image(rx, data, length);
+	}
+	else if(rx->route == FIRMWARE_ROUTE_HEADER)
+	{
+		if(length > rx->range_left)
+		{
+			rx->overrun = 1;
+			length = rx->range_left;
+			http_client_abort(&rx->response);
+		}
+
+		rx->range_left -= length;
+		memcpy((uint8_t *)&rx->header + rx->body_bytes, data, length);
+		rx->body_bytes += length;
+	}
+#ifdef FIRMWARE_CHUNKED
+	else
+	{
+		chunk_manifest_feed(&fw_manifest, data, length);
 
-    // Iterate through the main string up to the point where the substring could fully fit
-    for (int i = 0; i <= (str_size - str_len); i++) {
-        int j = 0;
+#ifdef FIRMWARE_DIFFERENTIAL
+		if(fw_planning)
+		{
+			firmware_plan_sectors(0);
+		}
+#endif
+	}
+#endif
+}
+
+
+void firmware_update_prepare(void)
+{
+	if(fw_prepared)
+	{
+		return;
+	}
+
+	flash_stats_reset();
+
+	/*Nothing is written yet, the slot is invalidated once the update is certain to go ahead*/
+	fw_slot = boot_inactive_slot();
+
+	/*Sectors are erased once the version check decided the update goes ahead, see firmware_update()*/
+	flash_stream_open(&fw_stream, boot_slot_address(fw_slot), boot_slot_size(fw_slot));
+
+	fw_prepared = 1;
+}
+
+/**
+ * @brief Erases the sectors of the slot the image needs and waits for the erase. The CPU stalls while a sector is
+ * erased and the RX buffer can not hold an image response meanwhile, so this runs before the image is requested.
+ *
+ * @param length Bytes of the image, the slot size if it is not known.
+ * @return DEV_OK if the sectors are erased.
+ */
+static StatusTypeDef firmware_erase(uint32_t length)
+{
+	flash_stream_erase(&fw_stream, 0, length);
+	flash_async_flush();
 
-        // Check if the substring matches at this position
-        while (j < str_len && str[i + j] == substr[j]) {
-            j++;
-        }
+	return fw_stream.status;
+}
 
-        // If we matched the entire substring, return the pointer to the start of the match
-        if (j == str_len) {
-            found_ptr = (char *)&str[i];
-            break;
-        }
-    }
+/**
+ * @brief Starts the slot over when an interrupted download is not resumed. What it left in the slot belongs to
+ * another image, so the stream is reopened and the sectors the new image needs are erased before any of it is
+ * requested.
+ *
+ * @param length Bytes of the new image, the slot size if it is not known.
+ * @return DEV_OK if the sectors are erased.
+ */
+static StatusTypeDef firmware_restart_slot(uint32_t length)
+{
+	flash_stream_open(&fw_stream, boot_slot_address(fw_slot), boot_slot_size(fw_slot));
+	firmware_update_discard();
 
-    return found_ptr;
+	return firmware_erase(length);
 }
 
+
 /**
- * @brief Parses the firmware data from the source buffer, extracting the valid portions and storing them in the destination buffer.
+ * @brief Matches the payload hash with the image header and checks the signature over the header.
  *
- * @param dst Pointer to the destination buffer where parsed data will be stored.
- * @param src Pointer to the source buffer containing the raw firmware data.
- * @param size The size of the source buffer in bytes.
+ * @param rx Pointer to the receiver state after the download.
+ * @return DEV_OK if the image is authentic.
  */
-void firmware_parse(char *dst, const char *src, int size) {
-    uint16_t dst_index = 0;            // Index for tracking the position in the destination buffer
-    const char *current_pos = src;     // Pointer to the current position in the source buffer
-    int remaining_size = size;         // Tracks the remaining bytes to process in the source buffer
+static StatusTypeDef firmware_authenticate(firmware_receiver *rx)
+{
+	uint8_t digest[SHA256_DIGEST_SZ];
+	StatusTypeDef status = DEV_OK;
+	uint32_t start;
+#ifdef DEBUG_OUTPUT
+	char msg[64];
+#endif
+
+	start = DWT->CYCCNT;
+	sha256_final(&rx->sha, digest);
+	rx->hash_cycles += DWT->CYCCNT - start;
+
+	if(memcmp(digest, rx->header.sha256, SHA256_DIGEST_SZ) != 0)
+	{
+		status = DEV_ERROR;
+	}
+
+#ifdef IMAGE_SIGNED
+	start = DWT->CYCCNT;
+
+	if((status == DEV_OK) && (image_verify_signature(&rx->header) != DEV_OK))
+	{
+		status = DEV_ERROR;
+	}
+
+	start = DWT->CYCCNT - start;
+#endif
+
+#ifdef DEBUG_OUTPUT
+	/*Cost of authentication, the hash is spread over the download*/
+#ifdef IMAGE_SIGNED
+	sprintf(msg,"Auth: SHA-256 %lu cycles, ECDSA %lu cycles\r\n",(unsigned long)rx->hash_cycles,(unsigned long)start);
+#else
+	sprintf(msg,"Auth: SHA-256 %lu cycles\r\n",(unsigned long)rx->hash_cycles);
+#endif
+	buffer_send_string(msg,debug_port);
+
+	if(status != DEV_OK)
+	{
+		buffer_send_string("STAGE: Image signature or hash invalid....\r\n",debug_port);
+	}
+#endif
 
-    // Iterate over the source buffer, extracting valid firmware data
-    while (find_substring(current_pos, IPD_MARKER, remaining_size)) {
-        // Calculate the number of valid bytes before the IPD_MARKER
-        uint16_t valid_data_length = find_substring(current_pos, IPD_MARKER, remaining_size) - current_pos;
+	return status;
+}
 
-        // Copy the valid data to the destination buffer
-        for (int i = 0; i < valid_data_length; i++) {
-            dst[dst_index] = current_pos[i];
-            dst_index++;
-        }
+/**
+ * @brief Routes the body of the response the receiver waits for until it is complete.
+ *
+ * @param rx Pointer to the receiver state, the image checks carry on across responses.
+ * @return DEV_OK once the whole body of a 2xx response arrived, DEV_TIMEOUT if the link went silent first.
+ */
+static StatusTypeDef firmware_receive(firmware_receiver *rx)
+{
+	StatusTypeDef status;
+#ifdef DEBUG_OUTPUT
+	char msg[48];
+#endif
 
-        // Move the current position past the valid data and the IPD_MARKER
-        current_pos += (valid_data_length + sizeof(IPD_MARKER) - 1);
-        remaining_size -= (valid_data_length + sizeof(IPD_MARKER) - 1);
+	status = http_client_wait(&rx->response, FIRMWARE_RX_TIMEOUT_MS);
 
-        // Find the position of the next COLON_MARKER and adjust the remaining size
-        const char* next_colon_pos = find_substring(current_pos, COLON_MARKER, remaining_size);
-        remaining_size -= (int)(next_colon_pos + 1 - current_pos);
-        current_pos = (next_colon_pos + 1);  // Move to the position after the colon
-    }
+#ifdef DEBUG_OUTPUT
+	if(status == DEV_TIMEOUT)
+	{
+		buffer_send_string("STAGE: Connection went silent....\r\n",debug_port);
+	}
+	else if((rx->response.parser.status != 0) && !http_parser_success(&rx->response.parser))
+	{
+		/*The error page was not written anywhere*/
+		sprintf(msg,"STAGE: Server answered %lu....\r\n",(unsigned long)rx->response.parser.status);
+		buffer_send_string(msg,debug_port);
+	}
+#endif
 
-    // Extract any remaining valid data before the CLOSED_MARKER
-    uint16_t valid_data_length = find_substring(current_pos, CLOSED_MARKER, remaining_size) - current_pos;
+	return status;
+}
 
-    // Copy the remaining valid data to the destination buffer
-    for (int i = 0; i < valid_data_length; i++) {
-        dst[dst_index] = current_pos[i];
-        dst_index++;
-    }
+/**
+ * @brief Starts the image checks of a receiver.
+ *
+ * @param rx Pointer to the receiver state.
+ */
+static void firmware_receiver_init(firmware_receiver *rx)
+{
+	memset(rx, 0, sizeof(*rx));
+	crc32_stream_start(&rx->crc);
+	sha256_init(&rx->sha);
 }
 
+/**
+ * @brief Flushes the image to flash and checks it once every byte went through the receiver.
+ *
+ * @param rx Pointer to the receiver state.
+ * @return DEV_OK if the image matches the size and CRC of its header and is authentic.
+ */
+static StatusTypeDef firmware_finish(firmware_receiver *rx)
+{
+#ifdef DEBUG_OUTPUT
+	char msg[64];
+#endif
+
+	/*Write the last partial page to microcontroller's flash memory*/
+	flash_stream_close(&fw_stream);
+
+#ifdef DEBUG_OUTPUT
+	if(rx->compressed && (rx->decode_cycles > rx->sink_cycles))
+	{
+		/*Compression ratio and decode speed without the flash writer and checks*/
+		snprintf(msg,sizeof(msg),"LZSS: %lu -> %lu bytes, decode %lu KB/s\r\n",(unsigned long)rx->wire_bytes,
+				(unsigned long)rx->body_bytes,(unsigned long)(((uint64_t)rx->body_bytes * (FLASH_STATS_CPU_HZ / 1024U)) /
+				(rx->decode_cycles - rx->sink_cycles)));
+		buffer_send_string(msg,debug_port);
+	}
+
+	if(rx->patched)
+	{
+		/*Transfer size against the image it built*/
+		snprintf(msg,sizeof(msg),"Delta: %lu -> %lu bytes, %lu from the slot\r\n",(unsigned long)rx->wire_bytes,
+				(unsigned long)rx->body_bytes,(unsigned long)fw_patcher.copied);
+		buffer_send_string(msg,debug_port);
+	}
+#endif
+
+	if(rx->patched && (delta_finish(&fw_patcher) != DEV_OK))
+	{
+#ifdef DEBUG_OUTPUT
+		buffer_send_string("STAGE: Patch does not fit the installed image....\r\n",debug_port);
+#endif
+		return DEV_ERROR;
+	}
+
+	if((rx->body_bytes < IMAGE_HEADER_SZ) || (rx->crc.bytes != rx->header.image_size) ||
+	   (rx->header.image_size > BOOT_IMAGE_MAX_SIZE) || (crc32_stream_value(&rx->crc) != rx->header.crc))
+	{
+#ifdef DEBUG_OUTPUT
+		buffer_send_string("STAGE: Download does not match the image CRC....\r\n",debug_port);
+#endif
+		return DEV_ERROR;
+	}
+
+	return firmware_authenticate(rx);
+}
 
-void firmware_update(void)
+/**
+ * @brief Requests the firmware file and streams the response body into the open flash stream.
+ *
+ * @return DEV_OK if the image received is complete and authentic.
+ */
+static StatusTypeDef firmware_download(void)
 {
+	firmware_receiver rx;
 
 #ifdef DEBUG_OUTPUT
 		buffer_send_string("STAGE: Getting the firmware....\r\n",debug_port);
 
 #endif
 
-	/*Copy firmware from rx_buffer and put into temp_rx_buffer*/
-	 esp82xx_get_firmware(temp_rx_buffer,FIRMWARE);
+	firmware_receiver_init(&rx);
+
+	/*The size of a compressed file or a patch is not known up front. It does not resume an interrupted download*/
+	if(firmware_update_pending() ? (firmware_restart_slot(boot_slot_size(fw_slot)) != DEV_OK) :
+								   (firmware_erase(boot_slot_size(fw_slot)) != DEV_OK))
+	{
+		return DEV_ERROR;
+	}
+
+	/*Send the HTTP GET request, the response stays in rx_buffer1*/
+	http_client_queue(&rx.response, boot_slot_file(fw_slot), firmware_payload, &rx);
+	http_client_send();
+
+	if(firmware_receive(&rx) != DEV_OK)
+	{
+		flash_stream_close(&fw_stream);
+		return DEV_TIMEOUT;
+	}
+
+	return firmware_finish(&rx);
+}
+
+#ifdef FIRMWARE_CHUNKED
+/**
+ * @brief Chunks the image in the active slot and queues the request for the manifest of the new image.
+ *
+ * @param rx Pointer to the receiver of the manifest.
+ */
+static void firmware_manifest_queue(firmware_receiver *rx)
+{
+	uint8_t active = boot_control_get()->active;
+	const image_header *base = image_get_header(boot_slot_address(active));
+	const uint8_t *target = 0;
+
+	/*Without a valid base every chunk is fetched*/
+	fw_chunks.count = 0;
+	fw_chunks.chunk[0].offset = 0;
+
+	if(image_header_check(boot_slot_address(active), boot_slot_size(active)) == DEV_OK)
+	{
+		chunk_index_build(&fw_chunks, (const uint8_t *)base, IMAGE_HEADER_SZ + base->image_size);
+	}
+
+#ifdef FIRMWARE_DIFFERENTIAL
+	/*The slot written to may hold chunks in place already, e.g. from the release before the active one*/
+	target = (const uint8_t *)boot_slot_address(fw_slot);
+	fw_planned     = 0;
+	fw_plan_chunk  = 0;
+	fw_plan_offset = 0;
+#endif
+
+	chunk_manifest_init(&fw_manifest, &fw_chunks, target, boot_slot_size(fw_slot));
+
+	memset(rx, 0, sizeof(*rx));
+	rx->route = FIRMWARE_ROUTE_MANIFEST;
+	http_client_queue(&rx->response, boot_slot_manifest(fw_slot), firmware_payload, rx);
+}
+
+/**
+ * @brief Fetches the manifest of the new image, unless it is on its way already.
+ *
+ * @return DEV_OK if the server has a valid manifest, the plan is then in fw_manifest.
+ */
+static StatusTypeDef firmware_fetch_manifest(void)
+{
+	if(!fw_probe_queued || (fw_probe.route != FIRMWARE_ROUTE_MANIFEST) ||
+	   (fw_probe.response.result == HTTP_FAILED))
+	{
+		firmware_manifest_queue(&fw_probe);
+		http_client_send();
+	}
+
+	fw_probe_queued = 0;
+
+	if(firmware_receive(&fw_probe) != DEV_OK)
+	{
+		return DEV_ERROR;
+	}
+
+	return chunk_manifest_finish(&fw_manifest);
+}
+
+/**
+ * @brief Tells whether a chunk of the new image has to come from the server.
+ *
+ * @param plan Pointer to the plan of the chunk.
+ * @param offset Offset of the chunk in the image.
+ * @return 0 if a kept sector of the slot or the active slot holds the chunk.
+ */
+static uint8_t firmware_chunk_missing(const chunk_plan *plan, uint32_t offset)
+{
+	return (plan->local == CHUNK_MISSING) && !flash_stream_is_kept(&fw_stream, offset, plan->length);
+}
+
+/**
+ * @brief Assembles the new image in chunk order: chunks in kept sectors of the slot stay where they are, chunks the
+ * active slot holds are copied from flash, runs of missing chunks are fetched with one range request each.
+ *
+ * @return DEV_OK if the image assembled is complete and authentic.
+ */
+static StatusTypeDef firmware_download_chunked(void)
+{
+	firmware_receiver rx;
+	const chunk_plan *plan = fw_manifest.plan;
+	const uint8_t *slot = (const uint8_t *)boot_slot_address(fw_slot);
+	uint32_t offset = 0;
+	uint32_t length;
+	uint32_t i = 0;
 #ifdef DEBUG_OUTPUT
-		buffer_send_string("STAGE: Parsing the firmware....\r\n",debug_port);
+	uint32_t fetch = 0;
+	char msg[64];
+#endif
+
+	firmware_receiver_init(&rx);
+	rx.route = FIRMWARE_ROUTE_RANGE;
+
+#ifdef FIRMWARE_DIFFERENTIAL
+	/*The sector holding the end of the image is decided once the manifest is complete, then only the wait for the
+	 *erases is left*/
+	firmware_plan_sectors(1);
+	length = 0;
+#else
+	length = fw_manifest.total;
+#endif
+
+	if(firmware_erase(length) != DEV_OK)
+	{
+		return DEV_ERROR;
+	}
+
+#ifdef DEBUG_OUTPUT
+	for(i = 0; i < fw_manifest.count; i++)
+	{
+		fetch += firmware_chunk_missing(&plan[i], offset) ? plan[i].length : 0;
+		offset += plan[i].length;
+	}
+
+	sprintf(msg,"STAGE: Fetching %lu of %lu bytes....\r\n",(unsigned long)fetch,(unsigned long)fw_manifest.total);
+	buffer_send_string(msg,debug_port);
+
+	offset = 0;
+	i = 0;
+#endif
+
+	while(i < fw_manifest.count)
+	{
+		if(flash_stream_is_kept(&fw_stream, offset, plan[i].length))
+		{
+			/*In place already, it still goes through the stream and the checks*/
+			firmware_image(&rx, slot + offset, plan[i].length);
+			offset += plan[i].length;
+			i++;
+			continue;
+		}
+
+		if(plan[i].local != CHUNK_MISSING)
+		{
+			firmware_image(&rx, fw_chunks.base + fw_chunks.chunk[plan[i].local].offset, plan[i].length);
+			offset += plan[i].length;
+			i++;
+			continue;
+		}
+
+		length = 0;
+
+		while((i < fw_manifest.count) && firmware_chunk_missing(&plan[i], offset + length))
+		{
+			length += plan[i].length;
+			i++;
+		}
+
+		rx.range_left = length;
+		http_client_queue_range(&rx.response, boot_slot_file(fw_slot), offset, offset + length - 1,
+				firmware_payload, &rx);
+		http_client_send();
+
+		if((firmware_receive(&rx) != DEV_OK) || (rx.range_left != 0) || rx.overrun)
+		{
+			flash_stream_close(&fw_stream);
+			return DEV_ERROR;
+		}
+
+		offset += length;
+	}
+
+	return firmware_finish(&rx);
+}
+#endif
+
+#ifdef FIRMWARE_RESUMABLE
+/**
+ * @brief Reads the journal of an interrupted ranged download into the inactive slot.
+ *
+ * @param journal Pointer to the journal to fill.
+ * @return 1 if there is a journal for the slot.
+ */
+static uint8_t firmware_journal_read(firmware_journal *journal)
+{
+	return (nvm_read(NVM_KEY_DOWNLOAD_JOURNAL, journal, sizeof(*journal)) == sizeof(*journal)) &&
+		   (journal->slot == boot_inactive_slot());
+}
+
+/**
+ * @brief Records how much of the image is programmed once the flash engine caught up with the stream.
+ *
+ * @param journal Pointer to the journal of the download.
+ * @param rx Pointer to the receiver state.
+ */
+static void firmware_journal_save(firmware_journal *journal, const firmware_receiver *rx)
+{
+	flash_async_flush();
+
+	if(fw_stream.status != DEV_OK)
+	{
+		nvm_delete(NVM_KEY_DOWNLOAD_JOURNAL);
+		return;
+	}
 
+	journal->offset = rx->body_bytes;
+	nvm_write(NVM_KEY_DOWNLOAD_JOURNAL, journal, sizeof(*journal));
+}
+
+/**
+ * @brief Queues a range request for the header of the image file.
+ *
+ * @param rx Pointer to the receiver of the header.
+ */
+static void firmware_header_queue(firmware_receiver *rx)
+{
+	memset(rx, 0, sizeof(*rx));
+	rx->route = FIRMWARE_ROUTE_HEADER;
+	rx->range_left = sizeof(image_header);
+	http_client_queue_range(&rx->response, boot_slot_file(fw_slot), 0, sizeof(image_header) - 1, firmware_payload, rx);
+}
+
+/**
+ * @brief Fetches the header of the image file, unless it is on its way already.
+ *
+ * @param header Pointer to the header to fill.
+ * @return DEV_OK if the file is a plain image that fits the slot and the server honours the range.
+ */
+static StatusTypeDef firmware_fetch_header(image_header *header)
+{
+	firmware_receiver *rx = &fw_probe;
+
+	if(!fw_probe_queued || (rx->route != FIRMWARE_ROUTE_HEADER) || (rx->response.result == HTTP_FAILED))
+	{
+		firmware_header_queue(rx);
+		http_client_send();
+	}
+
+	fw_probe_queued = 0;
+
+	/*Compressed files and patches are not resumable, they start with their own magic*/
+	if((firmware_receive(rx) != DEV_OK) || (rx->range_left != 0) || rx->overrun ||
+	   (rx->header.magic != IMAGE_MAGIC) || (rx->header.header_size != IMAGE_HEADER_SZ) ||
+	   (rx->header.image_size > BOOT_IMAGE_MAX_SIZE))
+	{
+		return DEV_ERROR;
+	}
+
+	*header = rx->header;
+
+	return DEV_OK;
+}
+
+/**
+ * @brief Downloads the image in FIRMWARE_RANGE_SZ ranges. A dropped link is retried from the last byte received,
+ * an interrupted download of the same image resumes from the journal after a reset.
+ *
+ * @param target Pointer to the header of the image on the server.
+ * @return DEV_OK if the image received is complete and authentic.
+ */
+static StatusTypeDef firmware_download_ranged(const image_header *target)
+{
+	firmware_receiver rx;
+	firmware_journal journal;
+	uint8_t pending;
+	uint32_t total = IMAGE_HEADER_SZ + target->image_size;
+	uint32_t first;
+	uint32_t last;
+	uint32_t retries = 0;
+	StatusTypeDef status;
+#ifdef DEBUG_OUTPUT
+	char msg[64];
 #endif
 
-	 /*Parse firmware data from content temp_rx_buffer*/
-	 firmware_parse(firmware_buffer, temp_rx_buffer, sizeof(firmware_buffer));
+	firmware_receiver_init(&rx);
+	rx.route = FIRMWARE_ROUTE_RANGE;
+
+	pending = firmware_journal_read(&journal);
+
+	/*The sectors of the image were erased before the journal was first written, the stream carries on behind the
+	 *last range programmed*/
+	if(pending && (journal.image_size == target->image_size) &&
+	   (memcmp(journal.sha256, target->sha256, sizeof(journal.sha256)) == 0) &&
+	   (flash_stream_resume(&fw_stream, journal.offset, total) == DEV_OK))
+	{
 #ifdef DEBUG_OUTPUT
-		buffer_send_string("STAGE: Writing the firmware to memory....\r\n",debug_port);
+		sprintf(msg,"STAGE: Resuming the download at %lu bytes....\r\n",(unsigned long)journal.offset);
+		buffer_send_string(msg,debug_port);
+#endif
+
+		/*The checks cover the bytes already in the slot*/
+		firmware_check(&rx, (const uint8_t *)boot_slot_address(fw_slot), journal.offset);
+	}
+	else
+	{
+		if((pending ? firmware_restart_slot(total) : firmware_erase(total)) != DEV_OK)
+		{
+			return DEV_ERROR;
+		}
+
+		journal.slot = fw_slot;
+		journal.image_size = target->image_size;
+		memcpy(journal.sha256, target->sha256, sizeof(journal.sha256));
+		firmware_journal_save(&journal, &rx);
+	}
+
+	while(rx.body_bytes < total)
+	{
+		/*Ranges end on FIRMWARE_RANGE_SZ boundaries, a retry asks for the rest of its range*/
+		first = rx.body_bytes;
+		last  = ((first / FIRMWARE_RANGE_SZ) + 1) * FIRMWARE_RANGE_SZ;
+		last  = ((last < total) ? last : total) - 1;
+
+		rx.range_left = last - first + 1;
+		http_client_queue_range(&rx.response, boot_slot_file(fw_slot), first, last, firmware_payload, &rx);
+		http_client_send();
+
+		status = firmware_receive(&rx);
+
+		if(rx.overrun)
+		{
+			flash_stream_close(&fw_stream);
+			return DEV_ERROR;
+		}
+
+		if((status != DEV_OK) || (rx.range_left != 0))
+		{
+			retries = (rx.body_bytes != first) ? 0 : (retries + 1);
+
+			if(retries >= FIRMWARE_RANGE_RETRIES)
+			{
+				/*The journal stays, the next update attempt resumes*/
+				flash_stream_close(&fw_stream);
+				return DEV_TIMEOUT;
+			}
+
+			continue;
+		}
 
+		retries = 0;
+		firmware_journal_save(&journal, &rx);
+	}
+
+	status = firmware_finish(&rx);
+
+	/*Done with this image either way, a bad one must not be resumed*/
+	nvm_delete(NVM_KEY_DOWNLOAD_JOURNAL);
+
+	return status;
+}
+#endif
+
+/**
+ * @brief Gets the new image into the open flash stream, from chunks when the server has a manifest.
+ *
+ * @return DEV_OK if the image is complete and authentic.
+ */
+static StatusTypeDef firmware_fetch(void)
+{
+#ifdef FIRMWARE_RESUMABLE
+	image_header target;
+#endif
+
+#ifdef FIRMWARE_CHUNKED
+	/*An interrupted ranged download is finished first*/
+	if(!firmware_update_pending() && (firmware_fetch_manifest() == DEV_OK))
+	{
+		return firmware_download_chunked();
+	}
 #endif
 
-	 /*Write firmware data to microcontroller's flash memory*/
-	 flash_write_data_byte(NEW_FIRMWARE_START_ADDRESS,(uint8_t *) firmware_buffer, sizeof(firmware_buffer));
+#ifdef FIRMWARE_RESUMABLE
+	if(firmware_fetch_header(&target) == DEV_OK)
+	{
+		return firmware_download_ranged(&target);
+	}
+#endif
+
+	return firmware_download();
+}
+
+
+/**
+ * @brief Copies the body of the version file, cut to the buffer.
+ *
+ * @param ctx Pointer to the version buffer.
+ * @param data Pointer to the body bytes.
+ * @param length Number of body bytes.
+ */
+static void firmware_version_body(void *ctx, const uint8_t *data, uint32_t length)
+{
+	firmware_version *version = ctx;
+	uint32_t space = version->size - 1 - version->length;
+
+	length = (length < space) ? length : space;
+	memcpy(&version->text[version->length], data, length);
+	version->length += length;
+}
+
+/**
+ * @brief Reads the version of the installed firmware from the header of the slot that boots next.
+ *
+ * @param version Pointer to the version, 0.0.0 if that slot holds no valid header.
+ */
+static void firmware_installed_version(semver *version)
+{
+	const boot_control *control = boot_control_get();
+	uint8_t slot = (control->trial != BOOT_SLOT_NONE) ? control->trial : control->active;
+	const image_header *header = image_get_header(boot_slot_address(slot));
+
+	if(image_header_check(boot_slot_address(slot), boot_slot_size(slot)) == DEV_OK)
+	{
+		semver_from_numbers(version, header->version_major, header->version_minor, header->version_patch);
+	}
+	else
+	{
+		semver_from_numbers(version, 0, 0, 0);
+	}
+}
+
+/**
+ * @brief Asks the server for the version file and compares the release with the installed firmware. The request
+ * carries the ETag of the last release seen, so an unchanged release is answered with a 304 and no body. Otherwise
+ * the first request of the update is pipelined behind it, so the image transfer does not wait for another round trip.
+ *
+ * @param text Buffer for the version string, line endings are cut off. Empty if the release is unchanged.
+ * @param size Size of the buffer.
+ * @return FIRMWARE_RELEASE_NEW if the server has a newer release or one whose version can not be read,
+ * FIRMWARE_RELEASE_CURRENT if it has nothing newer and FIRMWARE_RELEASE_FAILED if the version file did not arrive.
+ */
+firmwareRelease firmware_check_release(char *text, uint32_t size)
+{
+	http_response response;
+	firmware_version version = {text, size, 0};
+	firmware_release stored;
+	semver installed;
+	uint8_t conditional;
+	StatusTypeDef status;
+#ifdef DEBUG_OUTPUT
+	char msg[80];
+#endif
+
+	firmware_installed_version(&installed);
+
+	/*The stored ETag only stands for "nothing newer" while the release it announced is not newer than what is
+	 *installed, after a rollback the version file is fetched again*/
+	conditional = (nvm_read(NVM_KEY_RELEASE, &stored, sizeof(stored)) == sizeof(stored)) &&
+				  (stored.etag[0] != '\0') && (memchr(stored.etag, '\0', sizeof(stored.etag)) != 0) &&
+				  (semver_compare(&stored.version, &installed) <= 0);
+
+	http_client_queue_conditional(&response, FIRMWARE_VERSION_FILE, conditional ? stored.etag : 0,
+			firmware_version_body, &version);
+
+	fw_probe_queued = 0;
+
+	/*An unchanged release is expected, keep its cost to the 304*/
+	if(!conditional)
+	{
+#ifdef FIRMWARE_CHUNKED
+		if(!firmware_update_pending())
+		{
+			firmware_manifest_queue(&fw_probe);
+			fw_probe_queued = 1;
+		}
+#endif
+
+#ifdef FIRMWARE_RESUMABLE
+		if(!fw_probe_queued)
+		{
+			firmware_header_queue(&fw_probe);
+			fw_probe_queued = 1;
+		}
+#endif
+	}
+
+	http_client_send();
+	status = http_client_wait(&response, FIRMWARE_RX_TIMEOUT_MS);
+
+	while((version.length != 0) && ((text[version.length - 1] == '\r') || (text[version.length - 1] == '\n')))
+	{
+		version.length--;
+	}
+
+	text[version.length] = '\0';
+
+	if((response.result == HTTP_COMPLETE) && (response.parser.status == 304))
+	{
+#ifdef DEBUG_OUTPUT
+		buffer_send_string("STAGE: Release unchanged on the server....\r\n",debug_port);
+#endif
+		return FIRMWARE_RELEASE_CURRENT;
+	}
+
+	if(status != DEV_OK)
+	{
+		return FIRMWARE_RELEASE_FAILED;
+	}
+
+	memset(&fw_release, 0, sizeof(fw_release));
+	strcpy(fw_release.etag, response.parser.etag);
+
+#ifdef DEBUG_OUTPUT
+	sprintf(msg,"STAGE: Installed firmware is %lu.%lu.%lu....\r\n",(unsigned long)installed.major,
+			(unsigned long)installed.minor,(unsigned long)installed.patch);
+	buffer_send_string(msg,debug_port);
+#endif
+
+	if(semver_parse(text, &fw_release.version) != DEV_OK)
+	{
+#ifdef DEBUG_OUTPUT
+		buffer_send_string("STAGE: Version not understood, updating anyway....\r\n",debug_port);
+#endif
+		return FIRMWARE_RELEASE_NEW;
+	}
+
+	if(semver_compare(&fw_release.version, &installed) > 0)
+	{
+		return FIRMWARE_RELEASE_NEW;
+	}
+
+	/*Nothing newer, the next check costs a 304 until the server publishes something else*/
+	nvm_write(NVM_KEY_RELEASE, &fw_release, sizeof(fw_release));
+
+	return FIRMWARE_RELEASE_CURRENT;
+}
+
+/**
+ * @brief Records the release the last firmware_check_release() offered as installed, so checks after it are
+ * conditional on its ETag.
+ */
+void firmware_release_installed(void)
+{
+	nvm_write(NVM_KEY_RELEASE, &fw_release, sizeof(fw_release));
+}
+
+
+/*An interrupted download into the inactive slot is waiting to be resumed*/
+uint8_t firmware_update_pending(void)
+{
+#ifdef FIRMWARE_RESUMABLE
+	firmware_journal journal;
+
+	return firmware_journal_read(&journal);
+#else
+	return 0;
+#endif
+}
+
+
+/*Forgets an interrupted download, the next update starts over*/
+void firmware_update_discard(void)
+{
+#ifdef FIRMWARE_RESUMABLE
+	nvm_delete(NVM_KEY_DOWNLOAD_JOURNAL);
+#endif
+}
+
+
+StatusTypeDef firmware_update(void)
+{
+	StatusTypeDef status;
+#ifdef DEBUG_OUTPUT
+	char msg[64];
+#endif
+
+	/*Open the slot if the caller did not do it during bring-up*/
+	firmware_update_prepare();
+	fw_prepared = 0;
+
+	/*The inactive slot is overwritten, make sure a half written image never boots*/
+	boot_control_invalidate(fw_slot);
+
+	/*A resumed download carries on in the sectors it erased before*/
+	if(!firmware_update_pending())
+	{
+#ifdef FIRMWARE_DIFFERENTIAL
+		/*The manifest sent with the version check tells which sectors to keep, the others are erased while the rest
+		 *of it comes in*/
+		fw_planning = 1;
+		firmware_plan_sectors(0);
+#else
+#ifdef DEBUG_OUTPUT
+		buffer_send_string("STAGE: Erasing the firmware slot....\r\n",debug_port);
+
+#endif
+
+		/*Every image needs the first sector, its erase runs while the answer to the probe sent with the version check
+		 *comes in, that answer fits in the RX buffer. The rest is erased by firmware_erase() once the size is known*/
+		flash_stream_erase(&fw_stream, 0, FIRMWARE_ERASE_AHEAD_SIZE);
+#endif
+	}
+
+	if(fw_stream.status != DEV_OK)
+	{
+		flash_async_flush();
+		return DEV_ERROR;
+	}
+
+	status = firmware_fetch();
+
+#ifdef FIRMWARE_DIFFERENTIAL
+	fw_planning = 0;
+#endif
+
+	if(status != DEV_OK)
+	{
+		return DEV_ERROR;
+	}
+
+#ifdef DEBUG_OUTPUT
+	sprintf(msg,"STAGE: Wrote %lu bytes to memory....\r\n",(unsigned long)flash_stream_bytes_written(&fw_stream));
+	buffer_send_string(msg,debug_port);
+
+	/*Program operations and programming throughput, to compare the bulk and byte-wise paths*/
+	sprintf(msg,"Flash: %lu program ops, %lu bytes/s\r\n",(unsigned long)flash_get_stats()->operations,
+			(unsigned long)flash_stats_bytes_per_sec());
+	buffer_send_string(msg,debug_port);
+
+#ifdef FIRMWARE_DIFFERENTIAL
+	sprintf(msg,"Flash: %lu pages kept in place\r\n",(unsigned long)fw_stream.pages_skipped);
+	buffer_send_string(msg,debug_port);
+#endif
+
+#endif
+
+	/*Only an image whose header and payload CRC check out goes on trial, otherwise the active slot keeps booting*/
+	if((fw_stream.status != DEV_OK) || !boot_image_verify(fw_slot))
+	{
+		return DEV_ERROR;
+	}
 
+	return boot_control_set_trial(fw_slot);
 }
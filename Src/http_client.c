@@ -0,0 +1,320 @@
+/*
+ * File : http_client.c
+ * Author : Sriramkumar Jayaraman
+ * Description : This file implements an HTTP/1.1 client over the single TCP connection of the ESP82xx. The
+ * connection stays open between requests, requests queued together go out in one CIPSEND and their responses are
+ * taken apart in order by http_parser.c as they arrive: each one ends after Content-Length bytes or the last chunk,
+ * so no request waits for the server to close the connection. Body bytes are handed on as spans straight from the
+ * ESP buffer.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include "http_client.h"
+#include "esp82xx_lib.h"
+
+#define HTTP_GET_REQUEST		"GET " HTTP_PATH "%s HTTP/1.1\r\n" \
+								"Host: " HTTP_SERVER_ADDRESS "\r\n" \
+								"Connection: keep-alive\r\n\r\n"
+
+#define HTTP_GET_CONDITIONAL_REQUEST	"GET " HTTP_PATH "%s HTTP/1.1\r\n" \
+									"Host: " HTTP_SERVER_ADDRESS "\r\n" \
+									"If-None-Match: %s\r\n" \
+									"Connection: keep-alive\r\n\r\n"
+
+#define HTTP_GET_RANGE_REQUEST	"GET " HTTP_PATH "%s HTTP/1.1\r\n" \
+								"Host: " HTTP_SERVER_ADDRESS "\r\n" \
+								"Range: bytes=%lu-%lu\r\n" \
+								"Connection: keep-alive\r\n\r\n"
+
+typedef struct
+{
+	ipd_deframer deframer;
+	response_matcher text_matcher;			/*Watches the AT text between frames for CLOSED*/
+	http_response *queue[HTTP_MAX_PIPELINE];	/*Outstanding responses, oldest first*/
+	uint32_t count;
+	uint32_t unsent;						/*Responses of requests still in the request buffer*/
+	char request[HTTP_REQUEST_BUFF_SZ];
+	uint32_t request_len;
+	uint8_t connected;
+
+}http_client;
+
+static http_client client;
+
+static void http_fail_all(void);
+static void http_fail_sent(void);
+static void http_payload(void *ctx, const uint8_t *data, uint32_t length);
+static void http_text(void *ctx, const uint8_t *data, uint32_t length);
+static StatusTypeDef http_queue_request(http_response *response, int length, http_body_handler on_body, void *ctx);
+
+
+void http_client_init(void)
+{
+	memset(&client, 0, sizeof(client));
+}
+
+
+StatusTypeDef http_client_queue(http_response *response, const char *file, http_body_handler on_body, void *ctx)
+{
+	uint32_t space = sizeof(client.request) - client.request_len;
+
+	return http_queue_request(response, snprintf(&client.request[client.request_len], space, HTTP_GET_REQUEST,
+			file), on_body, ctx);
+}
+
+
+/*Request a file unless its ETag still matches, the server then answers 304 without a body*/
+StatusTypeDef http_client_queue_conditional(http_response *response, const char *file, const char *etag,
+		http_body_handler on_body, void *ctx)
+{
+	uint32_t space = sizeof(client.request) - client.request_len;
+
+	if((etag == 0) || (etag[0] == '\0'))
+	{
+		return http_client_queue(response, file, on_body, ctx);
+	}
+
+	return http_queue_request(response, snprintf(&client.request[client.request_len], space,
+			HTTP_GET_CONDITIONAL_REQUEST, file, etag), on_body, ctx);
+}
+
+
+/*Request bytes first to last (inclusive) of a file*/
+StatusTypeDef http_client_queue_range(http_response *response, const char *file, uint32_t first, uint32_t last,
+		http_body_handler on_body, void *ctx)
+{
+	uint32_t space = sizeof(client.request) - client.request_len;
+
+	return http_queue_request(response, snprintf(&client.request[client.request_len], space,
+			HTTP_GET_RANGE_REQUEST, file, (unsigned long)first, (unsigned long)last), on_body, ctx);
+}
+
+
+/*Send the queued requests in one go, opening the connection if there is none. Responses to requests sent before may
+ *still be arriving on an open connection, the AT engine hands them on while the send runs*/
+StatusTypeDef http_client_send(void)
+{
+	uint32_t attempt;
+
+	if(client.unsent == 0)
+	{
+		return DEV_OK;
+	}
+
+	for(attempt = 0; attempt < HTTP_SEND_ATTEMPTS; attempt++)
+	{
+		if(!client.connected)
+		{
+			/*Responses owed by a connection that is gone never arrive, they must not take the new ones*/
+			http_fail_sent();
+
+			if(esp82xx_connect(HTTP_SERVER_ADDRESS, HTTP_SERVER_PORT) != 1)
+			{
+				continue;
+			}
+
+			client.connected = 1;
+
+			/*Connecting dropped whatever was left in the ESP buffer, start on a frame boundary. From here on the
+			 *AT engine hands what arrives during a command to the deframer, responses in flight are kept*/
+			ipd_deframer_init(&client.deframer, http_payload, http_text, &client);
+			response_matcher_init(&client.text_matcher, esp82xx_replies());
+			at_engine_route(&client.deframer);
+		}
+
+		if(esp82xx_send(client.request) == 1)
+		{
+			client.request_len = 0;
+			client.unsent = 0;
+			return DEV_OK;
+		}
+
+		/*The server dropped the connection while it was idle, open a new one*/
+		esp82xx_close();
+		client.connected = 0;
+	}
+
+	http_fail_all();
+
+	return DEV_ERROR;
+}
+
+
+/*Take the responses apart as they arrive until the given one is complete or the link stays silent for timeout_ms*/
+StatusTypeDef http_client_wait(http_response *response, uint32_t timeout_ms)
+{
+	ring_span span;
+	uint32_t count;
+	uint32_t tickstart = get_tick();
+
+	while(response->result == HTTP_PENDING)
+	{
+		/*Received bytes were lost, the responses can not be taken apart any more*/
+		if(buffer_rx_overrun(esp82xx_port))
+		{
+			http_client_close();
+			return DEV_ERROR;
+		}
+
+		/*Parse the received data in place*/
+		count = buffer_peek_contiguous(esp82xx_port, &span);
+
+		ipd_deframer_feed(&client.deframer, span.data[0], span.length[0]);
+		ipd_deframer_feed(&client.deframer, span.data[1], span.length[1]);
+
+		buffer_consume(esp82xx_port, count);
+
+		if(count != 0)
+		{
+			tickstart = get_tick();
+		}
+		else if((get_tick() - tickstart) > timeout_ms)
+		{
+			/*Whatever arrives late is dropped with the connection*/
+			http_client_close();
+			return DEV_TIMEOUT;
+		}
+	}
+
+	if(response->result != HTTP_COMPLETE)
+	{
+		/*What is left of an aborted, cut or malformed response can not be told from the next one*/
+		http_client_close();
+		return DEV_ERROR;
+	}
+
+	/*Error pages were framed and dropped, the connection stays usable*/
+	return http_parser_success(&response->parser) ? DEV_OK : DEV_ERROR;
+}
+
+
+/*Stop waiting for a response whose body is not wanted, called from its body handler*/
+void http_client_abort(http_response *response)
+{
+	response->result = HTTP_FAILED;
+}
+
+
+/*Drop the connection, outstanding responses fail*/
+void http_client_close(void)
+{
+	esp82xx_close();
+	client.connected = 0;
+	http_fail_all();
+}
+
+
+static StatusTypeDef http_queue_request(http_response *response, int length, http_body_handler on_body, void *ctx)
+{
+	http_parser_init(&response->parser, on_body, ctx);
+	response->result = HTTP_PENDING;
+
+	/*snprintf reports the length it wanted, a cut request must not go out*/
+	if((length < 0) || ((client.request_len + length) >= sizeof(client.request)) ||
+	   (client.count == HTTP_MAX_PIPELINE))
+	{
+		client.request[client.request_len] = '\0';
+		response->result = HTTP_FAILED;
+		return DEV_ERROR;
+	}
+
+	client.request_len += length;
+	client.queue[client.count++] = response;
+	client.unsent++;
+
+	return DEV_OK;
+}
+
+
+static void http_fail_all(void)
+{
+	uint32_t i;
+
+	for(i = 0; i < client.count; i++)
+	{
+		client.queue[i]->result = HTTP_FAILED;
+	}
+
+	client.count = 0;
+	client.unsent = 0;
+	client.request_len = 0;
+}
+
+
+/*Fail the outstanding responses whose requests went out, the ones still in the request buffer stay queued*/
+static void http_fail_sent(void)
+{
+	uint32_t sent = client.count - client.unsent;
+	uint32_t i;
+
+	for(i = 0; i < sent; i++)
+	{
+		client.queue[i]->result = HTTP_FAILED;
+	}
+
+	client.count = client.unsent;
+	memmove(&client.queue[0], &client.queue[sent], client.count * sizeof(client.queue[0]));
+}
+
+
+/*Frame payload, split between the outstanding responses*/
+static void http_payload(void *ctx, const uint8_t *data, uint32_t length)
+{
+	http_response *response;
+	uint32_t used;
+
+	while((length != 0) && (client.count != 0))
+	{
+		response = client.queue[0];
+		used = http_parser_feed(&response->parser, data, length);
+		data += used;
+		length -= used;
+
+		if(http_parser_done(&response->parser))
+		{
+			/*An aborted response stays failed*/
+			if(response->result == HTTP_PENDING)
+			{
+				response->result = (response->parser.state == HTTP_DONE) ? HTTP_COMPLETE : HTTP_FAILED;
+			}
+
+			if(response->parser.close)
+			{
+				client.connected = 0;
+			}
+
+			client.count--;
+			memmove(&client.queue[0], &client.queue[1], client.count * sizeof(client.queue[0]));
+		}
+	}
+}
+
+
+static void http_text(void *ctx, const uint8_t *data, uint32_t length)
+{
+	response_match match;
+
+	/*A command may be waiting for its reply*/
+	at_engine_text(data, length);
+
+	response_matcher_feed(&client.text_matcher, data, length, ESP_REPLY_BIT(ESP_REPLY_CLOSED), &match);
+
+	if(match.patterns == 0)
+	{
+		return;
+	}
+
+	client.connected = 0;
+
+	/*A body without a length ends with the connection, any other is cut short*/
+	if((client.count != 0) && (client.queue[0]->result == HTTP_PENDING) &&
+	   (http_parser_close(&client.queue[0]->parser) == DEV_OK))
+	{
+		client.queue[0]->result = HTTP_COMPLETE;
+		client.count--;
+		memmove(&client.queue[0], &client.queue[1], client.count * sizeof(client.queue[0]));
+	}
+
+	http_fail_all();
+}
@@ -0,0 +1,368 @@
+/*
+ * File : http_parser.c
+ * Author : Sriramkumar Jayaraman
+ * Description : This file implements a streaming parser for HTTP/1.1 responses. Header lines are collected one at
+ * a time in a fixed buffer and parsed for the status code, Content-Length, Transfer-Encoding, Connection and ETag.
+ * The body is framed by its length, by chunked encoding or by the end of the connection and handed on as spans
+ * without being copied. Bodies of responses that are not 2xx are framed but dropped, so an error page never reaches
+ * the firmware writer. Nothing is allocated, the state lives in the caller's http_parser.
+ */
+
+#include <string.h>
+#include "http_parser.h"
+
+#define HTTP_MAX_LENGTH_DIGITS	9		/*Content-Length below 1GB*/
+#define HTTP_MAX_CHUNK_DIGITS	7		/*Chunks below 256MB*/
+
+static uint8_t http_name_is(const char *line, const char *name);
+static const char *http_value(const char *line);
+static uint8_t http_value_has(const char *value, const char *token);
+static void http_status_line(http_parser *parser, const char *line);
+static void http_header_line(http_parser *parser, const char *line);
+static void http_chunk_size(http_parser *parser, const char *line);
+static void http_end_headers(http_parser *parser);
+static void http_parse_line(http_parser *parser);
+
+
+void http_parser_init(http_parser *parser, http_body_handler on_body, void *ctx)
+{
+	memset(parser, 0, sizeof(*parser));
+	parser->content_length = HTTP_NO_LENGTH;
+	parser->on_body = on_body;
+	parser->ctx = ctx;
+}
+
+
+/*Parse the bytes of one response, returns how many belonged to it. The rest belongs to the next response*/
+uint32_t http_parser_feed(http_parser *parser, const uint8_t *data, uint32_t length)
+{
+	uint32_t index = 0;
+	uint32_t chunk;
+	uint8_t c;
+
+	while((index < length) && (parser->state != HTTP_DONE) && (parser->state != HTTP_MALFORMED))
+	{
+		if((parser->state == HTTP_BODY) || (parser->state == HTTP_CHUNK_DATA))
+		{
+			/*Hand on the body as one span*/
+			chunk = length - index;
+
+			if(chunk > parser->remaining)
+			{
+				chunk = parser->remaining;
+			}
+
+			if(http_parser_success(parser) && (parser->on_body != 0))
+			{
+				parser->on_body(parser->ctx, &data[index], chunk);
+			}
+
+			parser->body_bytes += chunk;
+			index += chunk;
+
+			if(parser->remaining != HTTP_NO_LENGTH)
+			{
+				parser->remaining -= chunk;
+			}
+
+			if(parser->remaining == 0)
+			{
+				parser->state = (parser->state == HTTP_BODY) ? HTTP_DONE : HTTP_CHUNK_END;
+			}
+			continue;
+		}
+
+		/*Everything else is lines*/
+		c = data[index++];
+
+		if(c == '\n')
+		{
+			if((parser->line_len != 0) && (parser->line[parser->line_len - 1] == '\r'))
+			{
+				parser->line_len--;
+			}
+
+			parser->line[parser->line_len] = '\0';
+			http_parse_line(parser);
+			parser->line_len = 0;
+			parser->line_cut = 0;
+		}
+		else if(parser->line_len < (HTTP_LINE_SZ - 1))
+		{
+			parser->line[parser->line_len++] = (char)c;
+		}
+		else
+		{
+			parser->line_cut = 1;
+		}
+	}
+
+	return index;
+}
+
+
+/*The connection ended, returns DEV_OK if that completed the response and DEV_ERROR if the response was cut short*/
+StatusTypeDef http_parser_close(http_parser *parser)
+{
+	if((parser->state == HTTP_BODY) && (parser->remaining == HTTP_NO_LENGTH))
+	{
+		parser->state = HTTP_DONE;
+	}
+
+	return (parser->state == HTTP_DONE) ? DEV_OK : DEV_ERROR;
+}
+
+
+uint8_t http_parser_done(const http_parser *parser)
+{
+	return (parser->state == HTTP_DONE) || (parser->state == HTTP_MALFORMED);
+}
+
+
+uint8_t http_parser_success(const http_parser *parser)
+{
+	return (parser->status >= 200) && (parser->status < 300);
+}
+
+
+/*Case-insensitive match of a header name, returns 1 if the line starts with "<name>:"*/
+static uint8_t http_name_is(const char *line, const char *name)
+{
+	while(*name != '\0')
+	{
+		if((*line | 0x20) != (*name | 0x20))
+		{
+			return 0;
+		}
+
+		line++;
+		name++;
+	}
+
+	return (*line == ':');
+}
+
+
+/*Value of a header line, without the blanks in front of it*/
+static const char *http_value(const char *line)
+{
+	while(*line++ != ':'){}
+
+	while((*line == ' ') || (*line == '\t'))
+	{
+		line++;
+	}
+
+	return line;
+}
+
+
+/*Case-insensitive search of a lower case token in a header value*/
+static uint8_t http_value_has(const char *value, const char *token)
+{
+	uint32_t i;
+
+	for(; *value != '\0'; value++)
+	{
+		for(i = 0; (token[i] != '\0') && ((value[i] | 0x20) == token[i]); i++){}
+
+		if(token[i] == '\0')
+		{
+			return 1;
+		}
+	}
+
+	return 0;
+}
+
+
+/*"HTTP/1.1 200 OK", blank lines in front of it are skipped*/
+static void http_status_line(http_parser *parser, const char *line)
+{
+	uint32_t digits = 0;
+	uint32_t value = 0;
+
+	if(*line == '\0')
+	{
+		return;
+	}
+
+	if(strncmp(line, "HTTP/", 5) != 0)
+	{
+		parser->state = HTTP_MALFORMED;
+		return;
+	}
+
+	while((*line != '\0') && (*line != ' '))
+	{
+		line++;
+	}
+
+	while(*line == ' ')
+	{
+		line++;
+	}
+
+	for(; (*line >= '0') && (*line <= '9'); line++, digits++)
+	{
+		value = (value * 10) + (*line - '0');
+	}
+
+	if((digits != 3) || (value < 100) || (value > 599))
+	{
+		parser->state = HTTP_MALFORMED;
+		return;
+	}
+
+	parser->status = value;
+	parser->state = HTTP_HEADER_LINE;
+}
+
+
+static void http_header_line(http_parser *parser, const char *line)
+{
+	const char *value;
+	uint32_t digits = 0;
+	uint32_t length = 0;
+
+	if(*line == '\0')
+	{
+		http_end_headers(parser);
+	}
+	else if(http_name_is(line, "content-length"))
+	{
+		for(value = http_value(line); (*value >= '0') && (*value <= '9'); value++, digits++)
+		{
+			length = (length * 10) + (*value - '0');
+		}
+
+		if((digits == 0) || (digits > HTTP_MAX_LENGTH_DIGITS))
+		{
+			parser->state = HTTP_MALFORMED;
+			return;
+		}
+
+		parser->content_length = length;
+	}
+	else if(http_name_is(line, "transfer-encoding"))
+	{
+		parser->chunked = http_value_has(http_value(line), "chunked");
+	}
+	else if(http_name_is(line, "connection"))
+	{
+		parser->close = http_value_has(http_value(line), "close");
+	}
+	else if(http_name_is(line, "etag"))
+	{
+		/*A cut ETag would never match, keep none*/
+		value = http_value(line);
+
+		if(!parser->line_cut && (strlen(value) < sizeof(parser->etag)))
+		{
+			strcpy(parser->etag, value);
+		}
+		else
+		{
+			parser->etag[0] = '\0';
+		}
+	}
+}
+
+
+/*Hex size, extensions after it are ignored*/
+static void http_chunk_size(http_parser *parser, const char *line)
+{
+	uint32_t digits = 0;
+	uint32_t size = 0;
+	char c;
+
+	for(; ; line++, digits++)
+	{
+		c = (char)(*line | 0x20);
+
+		if((*line >= '0') && (*line <= '9'))
+		{
+			size = (size << 4) | (uint32_t)(*line - '0');
+		}
+		else if((c >= 'a') && (c <= 'f'))
+		{
+			size = (size << 4) | (uint32_t)(c - 'a' + 10);
+		}
+		else
+		{
+			break;
+		}
+	}
+
+	if((digits == 0) || (digits > HTTP_MAX_CHUNK_DIGITS))
+	{
+		parser->state = HTTP_MALFORMED;
+		return;
+	}
+
+	parser->remaining = size;
+	parser->state = (size != 0) ? HTTP_CHUNK_DATA : HTTP_TRAILER;
+}
+
+
+/*Pick the framing of the body once the headers are in*/
+static void http_end_headers(http_parser *parser)
+{
+	if(parser->status < 200)
+	{
+		/*Interim response, the real one follows*/
+		parser->status = 0;
+		parser->content_length = HTTP_NO_LENGTH;
+		parser->chunked = 0;
+		parser->close = 0;
+		parser->etag[0] = '\0';
+		parser->state = HTTP_STATUS_LINE;
+	}
+	else if((parser->status == 204) || (parser->status == 304))
+	{
+		parser->state = HTTP_DONE;
+	}
+	else if(parser->chunked)
+	{
+		parser->state = HTTP_CHUNK_SIZE;
+	}
+	else
+	{
+		parser->remaining = parser->content_length;
+		parser->state = (parser->remaining != 0) ? HTTP_BODY : HTTP_DONE;
+	}
+}
+
+
+static void http_parse_line(http_parser *parser)
+{
+	switch(parser->state)
+	{
+		case HTTP_STATUS_LINE:
+			http_status_line(parser, parser->line);
+			break;
+
+		case HTTP_HEADER_LINE:
+			http_header_line(parser, parser->line);
+			break;
+
+		case HTTP_CHUNK_SIZE:
+			http_chunk_size(parser, parser->line);
+			break;
+
+		case HTTP_CHUNK_END:
+			/*Only the CRLF belongs here*/
+			parser->state = (parser->line[0] == '\0') ? HTTP_CHUNK_SIZE : HTTP_MALFORMED;
+			break;
+
+		case HTTP_TRAILER:
+			if(parser->line[0] == '\0')
+			{
+				parser->state = HTTP_DONE;
+			}
+			break;
+
+		default:
+			break;
+	}
+}
@@ -0,0 +1,88 @@
+/*
+ * File : image_header.c
+ * Author : Prudhvi Raj Belide
+ * Description : This file checks the image header of a slot. The header check is cheap and runs on every boot, the
+ * CRC over the payload runs on the CRC unit and is only needed when the image was not verified before.
+ */
+
+#include "image_header.h"
+#include <stddef.h>
+#include "crc32.h"
+#include "sha256.h"
+#include "ecdsa_p256.h"
+#include "image_key.h"
+
+static const uint8_t image_public_key[2 * P256_BYTES] = IMAGE_PUBLIC_KEY;
+
+
+const image_header *image_get_header(uint32_t slot_address)
+{
+	return (const image_header *)slot_address;
+}
+
+
+/*Check the header fields and the vector table they point at*/
+StatusTypeDef image_header_check(uint32_t slot_address, uint32_t slot_size)
+{
+	const image_header *header = image_get_header(slot_address);
+	uint32_t stack_pointer;
+	uint32_t reset_handler;
+
+	if((header->magic != IMAGE_MAGIC) || (header->header_version != IMAGE_HEADER_VERSION) ||
+	   (header->header_size != IMAGE_HEADER_SZ))
+	{
+		return DEV_ERROR;
+	}
+
+	if(crc32_words(CRC32_INIT, (const uint32_t *)header, (sizeof(image_header) - 4) / 4) != header->header_crc)
+	{
+		return DEV_ERROR;
+	}
+
+	if((header->image_size == 0) || ((header->image_size & 3U) != 0) ||
+	   (header->image_size > (slot_size - IMAGE_HEADER_SZ)) || (header->load_address != (slot_address + IMAGE_HEADER_SZ)))
+	{
+		return DEV_ERROR;
+	}
+
+	/*Stack pointer in SRAM, reset handler inside the payload*/
+	stack_pointer = *(__IO uint32_t *)header->load_address;
+	reset_handler = *(__IO uint32_t *)(header->load_address + 4);
+
+	if((stack_pointer <= IMAGE_SRAM_START) || (stack_pointer > IMAGE_SRAM_END) || (reset_handler < header->load_address) ||
+	   (reset_handler >= (header->load_address + header->image_size)))
+	{
+		return DEV_ERROR;
+	}
+
+	return DEV_OK;
+}
+
+
+/*Full check of the payload, only call on a slot that passed image_header_check()*/
+StatusTypeDef image_verify_payload(uint32_t slot_address)
+{
+	const image_header *header = image_get_header(slot_address);
+
+	if(crc32_hw_memory(header->load_address, header->image_size / 4) != header->crc)
+	{
+		return DEV_ERROR;
+	}
+
+	return DEV_OK;
+}
+
+
+/*Check the signature over the header fields, which include the payload SHA-256. The payload itself is matched
+ *against header->sha256 by whoever hashed it*/
+StatusTypeDef image_verify_signature(const image_header *header)
+{
+	sha256_context ctx;
+	uint8_t digest[SHA256_DIGEST_SZ];
+
+	sha256_init(&ctx);
+	sha256_update(&ctx, (const uint8_t *)header, offsetof(image_header, signature));
+	sha256_final(&ctx, digest);
+
+	return ecdsa_p256_verify(image_public_key, digest, header->signature);
+}
@@ -0,0 +1,162 @@
+/*
+ * File : ipd_deframer.c
+ * Author : Sriramkumar Jayaraman
+ * Description : This file implements a single pass state machine for the "+IPD,<len>:" framing of the ESP82xx.
+ * The header is parsed and exactly <len> payload bytes are handed on as spans without scanning them, so binary
+ * payload that happens to contain AT text can never be mistaken for framing. Work per byte is constant and the
+ * stream can be fed in pieces of any size.
+ */
+
+#include "ipd_deframer.h"
+
+#define IPD_MARKER			"+IPD,"
+#define IPD_MARKER_LEN		(sizeof(IPD_MARKER) - 1)
+#define IPD_MAX_DIGITS		5
+#define IPD_MAX_COMMAS		1		/*"+IPD,<len>:" or "+IPD,<link id>,<len>:"*/
+
+
+static void emit_text(ipd_deframer *deframer, const uint8_t *data, uint32_t length)
+{
+	if((length != 0) && (deframer->on_text != 0))
+	{
+		deframer->on_text(deframer->ctx, data, length);
+	}
+}
+
+
+void ipd_deframer_init(ipd_deframer *deframer, ipd_span_handler on_payload, ipd_span_handler on_text, void *ctx)
+{
+	deframer->state       = IPD_TEXT;
+	deframer->match       = 0;
+	deframer->field       = 0;
+	deframer->digits      = 0;
+	deframer->commas      = 0;
+	deframer->remaining   = 0;
+	deframer->header_len  = 0;
+	deframer->on_payload  = on_payload;
+	deframer->on_text     = on_text;
+	deframer->ctx         = ctx;
+	deframer->frames      = 0;
+	deframer->bad_headers = 0;
+}
+
+
+void ipd_deframer_feed(ipd_deframer *deframer, const uint8_t *data, uint32_t length)
+{
+	uint32_t index = 0;
+	uint32_t text_start = 0;	/*Start of the text run not handed on yet*/
+	uint32_t chunk;
+	uint8_t c;
+
+	while(index < length)
+	{
+		switch(deframer->state)
+		{
+			case IPD_TEXT:
+				c = data[index];
+
+				if(c == (uint8_t)IPD_MARKER[deframer->match])
+				{
+					/*Hold back the marker, hand on the text before it*/
+					if(deframer->match == 0)
+					{
+						emit_text(deframer, &data[text_start], index - text_start);
+					}
+
+					deframer->match++;
+					index++;
+					text_start = index;
+
+					if(deframer->match == IPD_MARKER_LEN)
+					{
+						deframer->match  = 0;
+						deframer->field  = 0;
+						deframer->digits = 0;
+						deframer->commas = 0;
+						deframer->header_len = 0;
+						deframer->state  = IPD_HEADER;
+					}
+				}
+				else if(deframer->match != 0)
+				{
+					/*False start, the held back characters were text after all. Retry this byte*/
+					emit_text(deframer, (const uint8_t *)IPD_MARKER, deframer->match);
+					deframer->match = 0;
+					text_start = index;
+				}
+				else
+				{
+					index++;
+				}
+				break;
+
+			case IPD_HEADER:
+				c = data[index];
+
+				if((c >= '0') && (c <= '9') && (deframer->digits < IPD_MAX_DIGITS))
+				{
+					deframer->field = (deframer->field * 10) + (c - '0');
+					deframer->digits++;
+					deframer->header[deframer->header_len++] = c;
+					index++;
+				}
+				else if((c == ',') && (deframer->digits != 0) && (deframer->commas < IPD_MAX_COMMAS))
+				{
+					/*The first number was the link id*/
+					deframer->field  = 0;
+					deframer->digits = 0;
+					deframer->commas++;
+					deframer->header[deframer->header_len++] = c;
+					index++;
+				}
+				else if((c == ':') && (deframer->digits != 0) && (deframer->field <= IPD_MAX_FRAME_SZ))
+				{
+					deframer->remaining = deframer->field;
+					deframer->frames++;
+					deframer->state = (deframer->remaining != 0) ? IPD_PAYLOAD : IPD_TEXT;
+					index++;
+					text_start = index;
+				}
+				else
+				{
+					/*Malformed header, what was taken for one is text after all. Retry this byte as text*/
+					deframer->bad_headers++;
+					emit_text(deframer, (const uint8_t *)IPD_MARKER, IPD_MARKER_LEN);
+					emit_text(deframer, deframer->header, deframer->header_len);
+					deframer->state = IPD_TEXT;
+					text_start = index;
+				}
+				break;
+
+			case IPD_PAYLOAD:
+				/*Hand on the payload as one span, it is never scanned*/
+				chunk = length - index;
+
+				if(chunk > deframer->remaining)
+				{
+					chunk = deframer->remaining;
+				}
+
+				deframer->on_payload(deframer->ctx, &data[index], chunk);
+				deframer->remaining -= chunk;
+				index += chunk;
+
+				if(deframer->remaining == 0)
+				{
+					deframer->state = IPD_TEXT;
+					text_start = index;
+				}
+				break;
+
+			default:
+				deframer->state = IPD_TEXT;
+				break;
+		}
+	}
+
+	/*Hand on the text at the end of the span*/
+	if(deframer->state == IPD_TEXT)
+	{
+		emit_text(deframer, &data[text_start], index - text_start);
+	}
+}
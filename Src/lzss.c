@@ -0,0 +1,122 @@
+/*
+ * File : lzss.c
+ * Author : Prudhvi Raj Belide
+ * Description : This file decodes an LZSS stream as it arrives. A control byte announces eight items, each a literal
+ * byte or a two byte match {distance - 1 low byte, distance - 1 high nibble << 4 | length - 3}. The decoder keeps
+ * its state between chunks, so a chunk may end anywhere, even inside a match.
+ */
+
+#include "lzss.h"
+
+#define LZSS_WINDOW_MASK		(LZSS_WINDOW_SZ - 1)
+
+static void lzss_emit(lzss_decoder *decoder);
+
+
+void lzss_init(lzss_decoder *decoder, lzss_sink sink, void *ctx)
+{
+	decoder->head        = 0;
+	decoder->emitted     = 0;
+	decoder->produced    = 0;
+	decoder->items       = 0;
+	decoder->match_split = 0;
+	decoder->sink        = sink;
+	decoder->ctx         = ctx;
+}
+
+
+void lzss_feed(lzss_decoder *decoder, const uint8_t *data, uint32_t length)
+{
+	uint8_t *window = decoder->window;
+	uint32_t head = decoder->head;
+	uint32_t distance, count, from, i;
+	uint8_t low;
+
+	while(length != 0)
+	{
+		if(decoder->items == 0)
+		{
+			decoder->flags = *data++;
+			decoder->items = 8;
+			length--;
+			continue;
+		}
+
+		if(decoder->flags & 1U)
+		{
+			window[head] = *data++;
+			length--;
+			count = 1;
+		}
+		else
+		{
+			/*A match needs both bytes, keep the first one if the chunk ends in between*/
+			if(decoder->match_split)
+			{
+				low = decoder->match_low;
+				decoder->match_split = 0;
+			}
+			else
+			{
+				low = *data++;
+
+				if(--length == 0)
+				{
+					decoder->match_low   = low;
+					decoder->match_split = 1;
+					break;
+				}
+			}
+
+			distance = (low | ((uint32_t)(*data & 0xF0U) << 4)) + 1;
+			count    = (*data & 0x0FU) + LZSS_MIN_MATCH;
+			data++;
+			length--;
+
+			/*Byte by byte, the match may overlap the bytes it produces*/
+			from = head - distance;
+
+			for(i = 0; i < count; i++)
+			{
+				window[(head + i) & LZSS_WINDOW_MASK] = window[(from + i) & LZSS_WINDOW_MASK];
+
+				if(((head + i) & LZSS_WINDOW_MASK) == LZSS_WINDOW_MASK)
+				{
+					/*The window wraps, hand the bytes up to its end to the sink first*/
+					decoder->head = LZSS_WINDOW_SZ;
+					lzss_emit(decoder);
+				}
+			}
+		}
+
+		decoder->flags >>= 1;
+		decoder->items--;
+		decoder->produced += count;
+
+		if(count == 1)
+		{
+			if(head == LZSS_WINDOW_MASK)
+			{
+				decoder->head = LZSS_WINDOW_SZ;
+				lzss_emit(decoder);
+			}
+		}
+
+		head = (head + count) & LZSS_WINDOW_MASK;
+	}
+
+	decoder->head = head;
+	lzss_emit(decoder);
+}
+
+
+/*Pass the bytes decoded since the last call to the sink*/
+static void lzss_emit(lzss_decoder *decoder)
+{
+	if(decoder->head != decoder->emitted)
+	{
+		decoder->sink(decoder->ctx, &decoder->window[decoder->emitted], decoder->head - decoder->emitted);
+	}
+
+	decoder->emitted = decoder->head & LZSS_WINDOW_MASK;
+}
@@ -7,26 +7,44 @@
 
 
 #include <stdio.h>
+#include <string.h>
 #include "stm32f4xx.h"
 #include "fpu.h"
 #include "bsp.h"
 #include "adc.h"
 #include "circular_buffer.h"
 #include "fota_processor.h"
+#include "http_client.h"
+#include "flash_async.h"
+#include "ram_exec.h"
+#include "nvm_store.h"
+#include "boot_control.h"
+#include "crc32.h"
+#include "semver.h"
 
 #define SSID_NAME  "Arsive"
 #define PASSKEY    "hps@e206"
 
+#define ESP_JOIN_ATTEMPTS	3		/*Joins tried before the update is given up and the application boots*/
+#define ESP_RESUME_ATTEMPTS	1		/*Joins tried for an interrupted download the button did not ask for*/
 
-char version_buff[10] = {0};
-char temp_ver_buffer[25] = {0};
+
+char version_buff[SEMVER_TEXT_SZ] = {0};
 
 
 int main()
 {
+	firmwareRelease release;
+	uint32_t attempt;
+	uint32_t attempts;
+	uint8_t requested;
+
 	/*Enable FPU*/
 	fpu_enable();
 
+	/*Serve interrupts from a vector table in SRAM*/
+	ram_vector_table_init();
+
 	/*Initialize debug UART*/
 	debug_uart_init();
 	esp_uart_init();
@@ -34,6 +52,20 @@ int main()
 	/*Initialize timebase*/
 	timebase_init();
 
+	/*Detect the flash layout and initialize background flash engine*/
+	flash_geometry_init();
+	flash_async_init();
+
+	/*Enable the CRC unit used to check images*/
+	crc32_hw_init();
+
+	/*Load the settings index and count the boot*/
+	nvm_init();
+	nvm_write_u32(NVM_KEY_BOOT_COUNT, nvm_read_u32(NVM_KEY_BOOT_COUNT, 0) + 1);
+
+	/*Load the slot selection*/
+	boot_control_init();
+
 	/*Initialize LED*/
 	led_init();
 
@@ -45,7 +77,11 @@ int main()
 	circular_buffer_init();
 
 
-	if(get_btn_state()){
+	/*An interrupted download is resumed without waiting for the button. Without a network it keeps its journal and
+	 *the application boots, the next boot or button press tries again*/
+	requested = get_btn_state();
+
+	if(requested || firmware_update_pending()){
 
 
 #ifdef DEBUG_OUTPUT
@@ -54,32 +90,90 @@ int main()
 
 #endif
 
-		esp8266_init(SSID_NAME,PASSKEY);
+		/*Prepare the slot, nothing is erased or written before the version check found a newer release*/
+		firmware_update_prepare();
+
+		/*The active slot still boots, so a missing network only skips the update*/
+		attempts = requested ? ESP_JOIN_ATTEMPTS : ESP_RESUME_ATTEMPTS;
 
+		for(attempt = 0; (attempt < attempts) && (esp8266_init(SSID_NAME,PASSKEY) != 1); attempt++)
+		{
+#ifdef DEBUG_OUTPUT
+			buffer_send_string("ESP init failed, retrying....\n\r",debug_port);
+#endif
+		}
+
+		if(attempt == attempts)
+		{
+			release = FIRMWARE_RELEASE_FAILED;
+		}
+		else
+		{
 #ifdef DEBUG_OUTPUT
-		buffer_send_string("STAGE: Getting firmware version\n\r",debug_port);
+			buffer_send_string("STAGE: Getting firmware version\n\r",debug_port);
 
 #endif
 
-		esp82xx_get_version_file(version_buff);
-		sprintf(temp_ver_buffer,"Version:%s\r\n", version_buff);
+			/*The version check is conditional on the last release seen, the first request of the update goes out
+			 *with it*/
+			http_client_init();
+
+			release = firmware_check_release(version_buff, sizeof(version_buff));
+		}
+
+		if(release == FIRMWARE_RELEASE_FAILED)
+		{
+#ifdef DEBUG_OUTPUT
+			buffer_send_string("STAGE: Version check failed, keeping the current firmware....\r\n",debug_port);
+#endif
+		}
+		else if(release == FIRMWARE_RELEASE_CURRENT)
+		{
+#ifdef DEBUG_OUTPUT
+			buffer_send_string("STAGE: Firmware is up to date....\r\n",debug_port);
+#endif
 
+			/*The release an interrupted download was fetching is gone, do not join again on every boot*/
+			firmware_update_discard();
+		}
+		else
+		{
 #ifdef DEBUG_OUTPUT
-		buffer_send_string(temp_ver_buffer,debug_port);
+			buffer_send_string("Version:",debug_port);
+			buffer_send_string(version_buff,debug_port);
+			buffer_send_string("\r\n",debug_port);
 
 #endif
 
-		firmware_update();
+			if(firmware_update() == DEV_OK)
+			{
+				/*Remember what is installed*/
+				nvm_write(NVM_KEY_INSTALLED_VERSION, version_buff, strlen(version_buff));
+				firmware_release_installed();
+
+#ifdef DEBUG_OUTPUT
+				buffer_send_string("STAGE: Jumping to new firmware....\r\n",debug_port);
+#endif
+			}
+			else
+			{
+#ifdef DEBUG_OUTPUT
+				buffer_send_string("STAGE: Update failed, keeping the current firmware....\r\n",debug_port);
+#endif
+			}
+		}
+
+		/*Nothing is left to fetch*/
+		http_client_close();
 
 #ifdef DEBUG_OUTPUT
-		buffer_send_string("STAGE: Jumping to new firmware....\r\n",debug_port);
 		buffer_send_string("************************************************\n\r",debug_port);
 
 		systick_delay_ms(2000);
 
 #endif
 
-		jump_to_app(NEW_FIRMWARE_START_ADDRESS);
+		boot_start_application();
 
 	}
 	else
@@ -90,10 +184,15 @@ int main()
 #endif
 
 
-		jump_to_app(NEW_FIRMWARE_START_ADDRESS);
+		boot_start_application();
 
 	}
 
+	/*Only reached when neither slot holds a valid image*/
+#ifdef DEBUG_OUTPUT
+	buffer_send_string("No valid firmware in either slot\n\r",debug_port);
+#endif
+
 	return 0;
 }
 
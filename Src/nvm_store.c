@@ -0,0 +1,366 @@
+/*
+ * File : nvm_store.c
+ * Author : Prudhvi Raj Belide
+ * Description : This file implements a log structured key-value store on two flash sectors. Every write appends a
+ * record to the active sector, the newest valid record of a key wins. When the active sector is full the live
+ * records are copied to the other sector, which then becomes active. A RAM index built at boot points at the newest
+ * record of each key.
+ */
+
+#include <string.h>
+#include "nvm_store.h"
+#include "flash_async.h"
+#include "crc32.h"
+
+#define NVM_BLANK_WORD		0xFFFFFFFFU
+
+typedef struct
+{
+	uint32_t base;						/*Address of the active sector*/
+	uint32_t sequence;					/*Sequence number of the active sector*/
+	uint32_t write_address;				/*Next record goes here*/
+	uint32_t index[NVM_MAX_KEYS];		/*Newest record of each key, 0 if the key is not set*/
+	uint8_t ready;
+	uint8_t dirty;						/*A torn record breaks the log, compact before the next write*/
+
+}nvm_state;
+
+static nvm_state nvm;
+
+/*Record being written or moved*/
+static uint32_t record_buff[(sizeof(nvm_record) + NVM_MAX_VALUE_SZ) / 4];
+
+static uint32_t nvm_record_size(uint32_t length);
+static uint32_t nvm_record_crc(const uint32_t *record);
+static uint8_t nvm_record_valid(uint32_t address, uint32_t end);
+static void nvm_scan(uint32_t base, uint32_t sequence);
+static StatusTypeDef nvm_program(uint32_t address, const void *data, uint32_t length);
+static StatusTypeDef nvm_format(uint32_t sector, uint32_t address, uint32_t sequence);
+static StatusTypeDef nvm_compact(void);
+
+
+StatusTypeDef nvm_init(void)
+{
+	const nvm_sector_header *a = (const nvm_sector_header *)NVM_SECTOR_A_ADDRESS;
+	const nvm_sector_header *b = (const nvm_sector_header *)NVM_SECTOR_B_ADDRESS;
+	uint8_t a_valid = (a->magic == NVM_MAGIC);
+	uint8_t b_valid = (b->magic == NVM_MAGIC);
+
+	nvm.ready = 0;
+
+	/*Use the sector with the newer sequence, a compaction cut short leaves the old one active*/
+	if(a_valid && (!b_valid || ((int32_t)(a->sequence - b->sequence) > 0)))
+	{
+		nvm_scan(NVM_SECTOR_A_ADDRESS, a->sequence);
+	}
+	else if(b_valid)
+	{
+		nvm_scan(NVM_SECTOR_B_ADDRESS, b->sequence);
+	}
+	else
+	{
+		/*Blank store*/
+		if(nvm_format(NVM_SECTOR_A, NVM_SECTOR_A_ADDRESS, 1) != DEV_OK)
+		{
+			return DEV_ERROR;
+		}
+
+		nvm_scan(NVM_SECTOR_A_ADDRESS, 1);
+	}
+
+	nvm.ready = 1;
+
+	return DEV_OK;
+}
+
+
+/*Copy the value of a key, returns its length or -1 if the key is not set*/
+int32_t nvm_read(uint16_t key, void *value, uint16_t max_length)
+{
+	const nvm_record *record;
+
+	if(!nvm.ready || (key >= NVM_MAX_KEYS) || (nvm.index[key] == 0))
+	{
+		return -1;
+	}
+
+	record = (const nvm_record *)nvm.index[key];
+
+	memcpy(value, (const uint8_t *)(record + 1), (record->length < max_length) ? record->length : max_length);
+
+	return record->length;
+}
+
+
+StatusTypeDef nvm_write(uint16_t key, const void *value, uint16_t length)
+{
+	const nvm_record *current;
+	nvm_record *record = (nvm_record *)record_buff;
+	uint32_t size = nvm_record_size(length);
+	StatusTypeDef status;
+
+	if((!nvm.ready && (nvm_init() != DEV_OK)) || (key >= NVM_MAX_KEYS) || (length > NVM_MAX_VALUE_SZ))
+	{
+		return DEV_ERROR;
+	}
+
+	/*Nothing to do if the store already holds the value*/
+	current = (const nvm_record *)nvm.index[key];
+
+	if((current == 0) ? (length == 0) :
+	   ((current->length == length) && (memcmp(current + 1, value, length) == 0)))
+	{
+		return DEV_OK;
+	}
+
+	/*Make room by moving the live records to the other sector*/
+	if(nvm.dirty || ((nvm.write_address + size) > (nvm.base + NVM_SECTOR_SZ)))
+	{
+		if((nvm_compact() != DEV_OK) || ((nvm.write_address + size) > (nvm.base + NVM_SECTOR_SZ)))
+		{
+			return DEV_ERROR;
+		}
+	}
+
+	/*Build the record, the padding stays erased*/
+	memset(record_buff, 0xFF, size);
+	record->key    = key;
+	record->length = length;
+	memcpy(record + 1, value, length);
+	record->crc    = nvm_record_crc(record_buff);
+
+	status = nvm_program(nvm.write_address, record_buff, size);
+
+	/*A torn or failed record is skipped by the next scan, the space is lost either way*/
+	if((status == DEV_OK) && nvm_record_valid(nvm.write_address, nvm.base + NVM_SECTOR_SZ))
+	{
+		nvm.index[key] = (length != 0) ? nvm.write_address : 0;
+	}
+	else
+	{
+		nvm.dirty = 1;
+		status = DEV_ERROR;
+	}
+
+	nvm.write_address += size;
+
+	return status;
+}
+
+
+StatusTypeDef nvm_delete(uint16_t key)
+{
+	return nvm_write(key, 0, 0);
+}
+
+
+uint32_t nvm_read_u32(uint16_t key, uint32_t default_value)
+{
+	uint32_t value;
+
+	if(nvm_read(key, &value, sizeof(value)) != sizeof(value))
+	{
+		return default_value;
+	}
+
+	return value;
+}
+
+
+StatusTypeDef nvm_write_u32(uint16_t key, uint32_t value)
+{
+	return nvm_write(key, &value, sizeof(value));
+}
+
+
+uint32_t nvm_free_space(void)
+{
+	return (nvm.base + NVM_SECTOR_SZ) - nvm.write_address;
+}
+
+
+static uint32_t nvm_record_size(uint32_t length)
+{
+	return sizeof(nvm_record) + ((length + 3U) & ~3U);
+}
+
+
+/*CRC over the key/length word and the padded value, skipping the CRC word itself*/
+static uint32_t nvm_record_crc(const uint32_t *record)
+{
+	const nvm_record *header = (const nvm_record *)record;
+	uint32_t crc;
+
+	crc = crc32_words(CRC32_INIT, record, 1);
+
+	return crc32_words(crc, record + 2, (nvm_record_size(header->length) - sizeof(nvm_record)) / 4);
+}
+
+
+static uint8_t nvm_record_valid(uint32_t address, uint32_t end)
+{
+	const nvm_record *record = (const nvm_record *)address;
+
+	return (record->key < NVM_MAX_KEYS) && (record->length <= NVM_MAX_VALUE_SZ) &&
+		   ((address + nvm_record_size(record->length)) <= end) &&
+		   (nvm_record_crc((const uint32_t *)address) == record->crc);
+}
+
+
+/*Walk the log of a sector and index the newest record of each key*/
+static void nvm_scan(uint32_t base, uint32_t sequence)
+{
+	uint32_t end = base + NVM_SECTOR_SZ;
+	uint32_t address = base + sizeof(nvm_sector_header);
+	const nvm_record *record;
+
+	nvm.base     = base;
+	nvm.sequence = sequence;
+	nvm.dirty    = 0;
+	memset(nvm.index, 0, sizeof(nvm.index));
+
+	while((address + sizeof(nvm_record)) <= end)
+	{
+		record = (const nvm_record *)address;
+
+		/*Erased flash ends the log*/
+		if(*(const uint32_t *)address == NVM_BLANK_WORD)
+		{
+			break;
+		}
+
+		if((record->key >= NVM_MAX_KEYS) || (record->length > NVM_MAX_VALUE_SZ) ||
+		   ((address + nvm_record_size(record->length)) > end))
+		{
+			/*Header cut short, nothing behind it can be trusted. Records after it would be lost on the next
+			 *scan, so the next write compacts first*/
+			nvm.dirty = 1;
+			address = end;
+
+			while((address > base) && (*(const uint32_t *)(address - 4) == NVM_BLANK_WORD))
+			{
+				address -= 4;
+			}
+			break;
+		}
+
+		if(nvm_record_crc((const uint32_t *)address) == record->crc)
+		{
+			nvm.index[record->key] = (record->length != 0) ? address : 0;
+		}
+
+		address += nvm_record_size(record->length);
+	}
+
+	nvm.write_address = address;
+}
+
+
+static StatusTypeDef nvm_program(uint32_t address, const void *data, uint32_t length)
+{
+	StatusTypeDef status;
+
+	/*The flash engine may still work on a download*/
+	flash_async_flush();
+
+	status = flash_unlock();
+
+	if(status == DEV_OK)
+	{
+		status = flash_program_buffer(address, data, length, FLASH_VOLTAGE_RANGE_3);
+	}
+
+	flash_lock();
+
+	return status;
+}
+
+
+/*Erase a sector and mark it as the store with the given sequence*/
+static StatusTypeDef nvm_format(uint32_t sector, uint32_t address, uint32_t sequence)
+{
+	FLASH_EraseInitTypeDef EraseInitStruct;
+	nvm_sector_header header = {NVM_MAGIC, sequence};
+	uint32_t sect_err;
+	StatusTypeDef status;
+
+	flash_async_flush();
+
+	status = flash_unlock();
+
+	if(status == DEV_OK)
+	{
+		EraseInitStruct.TypeErase    = FLASH_TYPEERASE_SECTORS;
+		EraseInitStruct.VoltageRange = FLASH_VOLTAGE_RANGE_3;
+		EraseInitStruct.Sector       = sector;
+		EraseInitStruct.NbSectors    = 1;
+
+		status = flash_ex_erase(&EraseInitStruct, &sect_err);
+	}
+
+	flash_lock();
+
+	if(status == DEV_OK)
+	{
+		status = nvm_program(address, &header, sizeof(header));
+	}
+
+	return status;
+}
+
+
+/*Copy the newest record of every key to the other sector. The header of the new sector is written last, a
+ *compaction cut short leaves the old sector active*/
+static StatusTypeDef nvm_compact(void)
+{
+	uint32_t base   = (nvm.base == NVM_SECTOR_A_ADDRESS) ? NVM_SECTOR_B_ADDRESS : NVM_SECTOR_A_ADDRESS;
+	uint32_t sector = (nvm.base == NVM_SECTOR_A_ADDRESS) ? NVM_SECTOR_B : NVM_SECTOR_A;
+	nvm_sector_header header = {NVM_MAGIC, nvm.sequence + 1};
+	FLASH_EraseInitTypeDef EraseInitStruct;
+	uint32_t address = base + sizeof(nvm_sector_header);
+	uint32_t sect_err;
+	uint32_t size;
+	uint32_t key;
+	StatusTypeDef status;
+
+	flash_async_flush();
+
+	status = flash_unlock();
+
+	if(status == DEV_OK)
+	{
+		EraseInitStruct.TypeErase    = FLASH_TYPEERASE_SECTORS;
+		EraseInitStruct.VoltageRange = FLASH_VOLTAGE_RANGE_3;
+		EraseInitStruct.Sector       = sector;
+		EraseInitStruct.NbSectors    = 1;
+
+		status = flash_ex_erase(&EraseInitStruct, &sect_err);
+	}
+
+	flash_lock();
+
+	for(key = 0; (key < NVM_MAX_KEYS) && (status == DEV_OK); key++)
+	{
+		if(nvm.index[key] != 0)
+		{
+			/*Stage the record in RAM, the flash is not read while it programs*/
+			size = nvm_record_size(((const nvm_record *)nvm.index[key])->length);
+			memcpy(record_buff, (const void *)nvm.index[key], size);
+
+			status = nvm_program(address, record_buff, size);
+			address += size;
+		}
+	}
+
+	if(status == DEV_OK)
+	{
+		status = nvm_program(base, &header, sizeof(header));
+	}
+
+	if(status == DEV_OK)
+	{
+		nvm_scan(base, header.sequence);
+	}
+
+	return status;
+}
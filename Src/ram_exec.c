@@ -0,0 +1,36 @@
+/*
+ * File : ram_exec.c
+ * Author : Prudhvi Raj Belide
+ * Description : This file moves the vector table to SRAM, so the core does not need to read flash to take an
+ * interrupt while the flash is busy erasing or programming.
+ */
+
+#include <stdint.h>
+#include "stm32f4xx.h"
+#include "ram_exec.h"
+
+/*Vector table of the startup file*/
+extern uint32_t g_pfnVectors[];
+
+/*VTOR needs the table aligned to its size rounded up to a power of two*/
+static uint32_t ram_vectors[RAM_VECTOR_NUM] __attribute__((section(".ram_vector"), aligned(512)));
+
+
+void ram_vector_table_init(void)
+{
+	uint32_t index;
+
+	__disable_irq();
+
+	/*Copy the flash vector table*/
+	for(index = 0; index < RAM_VECTOR_NUM; index++)
+	{
+		ram_vectors[index] = g_pfnVectors[index];
+	}
+
+	/*Point the core at the copy*/
+	SCB->VTOR = (uint32_t)ram_vectors;
+	__DSB();
+
+	__enable_irq();
+}
@@ -0,0 +1,160 @@
+/*
+ * File : response_matcher.c
+ * Author : Sriramkumar Jayaraman
+ * Description : This file builds an Aho-Corasick automaton over a set of reply strings and runs it over the bytes
+ * received from the ESP82xx. Every byte is examined once, no matter how many replies are being waited for, and the
+ * matcher reports which patterns hit and where in the stream.
+ */
+
+#include <string.h>
+#include "response_matcher.h"
+
+#define NO_STATE		0xFFU
+
+
+int response_automaton_build(response_automaton *automaton, const char * const *patterns, uint32_t count)
+{
+	uint8_t fail[MATCHER_MAX_STATES];
+	uint8_t queue[MATCHER_MAX_STATES];
+	uint32_t q_head = 0;
+	uint32_t q_tail = 0;
+	uint32_t index;
+	uint32_t state;
+	uint32_t cls;
+	const uint8_t *p;
+
+	if(count > MATCHER_MAX_PATTERNS)
+	{
+		return -1;
+	}
+
+	memset(automaton, 0, sizeof(*automaton));
+	memset(automaton->next, NO_STATE, sizeof(automaton->next));
+
+	/*Give every byte used in a pattern its own class*/
+	automaton->num_classes = 1;
+
+	for(index = 0; index < count; index++)
+	{
+		for(p = (const uint8_t *)patterns[index]; *p != '\0'; p++)
+		{
+			if(automaton->byte_class[*p] == 0)
+			{
+				if(automaton->num_classes == MATCHER_MAX_CLASSES)
+				{
+					return -1;
+				}
+
+				automaton->byte_class[*p] = (uint8_t)automaton->num_classes++;
+			}
+		}
+	}
+
+	/*Build the trie, state 0 is the root*/
+	automaton->num_states = 1;
+
+	for(index = 0; index < count; index++)
+	{
+		state = 0;
+
+		for(p = (const uint8_t *)patterns[index]; *p != '\0'; p++)
+		{
+			cls = automaton->byte_class[*p];
+
+			if(automaton->next[state][cls] == NO_STATE)
+			{
+				if(automaton->num_states == MATCHER_MAX_STATES)
+				{
+					return -1;
+				}
+
+				automaton->next[state][cls] = (uint8_t)automaton->num_states++;
+			}
+
+			state = automaton->next[state][cls];
+		}
+
+		automaton->output[state] |= (1UL << index);
+	}
+
+	/*Missing root transitions stay at the root*/
+	for(cls = 0; cls < automaton->num_classes; cls++)
+	{
+		if(automaton->next[0][cls] == NO_STATE)
+		{
+			automaton->next[0][cls] = 0;
+		}
+		else
+		{
+			fail[automaton->next[0][cls]] = 0;
+			queue[q_tail++] = automaton->next[0][cls];
+		}
+	}
+
+	/*Breadth first: failure links, inherited outputs, and missing transitions taken from the failure state*/
+	while(q_head != q_tail)
+	{
+		state = queue[q_head++];
+		automaton->output[state] |= automaton->output[fail[state]];
+
+		for(cls = 0; cls < automaton->num_classes; cls++)
+		{
+			uint8_t child = automaton->next[state][cls];
+
+			if(child == NO_STATE)
+			{
+				automaton->next[state][cls] = automaton->next[fail[state]][cls];
+			}
+			else
+			{
+				fail[child] = automaton->next[fail[state]][cls];
+				queue[q_tail++] = child;
+			}
+		}
+	}
+
+	return 0;
+}
+
+
+void response_matcher_init(response_matcher *matcher, const response_automaton *automaton)
+{
+	matcher->automaton = automaton;
+	matcher->state     = 0;
+	matcher->offset    = 0;
+}
+
+/*
+ * Feeds bytes until one of the patterns in mask completes. Returns the number of bytes consumed, which includes
+ * the last byte of the match, so the caller can hand the rest of the data to the next stage. match->patterns is 0
+ * if all bytes were consumed without a hit.
+ */
+uint32_t response_matcher_feed(response_matcher *matcher, const uint8_t *data, uint32_t length, uint32_t mask,
+		response_match *match)
+{
+	const response_automaton *automaton = matcher->automaton;
+	uint32_t state = matcher->state;
+	uint32_t index;
+	uint32_t hit;
+
+	match->patterns = 0;
+
+	for(index = 0; index < length; index++)
+	{
+		state = automaton->next[state][automaton->byte_class[data[index]]];
+		hit = automaton->output[state] & mask;
+
+		if(hit != 0)
+		{
+			index++;
+			match->patterns = hit;
+			break;
+		}
+	}
+
+	matcher->state   = state;
+	matcher->offset += index;
+	match->offset    = matcher->offset;
+
+	return index;
+}
@@ -0,0 +1,92 @@
+/*
+ * File : ring_buffer.c
+ * Author : Prudhvi Raj Belide
+ * Description : This file implements the bulk operations of the single-producer/single-consumer ring. They hand out
+ * the used or free part of the ring as at most two contiguous regions, so parsers and DMA can work in place.
+ */
+
+#include <string.h>
+#include "ring_buffer.h"
+
+/*Splits count bytes starting at position start into the regions before and after the wrap*/
+static uint32_t ring_split(const ring_buffer *ring, uint32_t start, uint32_t count, ring_span *span)
+{
+	uint32_t offset = start & ring->mask;
+	uint32_t first  = ring_capacity(ring) - offset;
+
+	if(first > count)
+	{
+		first = count;
+	}
+
+	span->data[0]   = &ring->storage[offset];
+	span->length[0] = first;
+	span->data[1]   = ring->storage;
+	span->length[1] = count - first;
+
+	return count;
+}
+
+/*Consumer side: regions holding data, nothing is removed*/
+uint32_t ring_peek_contiguous(const ring_buffer *ring, ring_span *span)
+{
+	uint32_t tail  = ring->tail;
+	uint32_t count = ring->head - tail;
+
+	/*Head must be read before the data it covers*/
+	__DMB();
+
+	return ring_split(ring, tail, count, span);
+}
+
+/*Producer side: regions that can be filled before calling ring_commit()*/
+uint32_t ring_peek_free(const ring_buffer *ring, ring_span *span)
+{
+	uint32_t head = ring->head;
+
+	return ring_split(ring, head, ring_capacity(ring) - (head - ring->tail), span);
+}
+
+/*Consumer side: copy out and remove up to length bytes*/
+uint32_t ring_read_span(ring_buffer *ring, uint8_t *dest, uint32_t length)
+{
+	ring_span span;
+	uint32_t count = ring_peek_contiguous(ring, &span);
+	uint32_t first;
+
+	if(count > length)
+	{
+		count = length;
+	}
+
+	first = (span.length[0] < count) ? span.length[0] : count;
+
+	memcpy(dest, span.data[0], first);
+	memcpy(dest + first, span.data[1], count - first);
+
+	ring_consume(ring, count);
+
+	return count;
+}
+
+/*Producer side: copy in up to length bytes, returns the number stored*/
+uint32_t ring_write_span(ring_buffer *ring, const uint8_t *src, uint32_t length)
+{
+	ring_span span;
+	uint32_t count = ring_peek_free(ring, &span);
+	uint32_t first;
+
+	if(count > length)
+	{
+		count = length;
+	}
+
+	first = (span.length[0] < count) ? span.length[0] : count;
+
+	memcpy(span.data[0], src, first);
+	memcpy(span.data[1], src + first, count - first);
+
+	ring_commit(ring, count);
+
+	return count;
+}
@@ -0,0 +1,204 @@
+/*
+ * File : semver.c
+ * Author : Prudhvi Raj Belide
+ * Description : This file parses release versions and compares them by Semantic Versioning precedence: major,
+ * minor and patch numerically, then a release above any of its pre-releases, and pre-releases identifier by
+ * identifier with numeric ones compared as numbers. Build metadata is accepted and ignored. A missing patch number
+ * reads as 0, so "1.2" and "1.2.0" are the same version.
+ */
+
+#include <string.h>
+#include "semver.h"
+
+#define SEMVER_MAX_DIGITS		9		/*Keeps every number below 2^32*/
+
+static const char *semver_number(const char *text, uint32_t *value);
+static uint8_t semver_ident_char(char c);
+static int32_t semver_compare_pre(const char *a, const char *b);
+
+
+/*Returns DEV_ERROR if the text is not a version, surrounding blanks are allowed*/
+StatusTypeDef semver_parse(const char *text, semver *version)
+{
+	uint32_t length = 0;
+
+	memset(version, 0, sizeof(*version));
+
+	while((*text == ' ') || (*text == '\t'))
+	{
+		text++;
+	}
+
+	if((*text == 'v') || (*text == 'V'))
+	{
+		text++;
+	}
+
+	if(((text = semver_number(text, &version->major)) == 0) || (*text++ != '.') ||
+	   ((text = semver_number(text, &version->minor)) == 0))
+	{
+		return DEV_ERROR;
+	}
+
+	if((*text == '.') && ((text = semver_number(text + 1, &version->patch)) == 0))
+	{
+		return DEV_ERROR;
+	}
+
+	if(*text == '-')
+	{
+		for(text++; semver_ident_char(*text); text++)
+		{
+			/*Identifiers are separated by single dots*/
+			if((*text == '.') && ((length == 0) || (version->pre[length - 1] == '.')))
+			{
+				return DEV_ERROR;
+			}
+
+			if(length == (SEMVER_PRE_SZ - 1))
+			{
+				return DEV_ERROR;
+			}
+
+			version->pre[length++] = *text;
+		}
+
+		if((length == 0) || (version->pre[length - 1] == '.'))
+		{
+			return DEV_ERROR;
+		}
+	}
+
+	if(*text == '+')
+	{
+		for(text++; semver_ident_char(*text); text++){}
+	}
+
+	while((*text == ' ') || (*text == '\t'))
+	{
+		text++;
+	}
+
+	return (*text == '\0') ? DEV_OK : DEV_ERROR;
+}
+
+
+/*Negative if a is older than b, 0 if they have the same precedence, positive if a is newer*/
+int32_t semver_compare(const semver *a, const semver *b)
+{
+	if(a->major != b->major)
+	{
+		return (a->major > b->major) ? 1 : -1;
+	}
+
+	if(a->minor != b->minor)
+	{
+		return (a->minor > b->minor) ? 1 : -1;
+	}
+
+	if(a->patch != b->patch)
+	{
+		return (a->patch > b->patch) ? 1 : -1;
+	}
+
+	/*A release is newer than its pre-releases*/
+	if((a->pre[0] == '\0') || (b->pre[0] == '\0'))
+	{
+		return (int32_t)(a->pre[0] == '\0') - (int32_t)(b->pre[0] == '\0');
+	}
+
+	return semver_compare_pre(a->pre, b->pre);
+}
+
+
+/*Version of the numbers an image header carries*/
+void semver_from_numbers(semver *version, uint32_t major, uint32_t minor, uint32_t patch)
+{
+	memset(version, 0, sizeof(*version));
+	version->major = major;
+	version->minor = minor;
+	version->patch = patch;
+}
+
+
+/*Decimal number, returns the text behind it or 0 if there is none*/
+static const char *semver_number(const char *text, uint32_t *value)
+{
+	uint32_t digits = 0;
+
+	for(*value = 0; (*text >= '0') && (*text <= '9'); text++, digits++)
+	{
+		*value = (*value * 10) + (uint32_t)(*text - '0');
+	}
+
+	return ((digits == 0) || (digits > SEMVER_MAX_DIGITS)) ? 0 : text;
+}
+
+
+static uint8_t semver_ident_char(char c)
+{
+	return ((c >= '0') && (c <= '9')) || ((c >= 'a') && (c <= 'z')) || ((c >= 'A') && (c <= 'Z')) ||
+		   (c == '-') || (c == '.');
+}
+
+
+/*Dot separated identifiers left to right, numeric ones are lower than alphanumeric ones*/
+static int32_t semver_compare_pre(const char *a, const char *b)
+{
+	uint32_t len_a;
+	uint32_t len_b;
+	uint8_t numeric_a;
+	uint8_t numeric_b;
+	int32_t order;
+
+	while((*a != '\0') && (*b != '\0'))
+	{
+		len_a = strcspn(a, ".");
+		len_b = strcspn(b, ".");
+		numeric_a = (strspn(a, "0123456789") >= len_a);
+		numeric_b = (strspn(b, "0123456789") >= len_b);
+
+		if(numeric_a != numeric_b)
+		{
+			return numeric_a ? -1 : 1;
+		}
+
+		/*Numbers without leading zeros, the longer one is bigger*/
+		while(numeric_a && (len_a > 1) && (*a == '0'))
+		{
+			a++;
+			len_a--;
+		}
+
+		while(numeric_b && (len_b > 1) && (*b == '0'))
+		{
+			b++;
+			len_b--;
+		}
+
+		if(numeric_a && (len_a != len_b))
+		{
+			return (len_a > len_b) ? 1 : -1;
+		}
+
+		order = strncmp(a, b, (len_a < len_b) ? len_a : len_b);
+
+		if(order != 0)
+		{
+			return (order > 0) ? 1 : -1;
+		}
+
+		if(len_a != len_b)
+		{
+			return (len_a > len_b) ? 1 : -1;
+		}
+
+		a += len_a;
+		b += len_b;
+		a += (*a == '.');
+		b += (*b == '.');
+	}
+
+	/*More identifiers is newer when the common ones are equal*/
+	return (int32_t)(*a != '\0') - (int32_t)(*b != '\0');
+}
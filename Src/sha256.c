@@ -0,0 +1,168 @@
+/*
+ * File : sha256.c
+ * Author : Prudhvi Raj Belide
+ * Description : This file implements SHA-256 (FIPS 180-4) over data fed in chunks of any size. Full blocks are hashed
+ * straight from the input, only the tail of a chunk is copied into the context.
+ */
+
+#include "sha256.h"
+
+#define ROTR(x, n)		(((x) >> (n)) | ((x) << (32 - (n))))
+#define CH(x, y, z)		(((x) & (y)) ^ (~(x) & (z)))
+#define MAJ(x, y, z)	(((x) & (y)) ^ ((x) & (z)) ^ ((y) & (z)))
+#define SIGMA0(x)		(ROTR(x, 2) ^ ROTR(x, 13) ^ ROTR(x, 22))
+#define SIGMA1(x)		(ROTR(x, 6) ^ ROTR(x, 11) ^ ROTR(x, 25))
+#define GAMMA0(x)		(ROTR(x, 7) ^ ROTR(x, 18) ^ ((x) >> 3))
+#define GAMMA1(x)		(ROTR(x, 17) ^ ROTR(x, 19) ^ ((x) >> 10))
+
+static const uint32_t sha256_k[64] =
+{
+	0x428A2F98U, 0x71374491U, 0xB5C0FBCFU, 0xE9B5DBA5U, 0x3956C25BU, 0x59F111F1U, 0x923F82A4U, 0xAB1C5ED5U,
+	0xD807AA98U, 0x12835B01U, 0x243185BEU, 0x550C7DC3U, 0x72BE5D74U, 0x80DEB1FEU, 0x9BDC06A7U, 0xC19BF174U,
+	0xE49B69C1U, 0xEFBE4786U, 0x0FC19DC6U, 0x240CA1CCU, 0x2DE92C6FU, 0x4A7484AAU, 0x5CB0A9DCU, 0x76F988DAU,
+	0x983E5152U, 0xA831C66DU, 0xB00327C8U, 0xBF597FC7U, 0xC6E00BF3U, 0xD5A79147U, 0x06CA6351U, 0x14292967U,
+	0x27B70A85U, 0x2E1B2138U, 0x4D2C6DFCU, 0x53380D13U, 0x650A7354U, 0x766A0ABBU, 0x81C2C92EU, 0x92722C85U,
+	0xA2BFE8A1U, 0xA81A664BU, 0xC24B8B70U, 0xC76C51A3U, 0xD192E819U, 0xD6990624U, 0xF40E3585U, 0x106AA070U,
+	0x19A4C116U, 0x1E376C08U, 0x2748774CU, 0x34B0BCB5U, 0x391C0CB3U, 0x4ED8AA4AU, 0x5B9CCA4FU, 0x682E6FF3U,
+	0x748F82EEU, 0x78A5636FU, 0x84C87814U, 0x8CC70208U, 0x90BEFFFAU, 0xA4506CEBU, 0xBEF9A3F7U, 0xC67178F2U
+};
+
+static void sha256_block(uint32_t state[8], const uint8_t *block);
+
+
+void sha256_init(sha256_context *ctx)
+{
+	ctx->state[0] = 0x6A09E667U;
+	ctx->state[1] = 0xBB67AE85U;
+	ctx->state[2] = 0x3C6EF372U;
+	ctx->state[3] = 0xA54FF53AU;
+	ctx->state[4] = 0x510E527FU;
+	ctx->state[5] = 0x9B05688CU;
+	ctx->state[6] = 0x1F83D9ABU;
+	ctx->state[7] = 0x5BE0CD19U;
+	ctx->length   = 0;
+	ctx->fill     = 0;
+}
+
+
+void sha256_update(sha256_context *ctx, const uint8_t *data, uint32_t length)
+{
+	ctx->length += length;
+
+	/*Complete the block left over from the last call*/
+	if(ctx->fill != 0)
+	{
+		while((length != 0) && (ctx->fill < SHA256_BLOCK_SZ))
+		{
+			ctx->block[ctx->fill++] = *data++;
+			length--;
+		}
+
+		if(ctx->fill < SHA256_BLOCK_SZ)
+		{
+			return;
+		}
+
+		sha256_block(ctx->state, ctx->block);
+		ctx->fill = 0;
+	}
+
+	while(length >= SHA256_BLOCK_SZ)
+	{
+		sha256_block(ctx->state, data);
+		data   += SHA256_BLOCK_SZ;
+		length -= SHA256_BLOCK_SZ;
+	}
+
+	while(length != 0)
+	{
+		ctx->block[ctx->fill++] = *data++;
+		length--;
+	}
+}
+
+
+void sha256_final(sha256_context *ctx, uint8_t digest[SHA256_DIGEST_SZ])
+{
+	uint32_t bits = ctx->length << 3;
+	uint32_t i;
+
+	/*Padding: 0x80, zeros, then the message length in bits as a 64 bit big endian number*/
+	ctx->block[ctx->fill++] = 0x80;
+
+	if(ctx->fill > (SHA256_BLOCK_SZ - 8))
+	{
+		while(ctx->fill < SHA256_BLOCK_SZ)
+		{
+			ctx->block[ctx->fill++] = 0;
+		}
+
+		sha256_block(ctx->state, ctx->block);
+		ctx->fill = 0;
+	}
+
+	while(ctx->fill < (SHA256_BLOCK_SZ - 4))
+	{
+		ctx->block[ctx->fill++] = 0;
+	}
+
+	ctx->block[60] = (uint8_t)(bits >> 24);
+	ctx->block[61] = (uint8_t)(bits >> 16);
+	ctx->block[62] = (uint8_t)(bits >> 8);
+	ctx->block[63] = (uint8_t)bits;
+	ctx->block[59] = (uint8_t)(ctx->length >> 29);
+
+	sha256_block(ctx->state, ctx->block);
+
+	for(i = 0; i < 8; i++)
+	{
+		digest[i * 4]     = (uint8_t)(ctx->state[i] >> 24);
+		digest[i * 4 + 1] = (uint8_t)(ctx->state[i] >> 16);
+		digest[i * 4 + 2] = (uint8_t)(ctx->state[i] >> 8);
+		digest[i * 4 + 3] = (uint8_t)ctx->state[i];
+	}
+}
+
+
+/*Compress one block. The message schedule is kept as a rolling 16 word window*/
+static void sha256_block(uint32_t state[8], const uint8_t *block)
+{
+	uint32_t w[16];
+	uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+	uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+	uint32_t t1, t2;
+	uint32_t i;
+
+	for(i = 0; i < 64; i++)
+	{
+		if(i < 16)
+		{
+			w[i] = ((uint32_t)block[i * 4] << 24) | ((uint32_t)block[i * 4 + 1] << 16) |
+				   ((uint32_t)block[i * 4 + 2] << 8) | block[i * 4 + 3];
+		}
+		else
+		{
+			w[i & 15] += GAMMA1(w[(i - 2) & 15]) + w[(i - 7) & 15] + GAMMA0(w[(i - 15) & 15]);
+		}
+
+		t1 = h + SIGMA1(e) + CH(e, f, g) + sha256_k[i] + w[i & 15];
+		t2 = SIGMA0(a) + MAJ(a, b, c);
+		h = g;
+		g = f;
+		f = e;
+		e = d + t1;
+		d = c;
+		c = b;
+		b = a;
+		a = t1 + t2;
+	}
+
+	state[0] += a;
+	state[1] += b;
+	state[2] += c;
+	state[3] += d;
+	state[4] += e;
+	state[5] += f;
+	state[6] += g;
+	state[7] += h;
+}
@@ -7,6 +7,7 @@
 
 #include "timebase.h"
 #include "stm32f4xx.h"
+#include "ram_exec.h"
 
 #define CTRL_ENABLE		(1U<<0)
 #define CTRL_TICKINT	(1U<<1)
@@ -38,7 +39,7 @@ void systick_delay_ms(uint32_t delay)
 
 }
 
-uint32_t get_tick(void)
+RAM_FUNC uint32_t get_tick(void)
 {
 	__disable_irq();
 	g_curr_tick_p = g_curr_tick;
@@ -47,7 +48,7 @@ uint32_t get_tick(void)
 	return g_curr_tick_p;
 
 }
-static void tick_increment(void)
+RAM_FUNC static void tick_increment(void)
 {
 	g_curr_tick += TICK_FREQ;
 }
@@ -76,7 +77,7 @@ void timebase_init(void)
 	__enable_irq();
 }
 
-void SysTick_Handler(void)
+RAM_FUNC void SysTick_Handler(void)
 {
 	tick_increment();
 }
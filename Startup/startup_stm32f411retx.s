@@ -61,7 +61,7 @@ Reset_Handler:
 /* Call the clock system intitialization function.*/
   bl  SystemInit
 
-/* Copy the data segment initializers from flash to SRAM */
+/* Copy the data segment initializers and the .RamFunc code from flash to SRAM */
   ldr r0, =_sdata
   ldr r1, =_edata
   ldr r2, =_sidata
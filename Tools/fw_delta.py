@@ -0,0 +1,157 @@
+#!/usr/bin/env python3
+"""
+File : fw_delta.py
+Author : Prudhvi Raj Belide
+Description : Builds a delta patch that turns the image installed on a device into a new one, in the format
+Src/delta_patch.c applies: the "DLT1" magic, the SHA-256 of the base payload (from its image header), the size of
+the new image, then a list of operations:
+    0 COPY   offset, length              bytes of the base image
+    1 ADD    offset, length, bytes       base bytes plus the patch bytes, for code whose addresses moved
+    2 INSERT length, bytes               new bytes
+Arguments are little endian 32 bit words, offsets count from the start of the base image header. The patch can be
+LZSS compressed on top, the ADD bytes are mostly zeros and compress well.
+
+Usage : fw_delta.py old_a.bin new_b.bin patch.dlt [--lzss]
+"""
+
+import argparse
+import struct
+import sys
+
+import lzss
+
+DELTA_MAGIC = 0x31544C44
+OP_COPY, OP_ADD, OP_INSERT = 0, 1, 2
+
+BLOCK = 16              # bytes hashed to find a match
+MIN_COPY = 24           # shorter matches go into the surrounding ADD or INSERT
+MAX_CANDIDATES = 32
+
+# image_header offsets, see Inc/image_header.h
+HEADER_SHA256 = 24
+
+
+def index_blocks(data):
+    index = {}
+    for pos in range(0, len(data) - BLOCK + 1):
+        index.setdefault(data[pos:pos + BLOCK], []).append(pos)
+    return index
+
+
+def find_match(old, new, pos, index, expected):
+    """Longest exact match of new[pos:] in old, the position that continues the last match wins ties."""
+    best_offset, best_length = 0, 0
+    candidates = index.get(new[pos:pos + BLOCK], [])
+    if expected in candidates:
+        candidates = [expected] + candidates[:MAX_CANDIDATES]
+    for offset in candidates[:MAX_CANDIDATES + 1]:
+        length = BLOCK
+        while pos + length < len(new) and offset + length < len(old) and old[offset + length] == new[pos + length]:
+            length += 1
+        if length > best_length:
+            best_offset, best_length = offset, length
+    return best_offset, best_length
+
+
+def gap_ops(old, new, start, end, old_cursor):
+    """Bytes between two matches: ADD against the base if it lines up closely enough, INSERT otherwise."""
+    length = end - start
+    if length == 0:
+        return []
+    if old_cursor + length <= len(old):
+        diff = bytes((new[start + i] - old[old_cursor + i]) & 0xFF for i in range(length))
+        if diff.count(0) * 2 >= length:
+            return [(OP_ADD, old_cursor, diff)]
+    return [(OP_INSERT, new[start:end])]
+
+
+def diff(old, new):
+    index = index_blocks(old)
+    ops = []
+    pos = gap_start = 0
+    old_cursor = 0          # base position lined up with gap_start
+
+    while pos + BLOCK <= len(new):
+        offset, length = find_match(old, new, pos, index, old_cursor + (pos - gap_start))
+        if length < MIN_COPY:
+            pos += 1
+            continue
+        ops += gap_ops(old, new, gap_start, pos, old_cursor)
+        ops.append((OP_COPY, offset, length))
+        pos += length
+        gap_start, old_cursor = pos, offset + length
+
+    ops += gap_ops(old, new, gap_start, len(new), old_cursor)
+    return ops
+
+
+def encode(ops, base_hash, target_size):
+    out = bytearray(struct.pack("<I", DELTA_MAGIC) + base_hash + struct.pack("<I", target_size))
+    for op in ops:
+        if op[0] == OP_COPY:
+            out += struct.pack("<BII", OP_COPY, op[1], op[2])
+        elif op[0] == OP_ADD:
+            out += struct.pack("<BII", OP_ADD, op[1], len(op[2])) + op[2]
+        else:
+            out += struct.pack("<BI", OP_INSERT, len(op[1])) + op[1]
+    return bytes(out)
+
+
+def apply(old, patch):
+    """Reference patcher, used to check the output."""
+    pos = 4 + 32 + 4
+    target_size, = struct.unpack_from("<I", patch, 36)
+    out = bytearray()
+    while pos < len(patch):
+        op = patch[pos]
+        if op == OP_INSERT:
+            length, = struct.unpack_from("<I", patch, pos + 1)
+            out += patch[pos + 5:pos + 5 + length]
+            pos += 5 + length
+        else:
+            offset, length = struct.unpack_from("<II", patch, pos + 1)
+            pos += 9
+            if op == OP_COPY:
+                out += old[offset:offset + length]
+            else:
+                out += bytes((old[offset + i] + patch[pos + i]) & 0xFF for i in range(length))
+                pos += length
+    if len(out) != target_size:
+        raise ValueError("patch builds %d bytes, announces %d" % (len(out), target_size))
+    return bytes(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build a delta patch between two headered images")
+    parser.add_argument("old", help="image installed on the device")
+    parser.add_argument("new", help="image to install")
+    parser.add_argument("output", help="patch to write")
+    parser.add_argument("--lzss", action="store_true", help="LZSS compress the patch")
+    args = parser.parse_args()
+
+    with open(args.old, "rb") as f:
+        old = f.read()
+    with open(args.new, "rb") as f:
+        new = f.read()
+
+    ops = diff(old, new)
+    patch = encode(ops, old[HEADER_SHA256:HEADER_SHA256 + 32], len(new))
+
+    if apply(old, patch) != new:
+        sys.exit("round trip failed")
+
+    sent = lzss.compress(patch) if args.lzss else patch
+
+    with open(args.output, "wb") as f:
+        f.write(sent)
+
+    copied = sum(op[2] for op in ops if op[0] == OP_COPY)
+    full = len(lzss.compress(new))
+    print("%s: %d byte image, %d bytes copied from the base, patch %d bytes (%s)" %
+          (args.output, len(new), copied, len(sent), "compressed" if args.lzss else "raw"))
+    print("transfer: %.1f%% of the full image, %.1f%% of the compressed full image" %
+          (100.0 * len(sent) / len(new), 100.0 * len(sent) / full))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,59 @@
+#!/usr/bin/env python3
+"""
+File : fw_keygen.py
+Author : Prudhvi Raj Belide
+Description : Creates an image signing key. The private scalar goes to the key file used by fw_pack.py, the public
+key is written as Inc/image_key.h for the bootloader build.
+
+Usage : fw_keygen.py signing_key.txt --header ../Inc/image_key.h
+"""
+
+import argparse
+import os
+import sys
+
+import p256
+
+HEADER = """/*
+ * File : image_key.h
+ * Author : Prudhvi Raj Belide
+ * Description : Public key the bootloader checks image signatures against. Generated by Tools/fw_keygen.py, keep the
+ * matching private key out of the firmware.
+ */
+
+#ifndef __IMAGE_KEY_H
+#define __IMAGE_KEY_H
+
+/*P-256 public key, X then Y, big endian*/
+#define IMAGE_PUBLIC_KEY \\
+{ \\
+%s \\
+}
+
+#endif
+"""
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Create an image signing key")
+    parser.add_argument("key", help="private key file to create")
+    parser.add_argument("--header", required=True, help="C header to write the public key to")
+    args = parser.parse_args()
+
+    if os.path.exists(args.key):
+        sys.exit("%s exists, refusing to overwrite a signing key" % args.key)
+
+    d, public = p256.generate_key()
+
+    with open(args.key, "w") as f:
+        f.write("%064x\n" % d)
+
+    rows = ["\t" + ", ".join("0x%02X" % byte for byte in public[i:i + 16]) for i in range(0, 64, 16)]
+    with open(args.header, "w", newline="\r\n") as f:
+        f.write(HEADER % ", \\\n".join(rows))
+
+    print("%s: new key, public key in %s" % (args.key, args.header))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,98 @@
+#!/usr/bin/env python3
+"""
+File : fw_manifest.py
+Author : Prudhvi Raj Belide
+Description : Writes the chunk manifest of an image for the chunked update mode. The image is cut at the same gear
+rolling hash boundaries Src/chunk_index.c uses, the manifest lists {length, first 8 bytes of SHA-256} per chunk
+after a header of {"CDC1", image size, chunk count}, all words little endian. Serve it next to the image under the
+manifest name of the slot; the server has to answer HTTP Range requests on the image.
+
+Usage : fw_manifest.py firmware_update_b.bin firmware_update_b.cdc [--base installed_a.bin]
+"""
+
+import argparse
+import hashlib
+import struct
+import sys
+
+MIN_SZ = 1024
+MAX_SZ = 8192
+MASK = 0x7FF
+GEAR_SEED = 0x2545F491
+MAX_NUM = 256
+HASH_SZ = 8
+MANIFEST_MAGIC = 0x31434443
+
+
+def gear_table():
+    x = GEAR_SEED
+    table = []
+    for _ in range(256):
+        x ^= (x << 13) & 0xFFFFFFFF
+        x ^= x >> 17
+        x ^= (x << 5) & 0xFFFFFFFF
+        table.append(x)
+    return table
+
+
+GEAR = gear_table()
+
+
+def chunk_length(data, offset):
+    length = len(data) - offset
+    if length <= MIN_SZ:
+        return length
+    length = min(length, MAX_SZ)
+    h = 0
+    for i in range(MIN_SZ - 32, length):
+        h = ((h << 1) + GEAR[data[offset + i]]) & 0xFFFFFFFF
+        if i >= MIN_SZ - 1 and (h & MASK) == 0:
+            return i + 1
+    return length
+
+
+def chunks(data):
+    """List of (offset, length, hash)."""
+    result = []
+    offset = 0
+    while offset < len(data):
+        length = chunk_length(data, offset)
+        result.append((offset, length, hashlib.sha256(data[offset:offset + length]).digest()[:HASH_SZ]))
+        offset += length
+    return result
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Write the chunk manifest of an image")
+    parser.add_argument("image", help="headered image from fw_pack.py")
+    parser.add_argument("output", help="manifest to write")
+    parser.add_argument("--base", help="image installed on a device, to report what it would fetch")
+    args = parser.parse_args()
+
+    with open(args.image, "rb") as f:
+        image = f.read()
+
+    table = chunks(image)
+    if len(table) > MAX_NUM:
+        sys.exit("%d chunks, the device takes %d" % (len(table), MAX_NUM))
+
+    manifest = struct.pack("<III", MANIFEST_MAGIC, len(image), len(table))
+    for _, length, digest in table:
+        manifest += struct.pack("<I", length) + digest
+
+    with open(args.output, "wb") as f:
+        f.write(manifest)
+
+    print("%s: %d chunks, %d byte manifest for a %d byte image" % (args.output, len(table), len(manifest), len(image)))
+
+    if args.base:
+        with open(args.base, "rb") as f:
+            base = f.read()
+        have = {(length, digest) for _, length, digest in chunks(base)}
+        missing = [length for _, length, digest in table if (length, digest) not in have]
+        print("device with %s fetches %d of %d chunks, %d bytes plus the manifest (%.1f%% of the image)" %
+              (args.base, len(missing), len(table), sum(missing), 100.0 * (sum(missing) + len(manifest)) / len(image)))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""
+File : fw_pack.py
+Author : Prudhvi Raj Belide
+Description : Builds a signed firmware image from the application ELF. The loadable segments are flattened into
+a binary, padded to a word, and prefixed with the image_header of Inc/image_header.h.
+
+Usage : fw_pack.py app.elf --slot a --version 1.2.3 --key dev_signing_key.txt -o firmware_update_a.bin
+"""
+
+import argparse
+import hashlib
+import struct
+import sys
+
+import p256
+
+IMAGE_MAGIC = 0x4D495746
+IMAGE_HEADER_VERSION = 2
+IMAGE_HEADER_SZ = 0x200
+
+# Slots of Inc/boot_control.h: (address, size)
+SLOTS = {
+    "a": (0x08010000, 0x30000),
+    "b": (0x08040000, 0x40000),
+}
+
+# The update goes to the other slot each time, so an image has to fit the smaller one
+IMAGE_MAX_SIZE = min(size for _, size in SLOTS.values()) - IMAGE_HEADER_SZ
+
+PT_LOAD = 1
+
+
+def crc32_words(crc, data):
+    """CRC-32 of the STM32 CRC unit: poly 0x04C11DB7, little endian words fed MSB first."""
+    for (word,) in struct.iter_unpack("<I", data):
+        crc ^= word
+        for _ in range(32):
+            crc = ((crc << 1) ^ 0x04C11DB7) if (crc & 0x80000000) else (crc << 1)
+            crc &= 0xFFFFFFFF
+    return crc
+
+
+def load_elf(path):
+    """Return (address, bytes) of the loadable segments, placed at their load (physical) address."""
+    with open(path, "rb") as f:
+        elf = f.read()
+
+    if elf[:4] != b"\x7fELF" or elf[4] != 1 or elf[5] != 1:
+        sys.exit("%s: not a 32 bit little endian ELF" % path)
+
+    phoff, = struct.unpack_from("<I", elf, 28)
+    phentsize, phnum = struct.unpack_from("<HH", elf, 42)
+
+    segments = []
+    for i in range(phnum):
+        p_type, p_offset, _, p_paddr, p_filesz = struct.unpack_from("<IIIII", elf, phoff + i * phentsize)
+        if p_type == PT_LOAD and p_filesz != 0:
+            segments.append((p_paddr, elf[p_offset:p_offset + p_filesz]))
+
+    if not segments:
+        sys.exit("%s: no loadable segments" % path)
+
+    start = min(address for address, _ in segments)
+    end = max(address + len(data) for address, data in segments)
+    image = bytearray(b"\xff" * (end - start))
+
+    for address, data in segments:
+        image[address - start:address - start + len(data)] = data
+
+    return start, bytes(image)
+
+
+def parse_version(text):
+    parts = text.split(".")
+    if len(parts) != 3 or not all(part.isdigit() for part in parts):
+        sys.exit("version must be MAJOR.MINOR.PATCH")
+    major, minor, patch = (int(part) for part in parts)
+    if major > 0xFF or minor > 0xFF or patch > 0xFFFF:
+        sys.exit("version out of range")
+    return major, minor, patch
+
+
+def pack(load_address, payload, version, key):
+    payload += b"\xff" * (-len(payload) % 4)
+
+    header = struct.pack("<IHHIBBHII32s", IMAGE_MAGIC, IMAGE_HEADER_VERSION, IMAGE_HEADER_SZ, len(payload),
+                         version[0], version[1], version[2], load_address, crc32_words(0xFFFFFFFF, payload),
+                         hashlib.sha256(payload).digest())
+    header += p256.sign(key, header)
+    header += struct.pack("<I", crc32_words(0xFFFFFFFF, header))
+
+    return header + b"\xff" * (IMAGE_HEADER_SZ - len(header)) + payload
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Build a headered firmware image from the application ELF")
+    parser.add_argument("elf", help="application ELF, linked for the slot address + 0x%X" % IMAGE_HEADER_SZ)
+    parser.add_argument("--slot", choices=sorted(SLOTS), required=True, help="slot the image is linked for")
+    parser.add_argument("--version", required=True, help="MAJOR.MINOR.PATCH")
+    parser.add_argument("--key", required=True, help="private key file from fw_keygen.py")
+    parser.add_argument("-o", "--output", required=True, help="headered .bin to write")
+    args = parser.parse_args()
+
+    slot_address, _ = SLOTS[args.slot]
+    load_address, payload = load_elf(args.elf)
+
+    if load_address != slot_address + IMAGE_HEADER_SZ:
+        sys.exit("image starts at 0x%08X, slot %s expects 0x%08X" %
+                 (load_address, args.slot, slot_address + IMAGE_HEADER_SZ))
+
+    image = pack(load_address, payload, parse_version(args.version), p256.load_key(args.key))
+
+    if len(image) - IMAGE_HEADER_SZ > IMAGE_MAX_SIZE:
+        sys.exit("payload is %d bytes, at most %d fit either slot" % (len(image) - IMAGE_HEADER_SZ, IMAGE_MAX_SIZE))
+
+    with open(args.output, "wb") as f:
+        f.write(image)
+
+    print("%s: %d byte payload at 0x%08X, version %s" % (args.output, len(image) - IMAGE_HEADER_SZ, load_address,
+                                                         args.version))
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,75 @@
+#!/usr/bin/env python3
+"""
+File : samples.py
+Author : Prudhvi Raj Belide
+Description : Writes the input files of the host tests that check the device against the tools in Tools/.
+    window   a random 4KB block repeated, LZSS matches reach back the whole window and the window wraps
+    image_a  a headered image packed from the bootloader build in Debug/, the way fw_pack.py packs an application
+    image_b  the next version of image_a: new code inserted, the addresses behind it moved, a few bytes changed
+
+Usage : samples.py window test_window.bin
+"""
+
+import argparse
+import os
+import random
+import struct
+import sys
+
+TOOLS = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..")
+sys.path.insert(0, TOOLS)
+
+import fw_pack  # noqa: E402
+
+ELF = os.path.join(TOOLS, "..", "Debug", "esp82xx_fota_esd.elf")
+KEY = os.path.join(TOOLS, "dev_signing_key.txt")
+
+
+def window():
+    rng = random.Random(1)
+    block = bytes(rng.getrandbits(8) for _ in range(4096))
+    return b"LZSS window sample " * 64 + block * 3 + bytes(300) + block[:1000]
+
+
+def image_a():
+    load_address, payload = fw_pack.load_elf(ELF)
+    return fw_pack.pack(load_address, payload, (1, 0, 0), fw_pack.p256.load_key(KEY))
+
+
+def image_b():
+    rng = random.Random(2)
+    load_address, payload = fw_pack.load_elf(ELF)
+    inserted = len(payload) // 3 & ~3
+    moved = bytearray(payload[:inserted] + bytes(rng.getrandbits(8) for _ in range(96)) + payload[inserted:])
+
+    # Literal pools and vectors pointing behind the new code now point 96 bytes further, fw_delta.py sends them as ADD
+    for pos in range(0, len(moved) - 3, 4):
+        word, = struct.unpack_from("<I", moved, pos)
+        if load_address + inserted <= word < load_address + len(payload):
+            struct.pack_into("<I", moved, pos, word + 96)
+
+    for pos in rng.sample(range(len(moved)), 8):
+        moved[pos] ^= 0x5A
+
+    return fw_pack.pack(load_address, bytes(moved), (1, 0, 1), fw_pack.p256.load_key(KEY))
+
+
+SAMPLES = {
+    "window": window,
+    "image_a": image_a,
+    "image_b": image_b,
+}
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Write an input file of the host tests")
+    parser.add_argument("sample", choices=sorted(SAMPLES))
+    parser.add_argument("output")
+    args = parser.parse_args()
+
+    with open(args.output, "wb") as f:
+        f.write(SAMPLES[args.sample]())
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,315 @@
+/*
+ * File : test_chunk_index.c
+ * Author : Prudhvi Raj Belide
+ * Description : Host test of chunk_index.c against Tools/fw_manifest.py. A fixed image generated here must be cut at
+ * the boundaries and hashes of chunk_manifest.cdc, the manifest fw_manifest.py wrote for it. The manifest is then fed
+ * in random spans and split at every position against the same image, an image with bytes inserted and a target
+ * with one byte changed, and checked for the chunks found and kept in place. Ends with the chunking speed.
+ *
+ * To rebuild the manifest after a change of the chunking: ./test_chunk_index image.bin writes the image, then
+ * fw_manifest.py image.bin chunk_manifest.cdc
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "chunk_index.h"
+
+#define IMAGE_SZ		150000U
+#define INSERT_AT		(IMAGE_SZ / 2)
+#define INSERT_SZ		100U
+#define CHANGE_AT		(IMAGE_SZ / 3)
+#define MANIFEST_MAX_SZ	(CHUNK_RECORD_SZ * (CHUNK_MAX_NUM + 1))
+
+static chunk_index index_image, index_inserted;
+static chunk_manifest manifest;
+static uint8_t image[IMAGE_SZ], inserted[IMAGE_SZ + INSERT_SZ], changed[IMAGE_SZ];
+static uint8_t manifest_data[MANIFEST_MAX_SZ];
+static uint32_t manifest_len;
+static uint32_t failures;
+
+
+static uint32_t word(const uint8_t *bytes)
+{
+	return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+
+/*xorshift32 noise with a stretch of repeated words in the middle, like the zero filled tables of an image*/
+static void make_images(void)
+{
+	uint32_t x = 1;
+	uint32_t i;
+
+	for(i = 0; i < IMAGE_SZ; i++)
+	{
+		x ^= x << 13;
+		x ^= x >> 17;
+		x ^= x << 5;
+		image[i] = ((i >= 90000) && (i < 96000)) ? (uint8_t)(i & 0x0C) : (uint8_t)x;
+	}
+
+	memcpy(inserted, image, INSERT_AT);
+	memset(&inserted[INSERT_AT], 0xA5, INSERT_SZ);
+	memcpy(&inserted[INSERT_AT + INSERT_SZ], &image[INSERT_AT], IMAGE_SZ - INSERT_AT);
+
+	memcpy(changed, image, IMAGE_SZ);
+	changed[CHANGE_AT] ^= 0x01;
+}
+
+
+static void load_manifest(void)
+{
+	FILE *f = fopen("chunk_manifest.cdc", "rb");
+
+	if(f == 0)
+	{
+		printf("FAIL: can not open chunk_manifest.cdc\n");
+		failures++;
+		return;
+	}
+
+	manifest_len = (uint32_t)fread(manifest_data, 1, MANIFEST_MAX_SZ, f);
+	fclose(f);
+}
+
+
+static void test_boundaries(void)
+{
+	const uint8_t *record = &manifest_data[CHUNK_RECORD_SZ];
+	uint32_t errors = failures;
+	uint32_t i, length;
+
+	if(chunk_index_build(&index_image, image, IMAGE_SZ) != DEV_OK)
+	{
+		printf("FAIL: chunking the image\n");
+		failures++;
+		return;
+	}
+
+	if((word(manifest_data) != CHUNK_MANIFEST_MAGIC) || (word(&manifest_data[4]) != IMAGE_SZ) ||
+	   (word(&manifest_data[8]) != index_image.count) || (manifest_len != (CHUNK_RECORD_SZ * (index_image.count + 1))))
+	{
+		printf("FAIL: %u chunks, the manifest has %u for %u bytes\n", index_image.count, word(&manifest_data[8]),
+				word(&manifest_data[4]));
+		failures++;
+		return;
+	}
+
+	for(i = 0; i < index_image.count; i++, record += CHUNK_RECORD_SZ)
+	{
+		length = index_image.chunk[i + 1].offset - index_image.chunk[i].offset;
+
+		if((length != word(record)) || (memcmp(index_image.chunk[i].hash, record + 4, CHUNK_HASH_SZ) != 0))
+		{
+			printf("FAIL: chunk %u at %u: %u bytes, the manifest has %u or another hash\n", i,
+					index_image.chunk[i].offset, length, word(record));
+			failures++;
+		}
+	}
+
+	printf("boundaries of %u chunks: %s\n", index_image.count, (failures == errors) ? "ok" : "FAILED");
+}
+
+
+/*Feed in spans of 1 to max_span bytes, max_span 0 cuts once at split*/
+static StatusTypeDef feed(const chunk_index *index, const uint8_t *target, uint32_t max_span, uint32_t split)
+{
+	const uint8_t *data = manifest_data;
+	uint32_t length = manifest_len;
+	uint32_t span;
+
+	chunk_manifest_init(&manifest, index, target, IMAGE_SZ);
+
+	while(length != 0)
+	{
+		span = (max_span == 0) ? split : 1 + (uint32_t)rand() % max_span;
+		span = (span > length) ? length : span;
+		chunk_manifest_feed(&manifest, data, span);
+		data += span;
+		length -= span;
+		split = length;
+	}
+
+	return chunk_manifest_finish(&manifest);
+}
+
+
+/*Chunks found in the index match, the target holds every chunk in place but the one at skip*/
+static int planned(const chunk_index *index, const uint8_t *target, uint32_t skip)
+{
+	uint32_t i, offset = 0, in_place = 0;
+	uint8_t keep;
+
+	if((manifest.image_size != IMAGE_SZ) || (manifest.count != index_image.count))
+	{
+		return 0;
+	}
+
+	for(i = 0; i < manifest.count; i++)
+	{
+		if((manifest.plan[i].local != CHUNK_MISSING) &&
+		   (memcmp(index->chunk[manifest.plan[i].local].hash, index_image.chunk[i].hash, CHUNK_HASH_SZ) != 0))
+		{
+			return 0;
+		}
+
+		keep = (target != 0) && ((skip < offset) || (skip >= (offset + manifest.plan[i].length)));
+
+		if(manifest.plan[i].in_place != keep)
+		{
+			return 0;
+		}
+
+		in_place += keep ? manifest.plan[i].length : 0;
+		offset += manifest.plan[i].length;
+	}
+
+	return manifest.in_place == in_place;
+}
+
+
+static void test_manifest(const char *name, const chunk_index *index, const uint8_t *target, uint32_t present,
+		uint32_t skip)
+{
+	uint32_t errors = failures;
+	uint32_t split;
+
+	if((feed(index, target, 0, manifest_len) != DEV_OK) || !planned(index, target, skip) ||
+	   (manifest.present < present))
+	{
+		printf("FAIL: %s: one call, %u bytes found, %u in place\n", name, manifest.present, manifest.in_place);
+		failures++;
+	}
+
+	present = manifest.present;
+
+	if((feed(index, target, 7, 0) != DEV_OK) || !planned(index, target, skip) || (manifest.present != present) ||
+	   (feed(index, target, 1460, 0) != DEV_OK) || !planned(index, target, skip) || (manifest.present != present))
+	{
+		printf("FAIL: %s: random spans\n", name);
+		failures++;
+	}
+
+	/*Cuts inside the header, the length word and the hash of a record*/
+	for(split = 1; split < manifest_len; split++)
+	{
+		if((feed(index, target, 0, split) != DEV_OK) || !planned(index, target, skip) || (manifest.present != present))
+		{
+			printf("FAIL: %s: split at %u\n", name, split);
+			failures++;
+			break;
+		}
+	}
+
+	printf("%s: %u of %u bytes found, %u in place: %s\n", name, present, IMAGE_SZ, manifest.in_place,
+			(failures == errors) ? "ok" : "FAILED");
+}
+
+
+static void test_malformed(void)
+{
+	uint32_t errors = failures;
+	uint8_t saved;
+
+	/*A record missing at the end*/
+	chunk_manifest_init(&manifest, &index_image, 0, 0);
+	chunk_manifest_feed(&manifest, manifest_data, manifest_len - CHUNK_RECORD_SZ);
+
+	if(chunk_manifest_finish(&manifest) == DEV_OK)
+	{
+		printf("FAIL: manifest without its last record accepted\n");
+		failures++;
+	}
+
+	/*Chunk lengths that do not add up to the image size*/
+	saved = manifest_data[CHUNK_RECORD_SZ];
+	manifest_data[CHUNK_RECORD_SZ]++;
+
+	if(feed(&index_image, 0, 0, manifest_len) == DEV_OK)
+	{
+		printf("FAIL: manifest with a chunk one byte longer accepted\n");
+		failures++;
+	}
+
+	manifest_data[CHUNK_RECORD_SZ] = saved;
+
+	saved = manifest_data[0];
+	manifest_data[0] ^= 0x01;
+
+	if(feed(&index_image, 0, 0, manifest_len) == DEV_OK)
+	{
+		printf("FAIL: manifest with another magic accepted\n");
+		failures++;
+	}
+
+	manifest_data[0] = saved;
+
+	printf("malformed manifests: %s\n", (failures == errors) ? "ok" : "FAILED");
+}
+
+
+static void benchmark(void)
+{
+	struct timespec start, end;
+	double seconds;
+	uint32_t i;
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for(i = 0; i < 20; i++)
+	{
+		chunk_index_build(&index_inserted, inserted, sizeof(inserted));
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	seconds = (end.tv_sec - start.tv_sec) + ((end.tv_nsec - start.tv_nsec) / 1e9);
+	printf("chunk and hash: %.0f MB/s\n", (20.0 * sizeof(inserted)) / seconds / 1e6);
+}
+
+
+int main(int argc, char **argv)
+{
+	FILE *f;
+
+	make_images();
+
+	if(argc == 2)
+	{
+		f = fopen(argv[1], "wb");
+
+		if((f == 0) || (fwrite(image, 1, IMAGE_SZ, f) != IMAGE_SZ))
+		{
+			printf("FAIL: can not write %s\n", argv[1]);
+			return 1;
+		}
+
+		fclose(f);
+		return 0;
+	}
+
+	srand(1);
+	load_manifest();
+	test_boundaries();
+
+	if(failures)
+	{
+		return 1;
+	}
+
+	if(chunk_index_build(&index_inserted, inserted, sizeof(inserted)) != DEV_OK)
+	{
+		printf("FAIL: chunking the image with bytes inserted\n");
+		return 1;
+	}
+
+	test_manifest("same image", &index_image, image, IMAGE_SZ, IMAGE_SZ);
+	/*Only the chunks next to the insertion move, at most one on each side and the one it lands in*/
+	test_manifest("bytes inserted", &index_inserted, 0, IMAGE_SZ - 3 * CHUNK_MAX_SZ, IMAGE_SZ);
+	test_manifest("one byte changed", &index_image, changed, IMAGE_SZ, CHANGE_AT);
+	test_malformed();
+	benchmark();
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,293 @@
+/*
+ * File : test_delta_patch.c
+ * Author : Prudhvi Raj Belide
+ * Description : Host test of delta_patch.c against patches built by Tools/fw_delta.py between two packed images. The
+ * raw patch and the LZSS compressed one must rebuild the new image in one call, in random spans and split in two at
+ * every position. Patches with a wrong base hash, offsets outside the base, operations running past the announced
+ * size, an unknown operation or a missing end must be rejected however they are cut.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "delta_patch.h"
+#include "image_header.h"
+#include "lzss.h"
+
+#define FILE_MAX_SZ		(64U * 1024U)
+
+/*Magic, base hash, target size*/
+#define PATCH_OPS		(4 + DELTA_HEADER_SZ)
+
+static delta_patcher patcher;
+static lzss_decoder decoder;
+static uint8_t base[FILE_MAX_SZ], target[FILE_MAX_SZ], patch[FILE_MAX_SZ], packed[FILE_MAX_SZ];
+static uint8_t corrupt[FILE_MAX_SZ], out[FILE_MAX_SZ];
+static uint32_t base_len, target_len, patch_len, packed_len, out_len;
+static uint8_t overflow;
+static uint32_t failures;
+
+
+static uint32_t load(const char *path, uint8_t *data)
+{
+	FILE *f = fopen(path, "rb");
+	uint32_t length;
+
+	if(f == 0)
+	{
+		printf("FAIL: can not open %s\n", path);
+		failures++;
+		return 0;
+	}
+
+	length = (uint32_t)fread(data, 1, FILE_MAX_SZ, f);
+	fclose(f);
+
+	return length;
+}
+
+
+static uint32_t word(const uint8_t *bytes)
+{
+	return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+}
+
+
+static void set_word(uint8_t *bytes, uint32_t value)
+{
+	bytes[0] = (uint8_t)value;
+	bytes[1] = (uint8_t)(value >> 8);
+	bytes[2] = (uint8_t)(value >> 16);
+	bytes[3] = (uint8_t)(value >> 24);
+}
+
+
+static void collect(void *ctx, const uint8_t *data, uint32_t length)
+{
+	if((out_len + length) > FILE_MAX_SZ)
+	{
+		overflow = 1;
+		return;
+	}
+
+	memcpy(&out[out_len], data, length);
+	out_len += length;
+}
+
+
+/*The LZSS decoder hands the patch on like firmware_stream() does, without the magic word firmware_probe() takes*/
+static void unpack(void *ctx, const uint8_t *data, uint32_t length)
+{
+	uint32_t *magic_fill = ctx;
+	uint32_t skip = 4 - *magic_fill;
+
+	skip = (skip > length) ? length : skip;
+	*magic_fill += skip;
+
+	if(length != skip)
+	{
+		delta_feed(&patcher, data + skip, length - skip);
+	}
+}
+
+
+/*Feed in spans of 1 to max_span bytes, max_span 0 cuts once at split. Compressed input goes through the decoder*/
+static StatusTypeDef apply(const uint8_t *data, uint32_t length, uint8_t compressed, uint32_t max_span, uint32_t split)
+{
+	const image_header *header = (const image_header *)base;
+	uint32_t magic_fill = 0;
+	uint32_t span;
+
+	out_len = 0;
+	overflow = 0;
+	delta_init(&patcher, base, base_len, header->sha256, collect, 0);
+	lzss_init(&decoder, unpack, &magic_fill);
+
+	/*The magic word is taken off by firmware_probe() before the body reaches either*/
+	data += 4;
+	length -= 4;
+
+	while(length != 0)
+	{
+		span = (max_span == 0) ? split : 1 + (uint32_t)rand() % max_span;
+		span = (span > length) ? length : span;
+
+		if(compressed)
+		{
+			lzss_feed(&decoder, data, span);
+		}
+		else
+		{
+			delta_feed(&patcher, data, span);
+		}
+
+		data += span;
+		length -= span;
+		split = length;
+	}
+
+	return delta_finish(&patcher);
+}
+
+
+static int rebuilt(StatusTypeDef status)
+{
+	return (status == DEV_OK) && !overflow && (out_len == target_len) && (memcmp(out, target, target_len) == 0) &&
+		   (patcher.copied != 0) && (patcher.copied < target_len);
+}
+
+
+static void test_apply(const char *name, const uint8_t *data, uint32_t length, uint8_t compressed)
+{
+	uint32_t errors = failures;
+	uint32_t split;
+
+	if(!rebuilt(apply(data, length, compressed, 0, length)))
+	{
+		printf("FAIL: %s: one call, %u of %u bytes\n", name, out_len, target_len);
+		failures++;
+	}
+
+	if(!rebuilt(apply(data, length, compressed, 7, 0)) || !rebuilt(apply(data, length, compressed, 1460, 0)))
+	{
+		printf("FAIL: %s: random spans\n", name);
+		failures++;
+	}
+
+	/*Cuts inside the header, between an operation and its arguments, inside the arguments and the bytes*/
+	for(split = 1; split < (length - 4); split++)
+	{
+		if(!rebuilt(apply(data, length, compressed, 0, split)))
+		{
+			printf("FAIL: %s: split at %u\n", name, split);
+			failures++;
+			break;
+		}
+	}
+
+	printf("%s: %u bytes, %u of %u copied from the base: %s\n", name, length, patcher.copied, target_len,
+			(failures == errors) ? "ok" : "FAILED");
+}
+
+
+/*Offset of the first operation of this type in the raw patch*/
+static uint32_t find_op(uint8_t op)
+{
+	uint32_t pos = PATCH_OPS;
+
+	while(pos < patch_len)
+	{
+		if(patch[pos] == op)
+		{
+			return pos;
+		}
+
+		if(patch[pos] == DELTA_OP_INSERT)
+		{
+			pos += 5 + word(&patch[pos + 1]);
+		}
+		else
+		{
+			pos += 9 + ((patch[pos] == DELTA_OP_ADD) ? word(&patch[pos + 5]) : 0);
+		}
+	}
+
+	printf("FAIL: the patch has no operation %u\n", op);
+	failures++;
+
+	return PATCH_OPS;
+}
+
+
+/*A corrupt patch must fail and never build more than it announced, one byte at a time and at every cut*/
+static void expect_rejected(const char *change, uint32_t length)
+{
+	uint32_t announced = word(&corrupt[4 + DELTA_BASE_HASH_SZ]);
+	uint32_t split;
+
+	for(split = 0; split < length; split++)
+	{
+		if((apply(corrupt, length, 0, (split == 0) ? 1 : 0, split) == DEV_OK) || overflow || (out_len > announced))
+		{
+			printf("FAIL: %s: accepted when cut at %u, %u bytes built\n", change, split, out_len);
+			failures++;
+			return;
+		}
+	}
+}
+
+
+static void test_corrupt(void)
+{
+	uint32_t errors = failures;
+	uint32_t pos;
+
+	memcpy(corrupt, patch, patch_len);
+	corrupt[4] ^= 0x01;
+	expect_rejected("base hash", patch_len);
+
+	if(out_len != 0)
+	{
+		printf("FAIL: base hash: %u bytes built\n", out_len);
+		failures++;
+	}
+
+	memcpy(corrupt, patch, patch_len);
+	pos = find_op(DELTA_OP_COPY);
+	set_word(&corrupt[pos + 1], base_len - word(&corrupt[pos + 5]) + 1);
+	expect_rejected("COPY past the base", patch_len);
+
+	memcpy(corrupt, patch, patch_len);
+	set_word(&corrupt[pos + 1], 0xFFFFFFF0U);
+	expect_rejected("COPY offset wrapping", patch_len);
+
+	memcpy(corrupt, patch, patch_len);
+	pos = find_op(DELTA_OP_ADD);
+	set_word(&corrupt[pos + 1], base_len);
+	expect_rejected("ADD past the base", patch_len);
+
+	memcpy(corrupt, patch, patch_len);
+	pos = find_op(DELTA_OP_INSERT);
+	set_word(&corrupt[pos + 1], target_len + 1);
+	expect_rejected("INSERT past the target size", patch_len);
+
+	memcpy(corrupt, patch, patch_len);
+	set_word(&corrupt[4 + DELTA_BASE_HASH_SZ], target_len - 1);
+	expect_rejected("target size one short", patch_len);
+
+	memcpy(corrupt, patch, patch_len);
+	set_word(&corrupt[4 + DELTA_BASE_HASH_SZ], target_len + 1);
+	expect_rejected("target size one over", patch_len);
+
+	memcpy(corrupt, patch, patch_len);
+	corrupt[PATCH_OPS] = DELTA_OP_INSERT + 1;
+	expect_rejected("unknown operation", patch_len);
+
+	memcpy(corrupt, patch, patch_len);
+	expect_rejected("last byte missing", patch_len - 1);
+
+	printf("corrupt patches: %s\n", (failures == errors) ? "ok" : "FAILED");
+}
+
+
+int main(void)
+{
+	srand(1);
+
+	base_len = load("test_image_a.bin", base);
+	target_len = load("test_image_b.bin", target);
+	patch_len = load("test_patch.dlt", patch);
+	packed_len = load("test_patch_lzss.dlt", packed);
+
+	if(failures || (word(patch) != DELTA_MAGIC) || (word(packed) != LZSS_MAGIC))
+	{
+		printf("FAIL: inputs missing or without their magic\n");
+		return 1;
+	}
+
+	test_apply("raw patch", patch, patch_len, 0);
+	test_apply("compressed patch", packed, packed_len, 1);
+	test_corrupt();
+
+	return failures ? 1 : 0;
+}
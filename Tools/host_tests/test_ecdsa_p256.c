@@ -0,0 +1,210 @@
+/*
+ * File : test_ecdsa_p256.c
+ * Author : Prudhvi Raj Belide
+ * Description : Host test of the P-256 signature check. The ECDSA-SHA-256 examples of RFC 6979 A.2.5 and a signature
+ * made by Tools/p256.py with the development key must verify. Every single bit flip of their hash or signature, r and
+ * s out of range, another key and a key off the curve must not. The time per verification is printed at the end.
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+#include "ecdsa_p256.h"
+#include "image_key.h"
+
+#define BENCH_ROUNDS		200
+
+typedef struct
+{
+	const char *name;
+	const char *public_key;		/*X then Y*/
+	const char *hash;
+	const char *signature;		/*r then s*/
+
+}ecdsa_vector;
+
+#define RFC6979_KEY \
+	"60fed4ba255a9d31c961eb74c6356d68c049b8923b61fa6ce669622e60f29fb6" \
+	"7903fe1008b8bc99a41ae9e95628bc64f2f1b20c2d7e9f5177a3c294d4462299"
+
+static const ecdsa_vector vectors[] =
+{
+	{"RFC 6979 \"sample\"", RFC6979_KEY,
+	 "af2bdbe1aa9b6ec1e2ade1d694f41fc71a831d0268e9891562113d8a62add1bf",
+	 "efd48b2aacb6a8fd1140dd9cd45e81d69d2c877b56aaf991c34d0ea84eaf3716"
+	 "f7cb1c942d657c41d436c7a1b6e29f65f3e900dbb9aff4064dc4ab2f843acda8"},
+	{"RFC 6979 \"test\"", RFC6979_KEY,
+	 "9f86d081884c7d659a2feaa0c55ad015a3bf4f1b2b0b822cd15d6c15b0f00a08",
+	 "f1abb023518351cd71d881567b1ea663ed3efcf6c5132b354f28d3b0b7d38367"
+	 "019f4113742a2b14bd25926b49c649155f267e60d3814b4c0cc84250e46f0083"},
+	/*The same signature with s replaced by n - s is valid as well*/
+	{"RFC 6979 \"sample\", n - s", RFC6979_KEY,
+	 "af2bdbe1aa9b6ec1e2ade1d694f41fc71a831d0268e9891562113d8a62add1bf",
+	 "efd48b2aacb6a8fd1140dd9cd45e81d69d2c877b56aaf991c34d0ea84eaf3716"
+	 "0834e36ad29a83bf2bc9385e491d6099c8fdf9d1ed67aa7ea5f51f93782857a9"},
+	{"development key", 0,
+	 "1e9f38b823fe8e4b52afd7f8161fdc3843abdab18c040717ee15fec3dd1db92b",
+	 "730dd543ce7d71beee28b10987b27b6c932c71adccb7a8a10480f51c77780f2b"
+	 "54ffa5d5a0fa3a8ba99e6178cdecc6c1cdaa6de329e0e7172af33f17d9e44eba"},
+};
+
+static const char p256_order[] = "ffffffff00000000ffffffffffffffffbce6faada7179e84f3b9cac2fc632551";
+
+static const uint8_t image_key[2 * P256_BYTES] = IMAGE_PUBLIC_KEY;
+static uint32_t failures;
+
+
+static void from_hex(const char *hex, uint8_t *out, uint32_t length)
+{
+	uint32_t i;
+	unsigned value;
+
+	for(i = 0; i < length; i++)
+	{
+		sscanf(&hex[2 * i], "%2x", &value);
+		out[i] = (uint8_t)value;
+	}
+}
+
+
+static void load(const ecdsa_vector *vector, uint8_t *key, uint8_t *hash, uint8_t *signature)
+{
+	if(vector->public_key != 0)
+	{
+		from_hex(vector->public_key, key, 2 * P256_BYTES);
+	}
+	else
+	{
+		memcpy(key, image_key, sizeof(image_key));
+	}
+
+	from_hex(vector->hash, hash, P256_BYTES);
+	from_hex(vector->signature, signature, 2 * P256_BYTES);
+}
+
+
+static void expect(const char *name, const char *change, StatusTypeDef status, StatusTypeDef want)
+{
+	if(status != want)
+	{
+		printf("FAIL: %s, %s: %s\n", name, change, (status == DEV_OK) ? "accepted" : "rejected");
+		failures++;
+	}
+}
+
+
+static void test_valid(void)
+{
+	uint8_t key[2 * P256_BYTES], hash[P256_BYTES], signature[2 * P256_BYTES];
+	uint32_t v;
+
+	for(v = 0; v < (sizeof(vectors) / sizeof(vectors[0])); v++)
+	{
+		load(&vectors[v], key, hash, signature);
+		expect(vectors[v].name, "as published", ecdsa_p256_verify(key, hash, signature), DEV_OK);
+	}
+
+	printf("valid signatures: %s\n", failures ? "FAILED" : "ok");
+}
+
+
+static void test_bit_flips(void)
+{
+	uint8_t key[2 * P256_BYTES], hash[P256_BYTES], signature[2 * P256_BYTES];
+	char change[32];
+	uint32_t v, bit;
+
+	for(v = 0; v < (sizeof(vectors) / sizeof(vectors[0])); v++)
+	{
+		load(&vectors[v], key, hash, signature);
+
+		for(bit = 0; bit < (8 * P256_BYTES); bit++)
+		{
+			hash[bit / 8] ^= (uint8_t)(1U << (bit % 8));
+			sprintf(change, "hash bit %u", bit);
+			expect(vectors[v].name, change, ecdsa_p256_verify(key, hash, signature), DEV_ERROR);
+			hash[bit / 8] ^= (uint8_t)(1U << (bit % 8));
+		}
+
+		for(bit = 0; bit < (16 * P256_BYTES); bit++)
+		{
+			signature[bit / 8] ^= (uint8_t)(1U << (bit % 8));
+			sprintf(change, "signature bit %u", bit);
+			expect(vectors[v].name, change, ecdsa_p256_verify(key, hash, signature), DEV_ERROR);
+			signature[bit / 8] ^= (uint8_t)(1U << (bit % 8));
+		}
+	}
+
+	printf("bit flips: %s\n", failures ? "FAILED" : "ok");
+}
+
+
+static void test_invalid(void)
+{
+	uint8_t key[2 * P256_BYTES], hash[P256_BYTES], signature[2 * P256_BYTES];
+	uint8_t bad[2 * P256_BYTES];
+
+	load(&vectors[0], key, hash, signature);
+
+	/*r and s must lie in [1, n-1]*/
+	memcpy(bad, signature, sizeof(bad));
+	memset(bad, 0, P256_BYTES);
+	expect(vectors[0].name, "r = 0", ecdsa_p256_verify(key, hash, bad), DEV_ERROR);
+
+	memcpy(bad, signature, sizeof(bad));
+	memset(bad + P256_BYTES, 0, P256_BYTES);
+	expect(vectors[0].name, "s = 0", ecdsa_p256_verify(key, hash, bad), DEV_ERROR);
+
+	memcpy(bad, signature, sizeof(bad));
+	from_hex(p256_order, bad, P256_BYTES);
+	expect(vectors[0].name, "r = n", ecdsa_p256_verify(key, hash, bad), DEV_ERROR);
+
+	memcpy(bad, signature, sizeof(bad));
+	from_hex(p256_order, bad + P256_BYTES, P256_BYTES);
+	expect(vectors[0].name, "s = n", ecdsa_p256_verify(key, hash, bad), DEV_ERROR);
+
+	/*The signature of another key*/
+	expect(vectors[0].name, "development key", ecdsa_p256_verify(image_key, hash, signature), DEV_ERROR);
+
+	/*A point that is not on the curve*/
+	memcpy(bad, key, sizeof(bad));
+	bad[2 * P256_BYTES - 1] ^= 1;
+	expect(vectors[0].name, "key off the curve", ecdsa_p256_verify(bad, hash, signature), DEV_ERROR);
+
+	memset(bad, 0xFF, sizeof(bad));
+	expect(vectors[0].name, "key coordinates above p", ecdsa_p256_verify(bad, hash, signature), DEV_ERROR);
+
+	printf("invalid signatures and keys: %s\n", failures ? "FAILED" : "ok");
+}
+
+
+static void benchmark(void)
+{
+	uint8_t key[2 * P256_BYTES], hash[P256_BYTES], signature[2 * P256_BYTES];
+	struct timespec start, end;
+	double seconds;
+	uint32_t i;
+
+	load(&vectors[0], key, hash, signature);
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for(i = 0; i < BENCH_ROUNDS; i++)
+	{
+		ecdsa_p256_verify(key, hash, signature);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	seconds = (end.tv_sec - start.tv_sec) + ((end.tv_nsec - start.tv_nsec) / 1e9);
+	printf("verify: %.0f us\n", seconds * 1e6 / BENCH_ROUNDS);
+}
+
+
+int main(void)
+{
+	test_valid();
+	test_bit_flips();
+	test_invalid();
+	benchmark();
+
+	return failures ? 1 : 0;
+}
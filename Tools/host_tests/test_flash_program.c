@@ -0,0 +1,105 @@
+/*
+ * File : test_flash_program.c
+ * Author : Prudhvi Raj Belide
+ * Description : Host test of the program plan flash_program_buffer() follows. Every start offset and length up to a
+ * few hundred bytes is checked against a byte by byte walk of the head/body/tail loops, then the program operations
+ * of a 128KB image are printed for the byte-wise path and each program width.
+ */
+
+#include <stdio.h>
+#include "flash_driver.h"
+
+#define IMAGE_SZ			0x20000U
+#define FLASH_PROGRAM_US	16U		/*Typical word program time of the datasheet, the same for every width*/
+
+static uint32_t failures;
+
+
+/*The loops of flash_program_buffer() before they followed a plan*/
+static void walk(uint32_t address, uint32_t length, uint32_t width, flash_program_plan *plan)
+{
+	plan->head = plan->body = plan->tail = 0;
+
+	while((length != 0) && ((address & (width - 1)) != 0))
+	{
+		plan->head++;
+		address++;
+		length--;
+	}
+
+	while(length >= width)
+	{
+		plan->body++;
+		address += width;
+		length  -= width;
+	}
+
+	plan->tail = length;
+}
+
+
+static void test_plans(void)
+{
+	static const uint32_t widths[] = {1, 2, 4, 8};
+	flash_program_plan plan, expected;
+	uint32_t w, offset, length;
+
+	for(w = 0; w < 4; w++)
+	{
+		for(offset = 0; offset < 16; offset++)
+		{
+			for(length = 0; length < 300; length++)
+			{
+				flash_plan_program(0x08040000U + offset, length, widths[w], &plan);
+				walk(0x08040000U + offset, length, widths[w], &expected);
+
+				if((plan.head != expected.head) || (plan.body != expected.body) || (plan.tail != expected.tail) ||
+				   ((plan.head + (plan.body * widths[w]) + plan.tail) != length))
+				{
+					printf("FAIL: width %u offset %u length %u\n", widths[w], offset, length);
+					failures++;
+					return;
+				}
+			}
+		}
+	}
+
+	printf("program plans: ok\n");
+}
+
+
+static void report(void)
+{
+	static const char * const names[] = {"byte-wise", "x16", "x32", "x64 (Vpp)"};
+	flash_program_plan plan;
+	uint32_t w, operations;
+
+	printf("128KB image, %u us per operation:\n", FLASH_PROGRAM_US);
+
+	for(w = 0; w < 4; w++)
+	{
+		flash_plan_program(0x08040000U, IMAGE_SZ, 1U << w, &plan);
+		operations = flash_plan_operations(&plan);
+
+		printf("  %-10s %7u operations, %4u KB/s\n", names[w], operations,
+				(unsigned)((IMAGE_SZ * 1000000ULL) / ((unsigned long long)operations * FLASH_PROGRAM_US) / 1024U));
+	}
+
+	/*The x32 path of the 2.7-3.6V range must need a quarter of the byte-wise operations*/
+	flash_plan_program(0x08040000U, IMAGE_SZ, 4, &plan);
+
+	if(flash_plan_operations(&plan) != (IMAGE_SZ / 4))
+	{
+		printf("FAIL: x32 operations\n");
+		failures++;
+	}
+}
+
+
+int main(void)
+{
+	test_plans();
+	report();
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,490 @@
+/*
+ * File : test_http_parser.c
+ * Author : Sriramkumar Jayaraman
+ * Description : Host test of the incremental HTTP/1.1 response parser. Status lines, generated responses framed by
+ * Content-Length, chunked encoding or the end of the connection, 1xx, 204 and 304 responses and cut or malformed
+ * framing are fed in random splits, followed by a pipelined response. Mutated and random input must never make the
+ * parser read past what it was fed or hand on the body of a response that is not 2xx. The parse speed of a chunked
+ * body fed in +IPD sized pieces is printed at the end.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "http_parser.h"
+
+#define MAX_PAYLOAD_SZ		20000
+#define MAX_RESPONSE_SZ		(2 * MAX_PAYLOAD_SZ + 4096)
+#define BENCH_SZ			(1024U * 1024U)
+#define IPD_FRAME_SZ		1460
+
+typedef enum
+{
+	FRAME_LENGTH = 0,
+	FRAME_CHUNKED,
+	FRAME_CLOSE				/*No Content-Length, the body ends with the connection*/
+
+}framing;
+
+typedef struct
+{
+	uint32_t status;
+	framing frame;
+	uint32_t length;		/*Bytes of the response*/
+	uint32_t payload_len;
+	char etag[HTTP_ETAG_SZ];
+
+}response_spec;
+
+typedef struct
+{
+	uint8_t data[MAX_RESPONSE_SZ];
+	uint32_t length;
+
+}body_sink;
+
+static uint8_t stream[2 * MAX_RESPONSE_SZ];
+static uint8_t payload[MAX_PAYLOAD_SZ];
+static body_sink sink;
+static uint32_t failures;
+
+
+static void on_body(void *ctx, const uint8_t *data, uint32_t length)
+{
+	body_sink *out = ctx;
+
+	if((out->length + length) <= sizeof(out->data))
+	{
+		memcpy(&out->data[out->length], data, length);
+	}
+
+	out->length += length;
+}
+
+
+/*Feed in spans of 1 to max_span bytes until the parser stops taking them, returns the bytes it took*/
+static uint32_t feed(http_parser *parser, const uint8_t *data, uint32_t length, uint32_t max_span)
+{
+	uint32_t offset = 0;
+	uint32_t span, used;
+
+	while(offset < length)
+	{
+		span = 1 + (uint32_t)rand() % max_span;
+		span = (span > (length - offset)) ? (length - offset) : span;
+		used = http_parser_feed(parser, &data[offset], span);
+
+		if(used > span)
+		{
+			printf("FAIL: parser took %u of %u bytes\n", used, span);
+			failures++;
+			return offset;
+		}
+
+		offset += used;
+
+		if(used < span)
+		{
+			break;
+		}
+	}
+
+	return offset;
+}
+
+
+/*Reads every body byte the way the image sink does*/
+static void on_bench_body(void *ctx, const uint8_t *data, uint32_t length)
+{
+	uint32_t *sum = ctx;
+
+	while(length--)
+	{
+		*sum += *data++;
+	}
+}
+
+
+static void expect(uint8_t ok, const char *what)
+{
+	if(!ok)
+	{
+		printf("FAIL: %s\n", what);
+		failures++;
+	}
+}
+
+
+static void test_status_lines(void)
+{
+	static const struct
+	{
+		const char *line;
+		uint32_t status;		/*0 if the line is malformed*/
+
+	}lines[] =
+	{
+		{"HTTP/1.1 200 OK\r\n", 200},
+		{"HTTP/1.0 404 Not Found\r\n", 404},
+		{"HTTP/1.1 206\r\n", 206},
+		{"HTTP/1.1   503 Service Unavailable\n", 503},
+		{"\r\n\r\nHTTP/1.1 304 Not Modified\r\n", 304},
+		{"HTTP/1.1 20 OK\r\n", 0},
+		{"HTTP/1.1 2000 OK\r\n", 0},
+		{"HTTP/1.1 099 Low\r\n", 0},
+		{"HTTP/1.1 600 High\r\n", 0},
+		{"HTTP/1.1 OK\r\n", 0},
+		{"FTP/1.1 200 OK\r\n", 0},
+		{"+IPD,0,5:HTTP/1.1 200 OK\r\n", 0},
+	};
+	http_parser parser;
+	char what[80];
+	uint32_t i;
+
+	for(i = 0; i < (sizeof(lines) / sizeof(lines[0])); i++)
+	{
+		http_parser_init(&parser, on_body, &sink);
+		http_parser_feed(&parser, (const uint8_t *)lines[i].line, (uint32_t)strlen(lines[i].line));
+
+		sprintf(what, "status line %u", i);
+
+		if(lines[i].status != 0)
+		{
+			expect((parser.state == HTTP_HEADER_LINE) && (parser.status == lines[i].status), what);
+		}
+		else
+		{
+			expect(parser.state == HTTP_MALFORMED, what);
+		}
+	}
+
+	printf("status lines: %s\n", failures ? "FAILED" : "ok");
+}
+
+
+/*Random response into out, close framing only if it is the last one on the connection*/
+static void generate(uint8_t *out, response_spec *spec, uint8_t last)
+{
+	static const uint32_t statuses[] = {200, 200, 206, 404, 500, 304, 204};
+	char *text = (char *)out;
+	uint32_t length = 0;
+	uint32_t offset, chunk, i;
+
+	spec->status = statuses[rand() % (sizeof(statuses) / sizeof(statuses[0]))];
+	spec->frame = (framing)(rand() % (last ? 3 : 2));
+	spec->payload_len = ((spec->status == 204) || (spec->status == 304)) ? 0 : (uint32_t)rand() % MAX_PAYLOAD_SZ;
+	spec->etag[0] = '\0';
+
+	for(i = 0; i < spec->payload_len; i++)
+	{
+		payload[i] = (uint8_t)rand();
+	}
+
+	if((rand() % 5) == 0)
+	{
+		length += (uint32_t)sprintf(&text[length], "HTTP/1.1 100 Continue\r\nX-Interim: 1\r\n\r\n");
+	}
+
+	length += (uint32_t)sprintf(&text[length], "HTTP/1.1 %u Reason\r\n", spec->status);
+	length += (uint32_t)sprintf(&text[length], "Date: Sat, 17 Oct 2026 10:00:00 GMT, a header line much longer than "
+			"the line buffer of the parser, Content-Length: 1\r\n");
+
+	if(rand() & 1)
+	{
+		sprintf(spec->etag, "\"%08x-%04x\"", (unsigned)rand(), (unsigned)(rand() & 0xFFFF));
+		length += (uint32_t)sprintf(&text[length], "ETag: %s\r\n", spec->etag);
+	}
+
+	if((spec->status == 204) || (spec->status == 304))
+	{
+		/*No body, whatever the headers say*/
+		length += (uint32_t)sprintf(&text[length], "Content-Length: 1234\r\n\r\n");
+	}
+	else if(spec->frame == FRAME_LENGTH)
+	{
+		length += (uint32_t)sprintf(&text[length], "content-LENGTH:  %u\r\n\r\n", spec->payload_len);
+		memcpy(&out[length], payload, spec->payload_len);
+		length += spec->payload_len;
+	}
+	else if(spec->frame == FRAME_CHUNKED)
+	{
+		length += (uint32_t)sprintf(&text[length], "Transfer-Encoding: gzip, Chunked\r\n\r\n");
+
+		for(offset = 0; offset < spec->payload_len; offset += chunk)
+		{
+			chunk = 1 + (uint32_t)rand() % 3000;
+			chunk = (chunk > (spec->payload_len - offset)) ? (spec->payload_len - offset) : chunk;
+			length += (uint32_t)sprintf(&text[length], (rand() & 1) ? "%X;name=value\r\n" : "%x\r\n", chunk);
+			memcpy(&out[length], &payload[offset], chunk);
+			length += chunk;
+			length += (uint32_t)sprintf(&text[length], "\r\n");
+		}
+
+		length += (uint32_t)sprintf(&text[length], (rand() & 1) ? "0\r\nX-Trailer: 1\r\n\r\n" : "0\r\n\r\n");
+	}
+	else
+	{
+		length += (uint32_t)sprintf(&text[length], "Connection: close\r\n\r\n");
+		memcpy(&out[length], payload, spec->payload_len);
+		length += spec->payload_len;
+	}
+
+	spec->length = length;
+}
+
+
+/*Check the parser after it took a whole response, payload still holds the body of spec*/
+static uint8_t check(const http_parser *parser, const response_spec *spec)
+{
+	uint8_t success = (spec->status >= 200) && (spec->status < 300);
+
+	return (parser->state == HTTP_DONE) && (parser->status == spec->status) &&
+		   (parser->body_bytes == spec->payload_len) && (sink.length == (success ? spec->payload_len : 0)) &&
+		   (memcmp(sink.data, payload, sink.length) == 0) && (strcmp(parser->etag, spec->etag) == 0);
+}
+
+
+static void test_generated(void)
+{
+	http_parser parser;
+	response_spec first, second;
+	uint32_t round, used, rest;
+
+	for(round = 0; round < 2000; round++)
+	{
+		srand(round);
+
+		/*The second response is generated first, payload keeps the body of the one checked first*/
+		generate(stream + MAX_RESPONSE_SZ, &second, 1);
+		generate(stream, &first, 0);
+		memmove(stream + first.length, stream + MAX_RESPONSE_SZ, second.length);
+
+		sink.length = 0;
+		http_parser_init(&parser, on_body, &sink);
+		used = feed(&parser, stream, first.length + second.length, (round & 1) ? 8 : IPD_FRAME_SZ);
+
+		if((used != first.length) || !check(&parser, &first))
+		{
+			printf("FAIL: round %u first response, took %u of %u, status %u state %u\n", round, used, first.length,
+					parser.status, parser.state);
+			failures++;
+			return;
+		}
+
+		/*The pipelined response starts right behind it*/
+		srand(round);
+		generate(stream + MAX_RESPONSE_SZ, &second, 1);
+		sink.length = 0;
+		http_parser_init(&parser, on_body, &sink);
+		rest = feed(&parser, stream + first.length, second.length, IPD_FRAME_SZ);
+
+		if(second.frame == FRAME_CLOSE)
+		{
+			expect(http_parser_close(&parser) == DEV_OK, "body ended by the connection");
+		}
+
+		if((rest != second.length) || !check(&parser, &second))
+		{
+			printf("FAIL: round %u pipelined response, status %u state %u\n", round, parser.status, parser.state);
+			failures++;
+			return;
+		}
+	}
+
+	printf("generated responses: ok\n");
+}
+
+
+/*Every split of a response in two feeds, header lines and the status line cut anywhere*/
+static void test_split_headers(void)
+{
+	static const char response[] = "HTTP/1.1 200 OK\r\nETag: \"abc\"\r\nTransfer-Encoding: chunked\r\n\r\n"
+			"5\r\nhello\r\n6\r\n world\r\n0\r\n\r\n";
+	http_parser parser;
+	uint32_t length = (uint32_t)strlen(response);
+	uint32_t split, used;
+
+	for(split = 0; split <= length; split++)
+	{
+		sink.length = 0;
+		http_parser_init(&parser, on_body, &sink);
+		used  = http_parser_feed(&parser, (const uint8_t *)response, split);
+		used += http_parser_feed(&parser, (const uint8_t *)response + split, length - split);
+
+		if((used != length) || (parser.state != HTTP_DONE) || (sink.length != 11) ||
+		   (memcmp(sink.data, "hello world", 11) != 0) || (strcmp(parser.etag, "\"abc\"") != 0))
+		{
+			printf("FAIL: split at %u\n", split);
+			failures++;
+			return;
+		}
+	}
+
+	printf("split headers: ok\n");
+}
+
+
+static void test_framing(void)
+{
+	static const struct
+	{
+		const char *response;
+		httpState state;			/*State once everything is fed*/
+		StatusTypeDef closed;		/*http_parser_close() when the connection ends then*/
+		const char *what;
+
+	}cases[] =
+	{
+		{"HTTP/1.1 204 No Content\r\n\r\n", HTTP_DONE, DEV_OK, "204 without a body"},
+		{"HTTP/1.1 304 Not Modified\r\nContent-Length: 10\r\n\r\n", HTTP_DONE, DEV_OK, "304 with a length"},
+		{"HTTP/1.1 200 OK\r\nContent-Length: 0\r\n\r\n", HTTP_DONE, DEV_OK, "empty body"},
+		{"HTTP/1.1 200 OK\r\nContent-Length: 10\r\n\r\nabc", HTTP_BODY, DEV_ERROR, "body cut short"},
+		{"HTTP/1.1 200 OK\r\n\r\nabc", HTTP_BODY, DEV_OK, "body ended by the connection"},
+		{"HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabc\r\n", HTTP_CHUNK_SIZE, DEV_ERROR,
+		 "last chunk missing"},
+		{"HTTP/1.1 200 OK\r\nContent-Length: 1234567890\r\n\r\n", HTTP_MALFORMED, DEV_ERROR, "length too long"},
+		{"HTTP/1.1 200 OK\r\nContent-Length: x\r\n\r\n", HTTP_MALFORMED, DEV_ERROR, "length not a number"},
+		{"HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\nzz\r\n", HTTP_MALFORMED, DEV_ERROR,
+		 "chunk size not hex"},
+		{"HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n10000000\r\n", HTTP_MALFORMED, DEV_ERROR,
+		 "chunk too large"},
+		{"HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n3\r\nabcX\r\n", HTTP_MALFORMED, DEV_ERROR,
+		 "junk behind chunk data"},
+		{"HTTP/1.1 100 Continue\r\n\r\nHTTP/1.1 200 OK\r\nContent-Length: 2\r\n\r\nok", HTTP_DONE, DEV_OK,
+		 "interim response"},
+	};
+	static const char not_found[] = "HTTP/1.1 404 Not Found\r\nContent-Length: 4\r\n\r\nnope";
+	http_parser parser;
+	uint32_t i;
+
+	for(i = 0; i < (sizeof(cases) / sizeof(cases[0])); i++)
+	{
+		http_parser_init(&parser, on_body, &sink);
+		http_parser_feed(&parser, (const uint8_t *)cases[i].response, (uint32_t)strlen(cases[i].response));
+		expect(parser.state == cases[i].state, cases[i].what);
+		expect(http_parser_close(&parser) == cases[i].closed, cases[i].what);
+	}
+
+	/*A 404 page is framed but never handed on*/
+	sink.length = 0;
+	http_parser_init(&parser, on_body, &sink);
+	http_parser_feed(&parser, (const uint8_t *)not_found, (uint32_t)strlen(not_found));
+	expect((parser.state == HTTP_DONE) && (parser.body_bytes == 4) && (sink.length == 0), "404 body dropped");
+
+	printf("framing: %s\n", failures ? "FAILED" : "ok");
+}
+
+
+static void test_fuzz(void)
+{
+	static const char framing_bytes[] = "\r\n :0123456789abcdefHTTP/;";
+	static const char response_text[] = "HTTP/1.1 200\r\n:Content-Length chunked0123456789aF";
+	http_parser parser;
+	response_spec spec;
+	uint32_t round, edits, i, at, used;
+	uint8_t success;
+
+	for(round = 0; round < 50000; round++)
+	{
+		srand(round);
+
+		if(round & 1)
+		{
+			generate(stream, &spec, 1);
+
+			for(edits = 1 + (uint32_t)rand() % 8; edits != 0; edits--)
+			{
+				at = (uint32_t)rand() % spec.length;
+				stream[at] = (rand() & 1) ? (uint8_t)rand() : (uint8_t)framing_bytes[rand() % (sizeof(framing_bytes) - 1)];
+			}
+		}
+		else
+		{
+			spec.length = 1 + (uint32_t)rand() % 2000;
+
+			for(i = 0; i < spec.length; i++)
+			{
+				stream[i] = (uint8_t)response_text[rand() % (sizeof(response_text) - 1)];
+			}
+		}
+
+		sink.length = 0;
+		http_parser_init(&parser, on_body, &sink);
+		used = feed(&parser, stream, spec.length, 64);
+		http_parser_close(&parser);
+
+		success = http_parser_success(&parser);
+
+		if((used > spec.length) || (sink.length > parser.body_bytes) || (!success && (sink.length != 0)) ||
+		   (parser.line_len >= HTTP_LINE_SZ) || (memchr(parser.etag, '\0', sizeof(parser.etag)) == 0))
+		{
+			printf("FAIL: fuzz round %u\n", round);
+			failures++;
+			return;
+		}
+	}
+
+	printf("fuzz: ok\n");
+}
+
+
+static void benchmark(void)
+{
+	static uint8_t data[BENCH_SZ + 4096];
+	struct timespec start, end;
+	http_parser parser;
+	double seconds;
+	uint32_t length, offset, chunk, round;
+	uint32_t sum = 0;
+
+	length = (uint32_t)sprintf((char *)data, "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n");
+
+	/*Chunks of the size a server flushes, bodies of the size the ESP frames*/
+	for(offset = 0; offset < (BENCH_SZ - 4096); offset += chunk)
+	{
+		chunk = 4096;
+		length += (uint32_t)sprintf((char *)&data[length], "%x\r\n", chunk);
+		memset(&data[length], 0x5A, chunk);
+		length += chunk;
+		length += (uint32_t)sprintf((char *)&data[length], "\r\n");
+	}
+
+	length += (uint32_t)sprintf((char *)&data[length], "0\r\n\r\n");
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for(round = 0; round < 50; round++)
+	{
+		http_parser_init(&parser, on_bench_body, &sum);
+
+		for(offset = 0; offset < length; offset += chunk)
+		{
+			chunk = ((length - offset) < IPD_FRAME_SZ) ? (length - offset) : IPD_FRAME_SZ;
+			http_parser_feed(&parser, &data[offset], chunk);
+		}
+
+		if(parser.state != HTTP_DONE)
+		{
+			printf("FAIL: benchmark response not complete\n");
+			failures++;
+			return;
+		}
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	seconds = (end.tv_sec - start.tv_sec) + ((end.tv_nsec - start.tv_nsec) / 1e9);
+	printf("throughput: %.0f MB/s (body sum %08x)\n", (50.0 * length) / seconds / 1e6, sum);
+}
+
+
+int main(void)
+{
+	test_status_lines();
+	test_split_headers();
+	test_framing();
+	test_generated();
+	test_fuzz();
+	benchmark();
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,404 @@
+/*
+ * File : test_ipd_deframer.c
+ * Author : Sriramkumar Jayaraman
+ * Description : Host test of ipd_deframer.c. Random streams of AT text and +IPD frames are fed in spans of random
+ * size, so headers and payloads are split at every position, and the payload and text that come out are compared
+ * with what went in. Malformed headers must come out as text. Ends with the throughput of the deframer, next to
+ * the buffer parser it replaced on the same captures.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ipd_deframer.h"
+
+#define STREAM_SZ		(1U << 20)
+#define BENCH_ROUNDS	50
+
+/*Markers of the baseline parser*/
+#define IPD_MARKER "\r\n+IPD,"
+#define CLOSED_MARKER "\r\nCLOSED\r\n"
+#define COLON_MARKER ":"
+
+typedef struct
+{
+	uint8_t *data;
+	uint32_t length;
+
+}sink;
+
+static uint8_t stream[STREAM_SZ];
+static uint8_t want_payload[STREAM_SZ], got_payload[STREAM_SZ];
+static uint8_t want_text[STREAM_SZ], got_text[STREAM_SZ];
+static char baseline_out[0x10000 + 1500];		/*The baseline indexes its output with a uint16_t*/
+static sink payload_sink = {got_payload, 0};
+static sink text_sink = {got_text, 0};
+static uint32_t failures;
+
+
+static void collect(void *ctx, const uint8_t *data, uint32_t length)
+{
+	sink *s = (ctx == &payload_sink) ? &payload_sink : &text_sink;
+
+	memcpy(&s->data[s->length], data, length);
+	s->length += length;
+}
+
+
+static void on_payload(void *ctx, const uint8_t *data, uint32_t length)
+{
+	collect(&payload_sink, data, length);
+}
+
+
+static void on_text(void *ctx, const uint8_t *data, uint32_t length)
+{
+	collect(&text_sink, data, length);
+}
+
+
+static void check(int ok, const char *what)
+{
+	if(!ok)
+	{
+		printf("FAIL: %s\n", what);
+		failures++;
+	}
+}
+
+
+/*Feed the stream in spans of 1 to max_span bytes*/
+static void feed(ipd_deframer *deframer, const uint8_t *data, uint32_t length, uint32_t max_span)
+{
+	uint32_t span;
+
+	payload_sink.length = 0;
+	text_sink.length = 0;
+
+	while(length != 0)
+	{
+		span = 1 + (uint32_t)rand() % max_span;
+		span = (span > length) ? length : span;
+		ipd_deframer_feed(deframer, data, span);
+		data += span;
+		length -= span;
+	}
+}
+
+
+/*Text that never contains the whole marker, but plenty of false starts*/
+static uint32_t random_text(uint8_t *out, uint32_t length)
+{
+	static const char alphabet[] = "+IPD,0123456789:\r\nOK";
+	uint32_t i;
+
+	for(i = 0; i < length; i++)
+	{
+		out[i] = (uint8_t)alphabet[rand() % (sizeof(alphabet) - 1)];
+
+		if((i >= 4) && (memcmp(&out[i - 4], "+IPD,", 5) == 0))
+		{
+			out[i] = 'x';
+		}
+	}
+
+	/*Do not end in the middle of a marker, the next frame starts with one*/
+	while((length != 0) && (memchr("+IPD", out[length - 1], 4) != 0))
+	{
+		out[--length] = 0;
+	}
+
+	return length;
+}
+
+
+static void test_random_streams(void)
+{
+	ipd_deframer deframer;
+	uint32_t round;
+	uint32_t length, text_len, payload_len, frame, i;
+	uint32_t want_payload_len, want_text_len;
+	char ok;
+
+	for(round = 0; round < 2000; round++)
+	{
+		srand(round);
+		length = want_payload_len = want_text_len = 0;
+
+		while(length < 20000)
+		{
+			text_len = random_text(&stream[length], (uint32_t)rand() % 40);
+			memcpy(&want_text[want_text_len], &stream[length], text_len);
+			want_text_len += text_len;
+			length += text_len;
+
+			payload_len = (uint32_t)rand() % 1500;
+
+			if(rand() & 1)
+			{
+				length += (uint32_t)sprintf((char *)&stream[length], "+IPD,%u:", payload_len);
+			}
+			else
+			{
+				length += (uint32_t)sprintf((char *)&stream[length], "+IPD,%d,%u:", rand() % 5, payload_len);
+			}
+
+			/*Binary payload, it may hold anything including the marker*/
+			for(i = 0; i < payload_len; i++)
+			{
+				stream[length + i] = (uint8_t)rand();
+			}
+
+			if(payload_len > 10)
+			{
+				memcpy(&stream[length + 3], "+IPD,5:", 7);
+			}
+
+			memcpy(&want_payload[want_payload_len], &stream[length], payload_len);
+			want_payload_len += payload_len;
+			length += payload_len;
+		}
+
+		ipd_deframer_init(&deframer, on_payload, on_text, 0);
+		feed(&deframer, stream, length, (round & 1) ? 7 : 300);
+
+		frame = (payload_sink.length == want_payload_len) &&
+				(memcmp(got_payload, want_payload, want_payload_len) == 0);
+		ok = (char)(frame && (text_sink.length == want_text_len) && (memcmp(got_text, want_text, want_text_len) == 0) &&
+				(deframer.bad_headers == 0));
+
+		if(!ok)
+		{
+			printf("round %u: payload %u/%u text %u/%u bad headers %u\n", round, payload_sink.length,
+					want_payload_len, text_sink.length, want_text_len, deframer.bad_headers);
+			check(0, "random stream");
+			return;
+		}
+	}
+
+	printf("random streams: ok\n");
+}
+
+
+/*A malformed header comes out as text byte for byte, the frame behind it is still found*/
+static void test_malformed(void)
+{
+	static const char * const inputs[] =
+	{
+		"+IPD,12x",
+		"+IPD,123456:",
+		"+IPD,9000:",
+		"+IPD,:",
+		"+IPD,1,2,3:",
+		"+IPD,,4:",
+		"+IPD+IPD,",
+	};
+	ipd_deframer deframer;
+	char buffer[128];
+	uint32_t i, span;
+
+	for(i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++)
+	{
+		for(span = 1; span <= 16; span++)
+		{
+			/*The last input is a valid marker after a false start, it needs a frame to finish*/
+			sprintf(buffer, "OK%s%s+IPD,3:abcDONE", inputs[i], (i == 6) ? "2:zz" : "");
+			ipd_deframer_init(&deframer, on_payload, on_text, 0);
+			feed(&deframer, (const uint8_t *)buffer, (uint32_t)strlen(buffer), span);
+
+			got_text[text_sink.length] = 0;
+			got_payload[payload_sink.length] = 0;
+
+			if(i == 6)
+			{
+				check((strcmp((char *)got_text, "OK+IPDDONE") == 0) && (strcmp((char *)got_payload, "zzabc") == 0),
+						inputs[i]);
+			}
+			else
+			{
+				sprintf(buffer, "OK%sDONE", inputs[i]);
+				check((strcmp((char *)got_text, buffer) == 0) && (strcmp((char *)got_payload, "abc") == 0) &&
+						(deframer.bad_headers == 1), inputs[i]);
+			}
+		}
+	}
+
+	printf("malformed headers: %s\n", failures ? "FAILED" : "ok");
+}
+
+
+/*Parser of the baseline tree (commit c01d0ba, Src/fota_processor.c), copied unchanged. It took the whole response
+ *out of the RX buffer first and searched it for the markers*/
+static int string_length(const char *str) {
+    int length = 0;
+
+    // Iterate through the string until the null terminator is found
+    while (str[length] != '\0') {
+        length++;
+    }
+
+    return length;
+}
+
+static char* find_substring(const char *str, const char *substr, int str_size) {
+    int str_len = string_length(substr);
+    char *found_ptr = NULL;
+
+    // Iterate through the main string up to the point where the substring could fully fit
+    for (int i = 0; i <= (str_size - str_len); i++) {
+        int j = 0;
+
+        // Check if the substring matches at this position
+        while (j < str_len && str[i + j] == substr[j]) {
+            j++;
+        }
+
+        // If we matched the entire substring, return the pointer to the start of the match
+        if (j == str_len) {
+            found_ptr = (char *)&str[i];
+            break;
+        }
+    }
+
+    return found_ptr;
+}
+
+static void firmware_parse(char *dst, const char *src, int size) {
+    uint16_t dst_index = 0;            // Index for tracking the position in the destination buffer
+    const char *current_pos = src;     // Pointer to the current position in the source buffer
+    int remaining_size = size;         // Tracks the remaining bytes to process in the source buffer
+
+    // Iterate over the source buffer, extracting valid firmware data
+    while (find_substring(current_pos, IPD_MARKER, remaining_size)) {
+        // Calculate the number of valid bytes before the IPD_MARKER
+        uint16_t valid_data_length = find_substring(current_pos, IPD_MARKER, remaining_size) - current_pos;
+
+        // Copy the valid data to the destination buffer
+        for (int i = 0; i < valid_data_length; i++) {
+            dst[dst_index] = current_pos[i];
+            dst_index++;
+        }
+
+        // Move the current position past the valid data and the IPD_MARKER
+        current_pos += (valid_data_length + sizeof(IPD_MARKER) - 1);
+        remaining_size -= (valid_data_length + sizeof(IPD_MARKER) - 1);
+
+        // Find the position of the next COLON_MARKER and adjust the remaining size
+        const char* next_colon_pos = find_substring(current_pos, COLON_MARKER, remaining_size);
+        remaining_size -= (int)(next_colon_pos + 1 - current_pos);
+        current_pos = (next_colon_pos + 1);  // Move to the position after the colon
+    }
+
+    // Extract any remaining valid data before the CLOSED_MARKER
+    uint16_t valid_data_length = find_substring(current_pos, CLOSED_MARKER, remaining_size) - current_pos;
+
+    // Copy the remaining valid data to the destination buffer
+    for (int i = 0; i < valid_data_length; i++) {
+        dst[dst_index] = current_pos[i];
+        dst_index++;
+    }
+}
+
+
+/*A response the way the ESP delivers it: +IPD frames of up to 1460 bytes and the close notice. The baseline treats
+ *every byte before a marker as data, so the frames follow each other without AT text in between*/
+static uint32_t capture(uint32_t size, uint32_t *payload_len)
+{
+	uint32_t length = 0;
+	uint32_t frame, i;
+
+	*payload_len = 0;
+	srand(size);
+
+	while(length + 1500 + sizeof(CLOSED_MARKER) < size)
+	{
+		frame = 1 + (uint32_t)rand() % 1460;
+		length += (uint32_t)sprintf((char *)&stream[length], IPD_MARKER "%u:", frame);
+
+		/*Firmware bytes, ':' and the markers may turn up in them*/
+		for(i = 0; i < frame; i++)
+		{
+			stream[length + i] = (uint8_t)rand();
+		}
+
+		memcpy(&want_payload[*payload_len], &stream[length], frame);
+		*payload_len += frame;
+		length += frame;
+	}
+
+	memcpy(&stream[length], CLOSED_MARKER, sizeof(CLOSED_MARKER) - 1);
+
+	return length + sizeof(CLOSED_MARKER) - 1;
+}
+
+
+static double elapsed(const struct timespec *start)
+{
+	struct timespec end;
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+
+	return (double)(end.tv_sec - start->tv_sec) + (double)(end.tv_nsec - start->tv_nsec) * 1e-9;
+}
+
+
+static void benchmark(void)
+{
+	static const uint32_t sizes[] = {40000, 256 * 1024, 768 * 1024};
+	ipd_deframer deframer;
+	struct timespec start;
+	uint32_t length, payload_len, pass, c;
+	double deframer_s, baseline_s;
+
+	for(c = 0; c < sizeof(sizes) / sizeof(sizes[0]); c++)
+	{
+		length = capture(sizes[c], &payload_len);
+
+		/*Both must take the same payload out of the capture, the baseline as far as its 16 bit index goes*/
+		ipd_deframer_init(&deframer, on_payload, on_text, 0);
+		payload_sink.length = 0;
+		text_sink.length = 0;
+		ipd_deframer_feed(&deframer, stream, length);
+		check((payload_sink.length == payload_len) && (memcmp(got_payload, want_payload, payload_len) == 0),
+				"deframer on a capture");
+
+		if(payload_len <= 0xFFFF)
+		{
+			firmware_parse(baseline_out, (const char *)stream, (int)length);
+			check(memcmp(baseline_out, want_payload, payload_len) == 0, "baseline on a capture");
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		for(pass = 0; pass < BENCH_ROUNDS; pass++)
+		{
+			payload_sink.length = 0;
+			text_sink.length = 0;
+			ipd_deframer_feed(&deframer, stream, length);
+		}
+
+		deframer_s = elapsed(&start) / BENCH_ROUNDS;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		for(pass = 0; pass < BENCH_ROUNDS; pass++)
+		{
+			firmware_parse(baseline_out, (const char *)stream, (int)length);
+		}
+
+		baseline_s = elapsed(&start) / BENCH_ROUNDS;
+
+		printf("capture of %u bytes: deframer %.0f MB/s (%.0f us), baseline %.0f MB/s (%.0f us)\n", length,
+				length / deframer_s / 1e6, deframer_s * 1e6, length / baseline_s / 1e6, baseline_s * 1e6);
+	}
+}
+
+
+int main(void)
+{
+	test_random_streams();
+	test_malformed();
+	benchmark();
+
+	return failures ? 1 : 0;
+}
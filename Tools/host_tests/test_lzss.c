@@ -0,0 +1,237 @@
+/*
+ * File : test_lzss.c
+ * Author : Prudhvi Raj Belide
+ * Description : Host test of lzss.c against streams compressed by Tools/lzss.py. Each stream must decode to the file
+ * it was made from in one call, split in two at every position and in random spans. The window sample has to wrap
+ * the window and use matches reaching back all 4096 bytes. Ends with the decode speed on real binaries.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "lzss.h"
+
+#define FILE_MAX_SZ		(1024U * 1024U)
+#define BENCH_BYTES		(64U * 1024U * 1024U)
+
+typedef struct
+{
+	const char *name;
+	const char *plain;
+	const char *packed;
+
+}lzss_sample;
+
+/*Written by samples.py and Tools/lzss.py, see the Makefile*/
+static const lzss_sample samples[] =
+{
+	{"window", "test_window.bin", "test_window.lzs"},
+	{"packed image", "test_image_a.bin", "test_image_a.lzs"},
+	{"debug ELF", "../../Debug/esp82xx_fota_esd.elf", "test_elf.lzs"},
+};
+
+static lzss_decoder decoder;
+static uint8_t plain[FILE_MAX_SZ], packed[FILE_MAX_SZ], out[FILE_MAX_SZ];
+static uint32_t plain_len, packed_len, out_len;
+static uint8_t overflow;
+static uint32_t failures;
+
+
+static uint32_t load(const char *path, uint8_t *data)
+{
+	FILE *f = fopen(path, "rb");
+	uint32_t length;
+
+	if(f == 0)
+	{
+		printf("FAIL: can not open %s\n", path);
+		failures++;
+		return 0;
+	}
+
+	length = (uint32_t)fread(data, 1, FILE_MAX_SZ, f);
+	fclose(f);
+
+	return length;
+}
+
+
+static void collect(void *ctx, const uint8_t *data, uint32_t length)
+{
+	if((out_len + length) > FILE_MAX_SZ)
+	{
+		overflow = 1;
+		return;
+	}
+
+	memcpy(&out[out_len], data, length);
+	out_len += length;
+}
+
+
+static void discard(void *ctx, const uint8_t *data, uint32_t length)
+{
+	*(uint32_t *)ctx += data[0] + length;
+}
+
+
+/*Decode the stream behind the magic in spans of 1 to max_span bytes, max_span 0 cuts it once at split*/
+static int decode(uint32_t max_span, uint32_t split)
+{
+	const uint8_t *data = packed + 4;
+	uint32_t length = packed_len - 4;
+	uint32_t span;
+
+	out_len = 0;
+	overflow = 0;
+	lzss_init(&decoder, collect, 0);
+
+	while(length != 0)
+	{
+		span = (max_span == 0) ? split : 1 + (uint32_t)rand() % max_span;
+		span = (span > length) ? length : span;
+		lzss_feed(&decoder, data, span);
+		data += span;
+		length -= span;
+		split = length;
+	}
+
+	return !overflow && (out_len == plain_len) && (decoder.produced == plain_len) &&
+		   (memcmp(out, plain, plain_len) == 0);
+}
+
+
+/*Walks the items of the stream like Tools/lzss.py decompress() and returns the longest match distance*/
+static uint32_t longest_distance(void)
+{
+	uint32_t pos = 4, longest = 0, distance, bit;
+	uint8_t flags;
+
+	while(pos < packed_len)
+	{
+		flags = packed[pos++];
+
+		for(bit = 0; (bit < 8) && (pos < packed_len); bit++)
+		{
+			if(flags & (1U << bit))
+			{
+				pos++;
+				continue;
+			}
+
+			distance = (packed[pos] | ((packed[pos + 1] & 0xF0U) << 4)) + 1;
+			longest = (distance > longest) ? distance : longest;
+			pos += 2;
+		}
+	}
+
+	return longest;
+}
+
+
+static void test_samples(void)
+{
+	uint32_t s, split;
+	uint32_t errors;
+
+	srand(1);
+
+	for(s = 0; s < sizeof(samples) / sizeof(samples[0]); s++)
+	{
+		plain_len = load(samples[s].plain, plain);
+		packed_len = load(samples[s].packed, packed);
+		errors = failures;
+
+		if((packed_len < 4) || (packed[0] | (packed[1] << 8) | (packed[2] << 16) | ((uint32_t)packed[3] << 24)) !=
+		   LZSS_MAGIC)
+		{
+			printf("FAIL: %s: no LZSS magic\n", samples[s].name);
+			failures++;
+			continue;
+		}
+
+		if(!decode(0, packed_len))
+		{
+			printf("FAIL: %s: one call, %u of %u bytes\n", samples[s].name, out_len, plain_len);
+			failures++;
+		}
+
+		if(!decode(7, 0) || !decode(1460, 0))
+		{
+			printf("FAIL: %s: random spans\n", samples[s].name);
+			failures++;
+		}
+
+		/*Every place a chunk can end: between a control byte and its items, inside a match, at a wrap*/
+		for(split = 1; (split < (packed_len - 4)) && (packed_len < (64U * 1024U)); split++)
+		{
+			if(!decode(0, split))
+			{
+				printf("FAIL: %s: split at %u\n", samples[s].name, split);
+				failures++;
+				break;
+			}
+		}
+
+		if(s == 0)
+		{
+			if((plain_len <= LZSS_WINDOW_SZ) || (longest_distance() != LZSS_WINDOW_SZ))
+			{
+				printf("FAIL: window sample does not wrap or reach back %u bytes\n", LZSS_WINDOW_SZ);
+				failures++;
+			}
+		}
+
+		printf("%s: %u -> %u bytes: %s\n", samples[s].name, packed_len, plain_len, (failures == errors) ? "ok" : "FAILED");
+	}
+}
+
+
+static void benchmark(void)
+{
+	struct timespec start, end;
+	uint32_t s, pass, passes;
+	uint32_t sum = 0;
+	double seconds;
+
+	for(s = 1; s < sizeof(samples) / sizeof(samples[0]); s++)
+	{
+		plain_len = load(samples[s].plain, plain);
+		packed_len = load(samples[s].packed, packed);
+
+		if((plain_len == 0) || (packed_len <= 4))
+		{
+			continue;
+		}
+
+		passes = 1 + BENCH_BYTES / plain_len;
+		clock_gettime(CLOCK_MONOTONIC, &start);
+
+		for(pass = 0; pass < passes; pass++)
+		{
+			lzss_init(&decoder, discard, &sum);
+			lzss_feed(&decoder, packed + 4, packed_len - 4);
+		}
+
+		clock_gettime(CLOCK_MONOTONIC, &end);
+		seconds = (end.tv_sec - start.tv_sec) + ((end.tv_nsec - start.tv_nsec) / 1e9);
+		printf("decode %s: %.0f MB/s out, %.0f MB/s in\n", samples[s].name, ((double)passes * plain_len) / seconds / 1e6,
+				((double)passes * packed_len) / seconds / 1e6);
+	}
+
+	/*Keeps the sink from being optimised away*/
+	if(sum == 0x12345678U)
+	{
+		printf("\n");
+	}
+}
+
+
+int main(void)
+{
+	test_samples();
+	benchmark();
+
+	return failures ? 1 : 0;
+}
@@ -0,0 +1,140 @@
+/*
+ * File : test_sha256.c
+ * Author : Prudhvi Raj Belide
+ * Description : Host test of the streaming SHA-256 against the NIST FIPS 180-2 example messages. Each message is
+ * hashed in one call and again in random spans, the way the download feeds it, then the hashing throughput is printed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "sha256.h"
+
+#define MILLION				1000000U
+#define BENCH_SZ			(1024U * 1024U)
+
+typedef struct
+{
+	const char *message;
+	uint32_t repeat;
+	const char *digest;
+
+}sha256_vector;
+
+static const sha256_vector vectors[] =
+{
+	{"", 1, "e3b0c44298fc1c149afbf4c8996fb92427ae41e4649b934ca495991b7852b855"},
+	{"abc", 1, "ba7816bf8f01cfea414140de5dae2223b00361a396177a9cb410ff61f20015ad"},
+	{"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq", 1,
+	 "248d6a61d20638b8e5c026930c3e6039a33ce45964ff2167f6ecedd419db06c1"},
+	{"abcdefghbcdefghicdefghijdefghijkefghijklfghijklmghijklmnhijklmnoijklmnopjklmnopqklmnopqrlmnopqrsmnopqrstnopqrstu",
+	 1, "cf5b16a778af8380036ce59e7b0492370b249b11e8f07a51afac45037afee9d1"},
+	{"a", MILLION, "cdc76e5c9914fb9281a1c7e284d73e67f1809a48a497200e046d39ccc7112cd0"},
+};
+
+static uint8_t message[MILLION];
+static uint32_t failures;
+
+
+static void to_hex(const uint8_t digest[SHA256_DIGEST_SZ], char *hex)
+{
+	uint32_t i;
+
+	for(i = 0; i < SHA256_DIGEST_SZ; i++)
+	{
+		sprintf(&hex[2 * i], "%02x", digest[i]);
+	}
+}
+
+
+/*Hash in spans of 1 to max_span bytes, max_span 0 hashes everything in one call*/
+static void hash(const uint8_t *data, uint32_t length, uint32_t max_span, char *hex)
+{
+	sha256_context ctx;
+	uint8_t digest[SHA256_DIGEST_SZ];
+	uint32_t span;
+
+	sha256_init(&ctx);
+
+	while(length != 0)
+	{
+		span = (max_span == 0) ? length : 1 + (uint32_t)rand() % max_span;
+		span = (span > length) ? length : span;
+		sha256_update(&ctx, data, span);
+		data += span;
+		length -= span;
+	}
+
+	sha256_final(&ctx, digest);
+	to_hex(digest, hex);
+}
+
+
+static void test_vectors(void)
+{
+	static const uint32_t spans[] = {0, 1, 63, 65, 1460};
+	char hex[2 * SHA256_DIGEST_SZ + 1];
+	uint32_t v, s, i, length, unit;
+
+	srand(1);
+
+	for(v = 0; v < (sizeof(vectors) / sizeof(vectors[0])); v++)
+	{
+		unit = (uint32_t)strlen(vectors[v].message);
+		length = unit * vectors[v].repeat;
+
+		for(i = 0; i < vectors[v].repeat; i++)
+		{
+			memcpy(&message[i * unit], vectors[v].message, unit);
+		}
+
+		for(s = 0; s < (sizeof(spans) / sizeof(spans[0])); s++)
+		{
+			hash(message, length, spans[s], hex);
+
+			if(strcmp(hex, vectors[v].digest) != 0)
+			{
+				printf("FAIL: vector %u, spans up to %u bytes: %s\n", v, spans[s], hex);
+				failures++;
+			}
+		}
+	}
+
+	printf("NIST vectors: %s\n", failures ? "FAILED" : "ok");
+}
+
+
+static void benchmark(void)
+{
+	static uint8_t data[BENCH_SZ];
+	struct timespec start, end;
+	char hex[2 * SHA256_DIGEST_SZ + 1];
+	double seconds;
+	uint32_t i;
+
+	for(i = 0; i < BENCH_SZ; i++)
+	{
+		data[i] = (uint8_t)rand();
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &start);
+
+	for(i = 0; i < 20; i++)
+	{
+		hash(data, BENCH_SZ, 1460, hex);
+	}
+
+	clock_gettime(CLOCK_MONOTONIC, &end);
+	seconds = (end.tv_sec - start.tv_sec) + ((end.tv_nsec - start.tv_nsec) / 1e9);
+	printf("throughput: %.0f MB/s\n", (20.0 * BENCH_SZ) / seconds / 1e6);
+}
+
+
+int main(void)
+{
+	test_vectors();
+	benchmark();
+
+	return failures ? 1 : 0;
+}
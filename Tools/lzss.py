@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+"""
+File : lzss.py
+Author : Prudhvi Raj Belide
+Description : Compresses a firmware image for download in the LZSS format Src/lzss.c decodes: the "LZS1" magic, then
+groups of a control byte and eight items. Bit i of the control byte (LSB first) is 1 for a literal byte, 0 for a two
+byte match {distance - 1 low byte, distance - 1 high nibble << 4 | length - 3}. The window is 4KB.
+
+Usage : lzss.py firmware_update_a.bin firmware_update_a.lzs
+"""
+
+import argparse
+import struct
+import sys
+import time
+
+LZSS_MAGIC = 0x31535A4C
+WINDOW_SZ = 1 << 12
+MIN_MATCH = 3
+MAX_MATCH = MIN_MATCH + 15
+MAX_CHAIN = 256
+
+
+def compress(data):
+    out = bytearray(struct.pack("<I", LZSS_MAGIC))
+    chains = {}
+    items = []
+    pos = 0
+
+    def insert(at):
+        if at + MIN_MATCH <= len(data):
+            chains.setdefault(data[at:at + MIN_MATCH], []).append(at)
+
+    while pos < len(data):
+        best_length, best_distance = 0, 0
+
+        for candidate in reversed(chains.get(data[pos:pos + MIN_MATCH], [])[-MAX_CHAIN:]):
+            distance = pos - candidate
+            if distance > WINDOW_SZ:
+                break
+            length = MIN_MATCH
+            while length < MAX_MATCH and pos + length < len(data) and data[candidate + length] == data[pos + length]:
+                length += 1
+            if length > best_length:
+                best_length, best_distance = length, distance
+                if length == MAX_MATCH:
+                    break
+
+        if best_length >= MIN_MATCH:
+            items.append((best_distance - 1, best_length))
+            step = best_length
+        else:
+            items.append(data[pos])
+            step = 1
+
+        for at in range(pos, pos + step):
+            insert(at)
+        pos += step
+
+    for group in range(0, len(items), 8):
+        flags = 0
+        body = bytearray()
+        for bit, item in enumerate(items[group:group + 8]):
+            if isinstance(item, int):
+                flags |= 1 << bit
+                body.append(item)
+            else:
+                distance, length = item
+                body += bytes((distance & 0xFF, ((distance >> 4) & 0xF0) | (length - MIN_MATCH)))
+        out.append(flags)
+        out += body
+
+    return bytes(out)
+
+
+def decompress(data):
+    if struct.unpack_from("<I", data)[0] != LZSS_MAGIC:
+        raise ValueError("not an LZSS stream")
+
+    out = bytearray()
+    pos = 4
+
+    while pos < len(data):
+        flags = data[pos]
+        pos += 1
+        for bit in range(8):
+            if pos >= len(data):
+                break
+            if flags & (1 << bit):
+                out.append(data[pos])
+                pos += 1
+            else:
+                distance = (data[pos] | ((data[pos + 1] & 0xF0) << 4)) + 1
+                length = (data[pos + 1] & 0x0F) + MIN_MATCH
+                pos += 2
+                for _ in range(length):
+                    out.append(out[-distance])
+
+    return bytes(out)
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Compress a firmware image for download")
+    parser.add_argument("input", help="headered image from fw_pack.py")
+    parser.add_argument("output", help="compressed stream to write")
+    args = parser.parse_args()
+
+    with open(args.input, "rb") as f:
+        data = f.read()
+
+    start = time.perf_counter()
+    packed = compress(data)
+    elapsed = time.perf_counter() - start
+
+    if decompress(packed) != data:
+        sys.exit("round trip failed")
+
+    with open(args.output, "wb") as f:
+        f.write(packed)
+
+    print("%s: %d -> %d bytes, ratio %.2f, %.1f%% of the wire time, compressed in %.1f s" %
+          (args.output, len(data), len(packed), len(data) / len(packed), 100.0 * len(packed) / len(data), elapsed))
+
+
+if __name__ == "__main__":
+    main()
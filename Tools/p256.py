@@ -0,0 +1,72 @@
+"""
+File : p256.py
+Author : Prudhvi Raj Belide
+Description : ECDSA on the NIST P-256 curve for the host tools. Plain integer arithmetic, speed does not matter when
+signing one image.
+"""
+
+import hashlib
+import secrets
+
+P = 0xFFFFFFFF00000001000000000000000000000000FFFFFFFFFFFFFFFFFFFFFFFF
+N = 0xFFFFFFFF00000000FFFFFFFFFFFFFFFFBCE6FAADA7179E84F3B9CAC2FC632551
+B = 0x5AC635D8AA3A93E7B3EBBD55769886BC651D06B0CC53B0F63BCE3C3E27D2604B
+G = (0x6B17D1F2E12C4247F8BCE6E563A440F277037D812DEB33A0F4A13945D898C296,
+     0x4FE342E2FE1A7F9B8EE7EB4A7C0F9E162BCE33576B315ECECBB6406837BF51F5)
+
+
+def point_add(a, b):
+    """Affine addition, None is the point at infinity."""
+    if a is None:
+        return b
+    if b is None:
+        return a
+    if a[0] == b[0]:
+        if (a[1] + b[1]) % P == 0:
+            return None
+        slope = (3 * a[0] * a[0] - 3) * pow(2 * a[1], -1, P) % P
+    else:
+        slope = (b[1] - a[1]) * pow(b[0] - a[0], -1, P) % P
+    x = (slope * slope - a[0] - b[0]) % P
+    return x, (slope * (a[0] - x) - a[1]) % P
+
+
+def point_mul(k, point):
+    result = None
+    while k:
+        if k & 1:
+            result = point_add(result, point)
+        point = point_add(point, point)
+        k >>= 1
+    return result
+
+
+def generate_key():
+    """Return (private scalar, public key as 64 bytes X || Y)."""
+    d = secrets.randbelow(N - 1) + 1
+    return d, public_key(d)
+
+
+def public_key(d):
+    x, y = point_mul(d, G)
+    return x.to_bytes(32, "big") + y.to_bytes(32, "big")
+
+
+def sign(d, message):
+    """Sign SHA-256(message), returns 64 bytes r || s."""
+    e = int.from_bytes(hashlib.sha256(message).digest(), "big") % N
+    while True:
+        k = secrets.randbelow(N - 1) + 1
+        r = point_mul(k, G)[0] % N
+        s = pow(k, -1, N) * (e + r * d) % N
+        if r and s:
+            return r.to_bytes(32, "big") + s.to_bytes(32, "big")
+
+
+def load_key(path):
+    """Private key file: the scalar as hex on one line."""
+    with open(path) as f:
+        d = int(f.read().strip(), 16)
+    if not 0 < d < N:
+        raise ValueError("%s: key out of range" % path)
+    return d